@@ -0,0 +1,1146 @@
+/* clock_gettime is POSIX, not C89 */
+#define _POSIX_C_SOURCE 199309L
+
+#include "bswap.h"
+#include "float16.h"
+#include "pv.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Times the hot paths that have been tuned, on inputs generated here from a
+ * fixed seed so every run and every build sees the same bytes:
+ *
+ *  - pv_fnsvg2pv on a 100k-shape image, into a temporary file
+ *  - pv_nsvg2pv sizing the same image
+ *  - pv_fnsvg2pv on 20k shapes painted in eight colours, 20k transformed
+ *    polygons, 30k shapes drawn in 20 styles, 20k painted with six
+ *    gradients, and 400 outlines of about 1000 points
+ *  - the size of each of those with coordinates on a 1/16 grid and as
+ *    float16, compressed or not, with points stored as steps or not, and
+ *    the time to decode them against plain float32 coordinates
+ *  - the size of each of those with bounds and points aligned, and the
+ *    time to add up their points through the view, unaligned, aligned and
+ *    aligned in host order
+ *  - pv_pv2nsvg_arena and pv_nsvg_delete on each of those, against
+ *    pv_pv2nsvg and nsvgDelete
+ *  - nanosvg's XML tokenizer with callbacks that do nothing, and nsvgParse,
+ *    on the SVG text of each of those
+ *  - the XML tokenizer and nsvgParse on 100k rects with 14 attributes and
+ *    style properties each, and on 100k painted by four colour keywords,
+ *    which BFLAGS=-DNANOSVG_ALL_COLOR_KEYWORDS looks up in the full table
+ *  - the XML tokenizer and nsvgParse on 20k rects painted with 4000
+ *    gradients, most of which take their stops from others by xlink:href
+ *  - numbers nsvgParse reads per second from 20k paths whose points have
+ *    six decimals
+ *  - all of the per-image figures for the file named by BENCH_SVG, if set
+ *  - pv_pv2nsvg_mt on the same image, on 1, 2, 4 and 8 threads
+ *  - pv_pv2nsvg_cull on a 200x150 window of the same image
+ *  - the float16 batch conversions and byte-swapping copies with each
+ *    instruction set the CPU has
+ *
+ * Each figure is the best of several runs, in wall-clock time.
+ */
+
+/* Runs per figure */
+#define REPS 7
+
+/* A growable string */
+struct text
+{
+	char* b;
+	size_t n, cap;
+};
+
+static unsigned long seed = 1;
+
+/* Next of a fixed sequence of pseudo-random numbers below N */
+static unsigned rnd( unsigned n )
+{
+	seed = ( seed * 1103515245UL + 12345UL ) & 0xFFFFFFFFUL;
+
+	return (unsigned)( ( seed >> 8 ) % n );
+}
+
+/* Wall-clock seconds; clock() would add up the time of every thread */
+static double now( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void put( struct text* t, const char* fmt, ... )
+{
+	va_list ap;
+	char buf[256];
+	size_t n;
+
+	va_start( ap, fmt );
+	vsprintf( buf, fmt, ap );
+	va_end( ap );
+
+	n = strlen( buf );
+
+	if( t->n + n + 1 > t->cap )
+	{
+		t->cap = ( t->n + n + 1 ) * 2;
+		t->b   = realloc( t->b, t->cap );
+
+		if( !t->b )
+		{
+			fputs( "bench: out of memory\n", stderr );
+			exit( 1 );
+		}
+	}
+
+	memcpy( t->b + t->n, buf, n + 1 );
+	t->n += n;
+}
+
+/* Colour keywords, hits from across the full table and a few misses */
+static const char* keywords[] = { "aliceblue", "black", "blue", "coral",
+	"currentColor", "darkslategray", "gold", "inherit", "lightgoldenrodyellow",
+	"navy", "none", "papayawhip", "red", "teal", "transparent", "white",
+	"yellowgreen" };
+
+/* N rects painted by colour keyword */
+static void gen_keywords( struct text* t, unsigned n )
+{
+	unsigned i, k = sizeof( keywords ) / sizeof( *keywords );
+
+	put( t, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"1000\" "
+		"height=\"1000\">\n" );
+
+	for( i = 0; i < n; ++i )
+	{
+		put( t,
+			"<rect x=\"%u\" y=\"%u\" width=\"8\" height=\"8\" fill=\"%s\" "
+			"stroke=\"%s\"/>\n",
+			rnd( 1000 ), rnd( 1000 ), keywords[rnd( k )], keywords[rnd( k )] );
+	}
+
+	put( t, "</svg>\n" );
+}
+
+/* N rects painted by colour keyword three times over, as attributes and
+ * in a style, so that nsvgParse is mostly looking up keywords */
+static void gen_colors( struct text* t, unsigned n )
+{
+	unsigned i, k = sizeof( keywords ) / sizeof( *keywords );
+
+	put( t, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"1000\" "
+		"height=\"1000\">\n" );
+
+	for( i = 0; i < n; ++i )
+	{
+		put( t,
+			"<rect width=\"8\" height=\"8\" fill=\"%s\" stroke=\"%s\" "
+			"style=\"fill:%s;stroke:%s\"/>\n",
+			keywords[rnd( k )], keywords[rnd( k )], keywords[rnd( k )],
+			keywords[rnd( k )] );
+	}
+
+	put( t, "</svg>\n" );
+}
+
+/* N icon-sized paths in C flat colours */
+static void gen_flat( struct text* t, unsigned c, unsigned n )
+{
+	unsigned i;
+
+	put( t, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"1000\" "
+		"height=\"1000\">\n" );
+
+	for( i = 0; i < n; ++i )
+	{
+		put( t,
+			"<path fill=\"#%06x\" d=\"M%u,%u l12,0 0,12 -6,4 -6,-4z\"/>\n",
+			rnd( c ) * 0x1F3D5Bu & 0xFFFFFFu, rnd( 990 ), rnd( 990 ) );
+	}
+
+	put( t, "</svg>\n" );
+}
+
+/* N icon-sized paths drawn in S styles, each a fill, stroke colour, stroke
+ * width and join */
+static void gen_styled( struct text* t, unsigned s, unsigned n )
+{
+	static const char* joins[] = { "miter", "round", "bevel" };
+	unsigned i, k;
+
+	put( t, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"1000\" "
+		"height=\"1000\">\n" );
+
+	for( i = 0; i < n; ++i )
+	{
+		k = rnd( s );
+		put( t,
+			"<path fill=\"#%06x\" stroke=\"#%06x\" stroke-width=\"%u.5\" "
+			"stroke-linejoin=\"%s\" d=\"M%u,%u l12,0 0,12 -6,4 -6,-4z\"/>\n",
+			k * 0x1F3D5Bu & 0xFFFFFFu, k * 0x0B7E15u & 0xFFFFFFu, k % 4,
+			joins[k % 3], rnd( 990 ), rnd( 990 ) );
+	}
+
+	put( t, "</svg>\n" );
+}
+
+/* N rotated and scaled polygons of up to 16 sides. The transform is given
+ * as a matrix: nanoSVG's rotate() needs cosf and sinf, which C89 does not
+ * declare */
+static void gen_polygons( struct text* t, unsigned n )
+{
+	unsigned i, j, k, fill, x, y;
+	double a, s;
+
+	put( t, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"1000\" "
+		"height=\"1000\">\n" );
+
+	for( i = 0; i < n; ++i )
+	{
+		fill = rnd( 1 << 24 );
+		x    = rnd( 1000 );
+		y    = rnd( 1000 );
+		a    = rnd( 360 ) * ( 3.14159265358979 / 180.0 );
+		s    = rnd( 3 );
+		s   += rnd( 10 ) / 10.0;
+
+		put( t,
+			"<polygon fill=\"#%06x\" transform=\"matrix(%.4f %.4f %.4f %.4f "
+			"%u %u)\" points=\"",
+			fill, s * cos( a ), s * sin( a ), -s * sin( a ), s * cos( a ), x,
+			y );
+
+		for( j = 0, k = 3 + rnd( 14 ); j < k; ++j )
+		{
+			put( t, "%d,%d ", (int)rnd( 40 ) - 20, (int)rnd( 40 ) - 20 );
+		}
+
+		put( t, "\"/>\n" );
+	}
+
+	put( t, "</svg>\n" );
+}
+
+/* N rects filled and stroked with G user-space gradients */
+static void gen_shared_gradients( struct text* t, unsigned g, unsigned n )
+{
+	unsigned i;
+
+	put( t, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"1000\" "
+		"height=\"1000\">\n<defs>\n" );
+
+	for( i = 0; i < g; ++i )
+	{
+		put( t,
+			"<linearGradient id=\"g%u\" gradientUnits=\"userSpaceOnUse\" "
+			"x2=\"%u\"><stop offset=\"0\" stop-color=\"#%06x\"/>"
+			"<stop offset=\"1\" stop-color=\"#%06x\"/></linearGradient>\n",
+			i, rnd( 1000 ) + 1, rnd( 1 << 24 ), rnd( 1 << 24 ) );
+	}
+
+	put( t, "</defs>\n" );
+
+	for( i = 0; i < n; ++i )
+	{
+		put( t,
+			"<rect x=\"%u\" y=\"%u\" width=\"10\" height=\"10\" "
+			"fill=\"url(#g%u)\" stroke=\"url(#g%u)\"/>\n",
+			rnd( 1000 ), rnd( 1000 ), rnd( g ), rnd( g ) );
+	}
+
+	put( t, "</svg>\n" );
+}
+
+/* N rects filled and stroked with G gradients, in chains of up to four
+ * where only the first has stops and each of the rest refers to the one
+ * before it */
+static void gen_chained_gradients( struct text* t, unsigned g, unsigned n )
+{
+	unsigned i;
+
+	put( t, "<svg xmlns=\"http://www.w3.org/2000/svg\" "
+		"xmlns:xlink=\"http://www.w3.org/1999/xlink\" width=\"1000\" "
+		"height=\"1000\">\n<defs>\n" );
+
+	for( i = 0; i < g; ++i )
+	{
+		if( i % 4 == 0 )
+		{
+			put( t,
+				"<linearGradient id=\"g%u\"><stop offset=\"0\" "
+				"stop-color=\"#%06x\"/><stop offset=\"1\" "
+				"stop-color=\"#%06x\"/></linearGradient>\n",
+				i, rnd( 1 << 24 ), rnd( 1 << 24 ) );
+		}
+		else
+		{
+			put( t,
+				"<linearGradient id=\"g%u\" xlink:href=\"#g%u\" "
+				"x2=\"0.%u\"/>\n",
+				i, i - 1, rnd( 10 ) );
+		}
+	}
+
+	put( t, "</defs>\n" );
+
+	for( i = 0; i < n; ++i )
+	{
+		put( t,
+			"<rect x=\"%u\" y=\"%u\" width=\"10\" height=\"10\" "
+			"fill=\"url(#g%u)\" stroke=\"url(#g%u)\"/>\n",
+			rnd( 1000 ), rnd( 1000 ), rnd( g ), rnd( g ) );
+	}
+
+	put( t, "</svg>\n" );
+}
+
+/* N rects with eleven presentation attributes and a style of three
+ * properties each, and little else */
+static void gen_attrs( struct text* t, unsigned n )
+{
+	unsigned i;
+
+	put( t, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"1000\" "
+		"height=\"1000\">\n" );
+
+	for( i = 0; i < n; ++i )
+	{
+		put( t,
+			"<rect x=\"%u\" y=\"%u\" width=\"9\" height=\"7\" rx=\"1\" "
+			"fill=\"#%06x\" stroke=\"#000000\" stroke-width=\"%u\" "
+			"opacity=\"0.9\" fill-opacity=\"0.5\" stroke-linecap=\"round\" "
+			"style=\"stroke-linejoin:round;stroke-miterlimit:3;"
+			"fill-rule:evenodd\"/>\n",
+			rnd( 990 ), rnd( 990 ), rnd( 1 << 24 ), 1 + rnd( 3 ) );
+	}
+
+	put( t, "</svg>\n" );
+}
+
+/* N paths of 40 lines each between points with six decimals, as exported
+ * by design tools, and return how many numbers they hold */
+static unsigned long gen_decimals( struct text* t, unsigned n )
+{
+	unsigned i, j;
+
+	put( t, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"1000\" "
+		"height=\"1000\">\n" );
+
+	for( i = 0; i < n; ++i )
+	{
+		put( t, "<path fill=\"#%06x\" d=\"M%u.%06u %u.%06u", rnd( 1 << 24 ),
+			rnd( 1000 ), rnd( 1000000 ), rnd( 1000 ), rnd( 1000000 ) );
+
+		for( j = 0; j < 40; ++j )
+		{
+			put( t, "L%u.%06u,-%u.%06ue-1", rnd( 1000 ), rnd( 1000000 ),
+				rnd( 1000 ), rnd( 1000000 ) );
+		}
+
+		put( t, "z\"/>\n" );
+	}
+
+	put( t, "</svg>\n" );
+
+	return (unsigned long)( n ) * 41 * 2;
+}
+
+/* N traced outlines of 500 to 1500 points each, wandering in small steps
+ * of lines and curves, as a map or a scanned drawing has */
+static void gen_outlines( struct text* t, unsigned n )
+{
+	unsigned i, j, k;
+	int x, y;
+
+	put( t, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"1000\" "
+		"height=\"1000\">\n" );
+
+	for( i = 0; i < n; ++i )
+	{
+		x = rnd( 1000 ) * 10;
+		y = rnd( 1000 ) * 10;
+		put( t, "<path fill=\"none\" stroke=\"#%06x\" d=\"M%d.%d,%d.%d",
+			rnd( 1 << 24 ), x / 10, x % 10, y / 10, y % 10 );
+
+		for( j = 0, k = 500 + rnd( 1000 ); j < k; ++j )
+		{
+			x += (int)rnd( 41 ) - 20;
+			y += (int)rnd( 41 ) - 20;
+			x = x < 0 ? -x : x;
+			y = y < 0 ? -y : y;
+
+			if( rnd( 4 ) )
+			{
+				put( t, " L%d.%d,%d.%d", x / 10, x % 10, y / 10, y % 10 );
+			}
+			else
+			{
+				put( t, " Q%d.%d,%d.%d %d.%d,%d.%d", x / 10, x % 10, y / 10,
+					y % 10, ( x + 7 ) / 10, ( x + 7 ) % 10, ( y + 3 ) / 10,
+					( y + 3 ) % 10 );
+			}
+		}
+
+		put( t, "\"/>\n" );
+	}
+
+	put( t, "</svg>\n" );
+}
+
+/* Encode IMG into a buffer through a temporary file */
+static unsigned char* encode( struct NSVGimage* img, size_t* n )
+{
+	unsigned char* b;
+	FILE* f;
+	long sz;
+
+	f = tmpfile( );
+
+	if( !f )
+	{
+		return NULL;
+	}
+
+	if( pv_fnsvg2pv( img, f ) || ( sz = ftell( f ) ) < 0 ||
+		fseek( f, 0, SEEK_SET ) )
+	{
+		fclose( f );
+
+		return NULL;
+	}
+
+	b = malloc( (size_t)sz );
+
+	if( b && fread( b, 1, (size_t)sz, f ) != (size_t)sz )
+	{
+		free( b );
+		b = NULL;
+	}
+
+	fclose( f );
+	*n = (size_t)sz;
+
+	return b;
+}
+
+/* nanosvg's XML tokenizer, which nanosvg.h leaves out of its interface */
+int nsvg__parseXML( char* input,
+	void ( *startelCb )( void* ud, const char* el, const char** attr ),
+	void ( *endelCb )( void* ud, const char* el ),
+	void ( *contentCb )( void* ud, const char* s ), void* ud );
+
+static void xml_start( void* ud, const char* el, const char** attr )
+{
+	( *(unsigned long*)( ud ) )++;
+}
+
+static void xml_end( void* ud, const char* el ) { }
+
+static void xml_content( void* ud, const char* s ) { }
+
+/* Time to tokenize the SVG in T, which is left as it is, with callbacks
+ * that do nothing, and to parse it with nsvgParse */
+static void bench_xml( const char* name, const struct text* t )
+{
+	struct NSVGimage* img;
+	double scan = 1e9, parse = 1e9, s;
+	unsigned long tags = 0;
+	char* b;
+	int k;
+
+	b = malloc( t->n + 1 );
+
+	for( k = 0; b && k < REPS; ++k )
+	{
+		memcpy( b, t->b, t->n + 1 );
+		tags = 0;
+		s    = now( );
+		nsvg__parseXML( b, xml_start, xml_end, xml_content, &tags );
+		s    = now( ) - s;
+		scan = s < scan ? s : scan;
+
+		memcpy( b, t->b, t->n + 1 );
+		s     = now( );
+		img   = nsvgParse( b, "px", 96.0f );
+		s     = now( ) - s;
+		parse = s < parse ? s : parse;
+
+		if( img )
+		{
+			nsvgDelete( img );
+		}
+	}
+
+	if( !b )
+	{
+		printf( "xml   %-14s failed\n", name );
+	}
+	else
+	{
+		printf( "xml   %-14s %8lu tags in %.2f MB, scan %.2f ms, nsvgParse "
+				"%.2f ms\n",
+			name, tags, t->n / 1e6, scan * 1e3, parse * 1e3 );
+	}
+
+	free( b );
+}
+
+/* Numbers per second nsvgParse reads from the SVG in T, which holds N of
+ * them and little else, and is left as it is */
+static void bench_numbers( const char* name, const struct text* t,
+	unsigned long n )
+{
+	struct NSVGimage* img;
+	double best = 1e9, s;
+	char* b;
+	int k;
+
+	b = malloc( t->n + 1 );
+
+	for( k = 0; b && k < REPS; ++k )
+	{
+		memcpy( b, t->b, t->n + 1 );
+		s    = now( );
+		img  = nsvgParse( b, "px", 96.0f );
+		s    = now( ) - s;
+		best = s < best ? s : best;
+
+		if( img )
+		{
+			nsvgDelete( img );
+		}
+	}
+
+	if( !b )
+	{
+		printf( "numbers %-14s failed\n", name );
+	}
+	else
+	{
+		printf( "numbers %-14s %lu in %.2f ms, %.1f M/s\n", name, n,
+			best * 1e3, n / best / 1e6 );
+	}
+
+	free( b );
+}
+
+/* The 100k-shape image, or NULL */
+static struct NSVGimage* image_100k( void )
+{
+	struct text t = { NULL, 0, 0 };
+	struct NSVGimage* img;
+
+	seed = 1;
+	gen_keywords( &t, 100000 );
+	bench_xml( "100k shapes", &t );
+	img = nsvgParse( t.b, "px", 96.0f );
+	free( t.b );
+
+	return img;
+}
+
+static void bench_encode( const char* name, struct NSVGimage* img )
+{
+	double best = 1e9, s;
+	long n = 0;
+	FILE* f;
+	int k, r = 0;
+
+	for( k = 0; k < REPS && !r; ++k )
+	{
+		f = tmpfile( );
+
+		if( !f )
+		{
+			r = -1;
+			break;
+		}
+
+		s    = now( );
+		r    = pv_fnsvg2pv( img, f );
+		s    = now( ) - s;
+		best = s < best ? s : best;
+		n    = ftell( f );
+		fclose( f );
+	}
+
+	if( r )
+	{
+		printf( "encode %-14s failed\n", name );
+	}
+	else
+	{
+		printf( "encode %-14s %9.2f ms  %ld bytes\n", name, best * 1e3, n );
+	}
+}
+
+static void bench_size( struct NSVGimage* img )
+{
+	double best = 1e9, s;
+	size_t n;
+	int k, r = 0;
+
+	for( k = 0; k < REPS && !r; ++k )
+	{
+		s    = now( );
+		r    = pv_nsvg2pv( img, NULL, &n );
+		s    = now( ) - s;
+		best = s < best ? s : best;
+	}
+
+	if( r )
+	{
+		printf( "size 100k shapes      failed\n" );
+	}
+	else
+	{
+		printf( "size 100k shapes      %9.2f ms  %lu bytes\n", best * 1e3,
+			(unsigned long)( n ) );
+	}
+}
+
+/* Best time to decode N bytes from B with CLIP, or on TH threads without,
+ * in seconds */
+static double time_decode(
+	unsigned char* b, size_t n, const float* clip, unsigned th )
+{
+	struct NSVGimage* out;
+	double best = 1e9, s;
+	int k, r = 0;
+
+	for( k = 0; k < REPS && !r; ++k )
+	{
+		out = calloc( 1, sizeof( struct NSVGimage ) );
+
+		if( !out )
+		{
+			return -1.0;
+		}
+
+		s    = now( );
+		r    = clip ? pv_pv2nsvg_cull( b, n, out, clip, 1 ) :
+					  pv_pv2nsvg_mt( b, n, out, th );
+		s    = now( ) - s;
+		best = s < best ? s : best;
+		nsvgDelete( out );
+	}
+
+	return r ? -1.0 : best;
+}
+
+/* Size of IMG with coordinates stored as O says against float32, and the
+ * time to decode each */
+static void bench_coords( const char* mode, const struct pv_opts* o,
+	const char* name, struct NSVGimage* img )
+{
+	struct pv_opts opts[2];
+	unsigned char* b[2];
+	size_t n[2];
+	double t[2];
+	int i, r;
+
+	memset( opts, 0, sizeof( opts ) );
+	opts[1] = *o;
+
+	for( i = 0, r = 0; i < 2; ++i )
+	{
+		b[i] = NULL;
+		r    = r ? r : pv_nsvg2pv_opts( img, opts + i, NULL, n + i );
+		b[i] = r ? NULL : malloc( n[i] );
+		r    = r ? r : !b[i] ? -2 :
+							   pv_nsvg2pv_opts( img, opts + i, b[i], n + i );
+		t[i] = r ? -1.0 : time_decode( b[i], n[i], NULL, 1 );
+	}
+
+	if( r || t[0] < 0.0 || t[1] < 0.0 )
+	{
+		printf( "%-11s %-14s failed with %d\n", mode, name, r );
+	}
+	else
+	{
+		printf( "%-11s %-14s %9lu bytes x%.2f smaller, decode %.2f ms "
+				"against %.2f ms\n",
+			mode, name, (unsigned long)( n[1] ), (double)( n[0] ) / n[1],
+			t[1] * 1e3, t[0] * 1e3 );
+	}
+
+	free( b[0] );
+	free( b[1] );
+}
+
+static void bench_decode_mt( unsigned char* b, size_t n )
+{
+	double one = 0.0, t;
+	unsigned th;
+
+	for( th = 1; th <= 8; th *= 2 )
+	{
+		t = time_decode( b, n, NULL, th );
+
+		if( t < 0.0 )
+		{
+			printf( "decode 100k shapes %u  failed\n", th );
+			continue;
+		}
+
+		one = th == 1 ? t : one;
+		printf( "decode 100k shapes %u  %9.2f ms  x%.2f\n", th, t * 1e3,
+			one / t );
+	}
+}
+
+static void bench_cull( unsigned char* b, size_t n )
+{
+	static const float clip[4] = { 400.0f, 400.0f, 600.0f, 550.0f };
+	double t;
+
+	t = time_decode( b, n, clip, 1 );
+
+	if( t < 0.0 )
+	{
+		printf( "cull 200x150 window   failed\n" );
+	}
+	else
+	{
+		printf( "cull 200x150 window   %9.2f ms\n", t * 1e3 );
+	}
+}
+
+/* Millions of values a second pv_f16_32to16_n and pv_f16_16to32_n convert,
+ * in batches of 4096, with each instruction set the CPU has */
+static void bench_f16( void )
+{
+	static const char* names[] = { "scalar", "sse2", "avx2", "f16c" };
+	static float f[4096];
+	static unsigned short h[4096];
+	double t[2], s;
+	int isa, i, j, k;
+
+	for( i = 0; i < 4096; ++i )
+	{
+		f[i] = ( (float)( rnd( 2000001 ) ) - 1e6f ) / 1000.0f;
+	}
+
+	for( isa = PV_F16_ISA_SCALAR; isa <= PV_F16_ISA_F16C; ++isa )
+	{
+		if( pv_f16_isa( isa ) != isa )
+		{
+			printf( "f16 %-6s              not on this CPU\n", names[isa] );
+			continue;
+		}
+
+		for( j = 0; j < 2; ++j )
+		{
+			t[j] = 1e9;
+
+			for( k = 0; k < REPS; ++k )
+			{
+				s = now( );
+
+				for( i = 0; i < 1000; ++i )
+				{
+					if( j )
+					{
+						pv_f16_16to32_n( f, h, 4096 );
+					}
+					else
+					{
+						pv_f16_32to16_n( h, f, 4096 );
+					}
+				}
+
+				s    = now( ) - s;
+				t[j] = s < t[j] ? s : t[j];
+			}
+		}
+
+		printf( "f16 %-6s  32to16 %7.0f  16to32 %7.0f  M values/s\n",
+			names[isa], 4096e3 / t[0] / 1e6, 4096e3 / t[1] / 1e6 );
+	}
+
+	pv_f16_isa( PV_F16_ISA_BEST );
+}
+
+/* Billions of values a second pv_bswap32_n and pv_bswap16_n copy, 16 KiB at
+ * a time, with each instruction set the CPU has */
+static void bench_bswap( void )
+{
+	static const char* names[] = { "scalar", "ssse3", "avx2" };
+	static unsigned char in[0x4000], out[0x4000];
+	double t[2], s;
+	int isa, i, j, k;
+
+	for( i = 0; i < 0x4000; ++i )
+	{
+		in[i] = (unsigned char)( rnd( 256 ) );
+	}
+
+	for( isa = PV_BSWAP_ISA_SCALAR; isa <= PV_BSWAP_ISA_AVX2; ++isa )
+	{
+		if( pv_bswap_isa( isa ) != isa )
+		{
+			printf( "bswap %-6s            not on this CPU\n", names[isa] );
+			continue;
+		}
+
+		for( j = 0; j < 2; ++j )
+		{
+			t[j] = 1e9;
+
+			for( k = 0; k < REPS; ++k )
+			{
+				s = now( );
+
+				for( i = 0; i < 10000; ++i )
+				{
+					if( j )
+					{
+						pv_bswap16_n( out, in, 0x2000 );
+					}
+					else
+					{
+						pv_bswap32_n( out, in, 0x1000 );
+					}
+				}
+
+				s    = now( ) - s;
+				t[j] = s < t[j] ? s : t[j];
+			}
+		}
+
+		printf( "bswap %-6s  32-bit %6.2f  16-bit %6.2f  G values/s\n",
+			names[isa], 0x1000 * 1e4 / t[0] / 1e9,
+			0x2000 * 1e4 / t[1] / 1e9 );
+	}
+
+	pv_bswap_isa( PV_BSWAP_ISA_BEST );
+}
+
+/* Add up every stored point of B through the view, using them in place
+ * where pv_view_path_floats() can, and return the best time of several */
+static double time_view( const unsigned char* b, size_t n, double* sum )
+{
+	struct pv_view v;
+	struct pv_vshape vs;
+	struct pv_vpath vp;
+	const float* f;
+	unsigned char* tags = NULL;
+	float* pts = NULL;
+	double best = 1e9, s;
+	size_t cap = 0, k;
+	unsigned i, j;
+	int rep, r = 0;
+
+	for( rep = 0; rep < REPS && !r; ++rep )
+	{
+		s    = now( );
+		*sum = 0.0;
+		r    = pv_view_init( b, n, &v );
+
+		for( i = 0; !r && i < v.shape_ct; ++i )
+		{
+			r = pv_view_shape( &v, i, &vs );
+
+			for( j = 0; !r && j < vs.path_ct; ++j )
+			{
+				r = pv_view_path( &v, &vs, j, &vp );
+				f = r ? NULL : pv_view_path_floats( &vp );
+
+				if( !r && !f && vp.npts + 1 > cap )
+				{
+					cap = ( vp.npts + 1 ) * 2;
+					free( pts );
+					free( tags );
+					pts  = malloc( sizeof( float ) * 2 * cap );
+					tags = malloc( cap );
+					r    = pts && tags ? 0 : -2;
+				}
+
+				if( !r && !f )
+				{
+					pv_view_path_segs( &vp, tags, pts );
+					f = pts;
+				}
+
+				for( k = 0; !r && k < (size_t)( vp.pts_ct ) * 2; ++k )
+				{
+					*sum += f[k];
+				}
+			}
+		}
+
+		s    = now( ) - s;
+		best = s < best ? s : best;
+	}
+
+	free( pts );
+	free( tags );
+
+	return r ? -1.0 : best;
+}
+
+/* Size of IMG unaligned, aligned, and aligned in host order, and the time
+ * to add up its points through the view each way */
+static void bench_view( const char* name, struct NSVGimage* img )
+{
+	struct pv_opts opts;
+	unsigned char* b[3];
+	size_t n[3];
+	double t[3], sum[3];
+	int i, r;
+
+	for( i = 0, r = 0; i < 3; ++i )
+	{
+		memset( &opts, 0, sizeof( opts ) );
+		opts.align  = i > 0;
+		opts.native = i > 1;
+		b[i]        = NULL;
+		r           = r ? r : pv_nsvg2pv_opts( img, &opts, NULL, n + i );
+		b[i]        = r ? NULL : malloc( n[i] );
+		r           = r ? r : !b[i] ? -2 :
+									  pv_nsvg2pv_opts( img, &opts, b[i], n + i );
+		t[i]        = r ? -1.0 : time_view( b[i], n[i], sum + i );
+		r           = r ? r : t[i] < 0.0 ? -1 : 0;
+	}
+
+	if( r || sum[0] != sum[1] || sum[0] != sum[2] )
+	{
+		printf( "view %-14s  failed with %d\n", name, r );
+	}
+	else
+	{
+		printf( "view %-14s  %9lu %9lu bytes, sum %.2f %.2f %.2f ms\n", name,
+			(unsigned long)( n[0] ), (unsigned long)( n[2] ), t[0] * 1e3,
+			t[1] * 1e3, t[2] * 1e3 );
+	}
+
+	for( i = 0; i < 3; ++i )
+	{
+		free( b[i] );
+	}
+}
+
+/* Best time to decode N bytes from B and release the image again, with
+ * pv_pv2nsvg_arena when ARENA is set, in seconds */
+static double time_release( unsigned char* b, size_t n, int arena )
+{
+	struct NSVGimage* out;
+	double best = 1e9, s;
+	int k, r = 0;
+
+	for( k = 0; k < REPS && !r; ++k )
+	{
+		out = calloc( 1, sizeof( struct NSVGimage ) );
+
+		if( !out )
+		{
+			return -1.0;
+		}
+
+		s = now( );
+
+		if( arena )
+		{
+			r = pv_pv2nsvg_arena( b, n, out );
+			pv_nsvg_delete( out );
+		}
+		else
+		{
+			r = pv_pv2nsvg( b, n, out );
+			nsvgDelete( out );
+		}
+
+		s    = now( ) - s;
+		best = s < best ? s : best;
+	}
+
+	return r ? -1.0 : best;
+}
+
+/* Time to decode and release IMG on the heap and in one arena */
+static void bench_arena( const char* name, struct NSVGimage* img )
+{
+	unsigned char* b;
+	double heap, arena;
+	size_t n;
+
+	b     = encode( img, &n );
+	heap  = b ? time_release( b, n, 0 ) : -1.0;
+	arena = b ? time_release( b, n, 1 ) : -1.0;
+
+	if( heap < 0.0 || arena < 0.0 )
+	{
+		printf( "arena %-14s failed\n", name );
+	}
+	else
+	{
+		printf( "arena %-14s decode + release %.2f ms against %.2f ms on the "
+				"heap\n",
+			name, arena * 1e3, heap * 1e3 );
+	}
+
+	free( b );
+}
+
+/* Encode and time IMG, or say it could not be parsed, then free it */
+static void bench_image( const char* name, struct NSVGimage* img )
+{
+	struct pv_opts o;
+
+	if( !img )
+	{
+		printf( "parse %-14s failed\n", name );
+
+		return;
+	}
+
+	bench_encode( name, img );
+
+	memset( &o, 0, sizeof( o ) );
+	o.coords  = PV_COORDS_GRID;
+	o.quantum = 1.0f / 16.0f;
+	bench_coords( "grid", &o, name, img );
+	o.compress = 1;
+	bench_coords( "packed grid", &o, name, img );
+	o.coords   = PV_COORDS_F16;
+	o.quantum  = 0.0f;
+	o.compress = 0;
+	bench_coords( "float16", &o, name, img );
+	o.coords   = PV_COORDS_F32;
+	o.compress = 1;
+	bench_coords( "packed", &o, name, img );
+	o.compress = 0;
+	o.predict  = 1;
+	bench_coords( "steps", &o, name, img );
+	o.compress = 1;
+	bench_coords( "pack steps", &o, name, img );
+	bench_view( name, img );
+	bench_arena( name, img );
+	nsvgDelete( img );
+}
+
+/* Read the file at PATH into T, replacing what it held */
+static int slurp( const char* path, struct text* t )
+{
+	FILE* f;
+	long sz;
+	int r;
+
+	f = fopen( path, "rb" );
+
+	if( !f )
+	{
+		return -1;
+	}
+
+	r = fseek( f, 0, SEEK_END ) || ( sz = ftell( f ) ) < 0 ||
+		fseek( f, 0, SEEK_SET );
+
+	if( !r && (size_t)( sz ) + 1 > t->cap )
+	{
+		t->cap = (size_t)( sz ) + 1;
+		free( t->b );
+		t->b = malloc( t->cap );
+		r    = !t->b;
+	}
+
+	r    = r ? r : fread( t->b, 1, (size_t)( sz ), f ) != (size_t)( sz );
+	t->n = r ? 0 : (size_t)( sz );
+	fclose( f );
+
+	if( t->b )
+	{
+		t->b[t->n] = '\0';
+	}
+
+	return r ? -1 : 0;
+}
+
+/* Parse the SVG in T, and empty T for the next one */
+static struct NSVGimage* parse( struct text* t )
+{
+	t->n = 0;
+
+	return nsvgParse( t->b, "px", 96.0f );
+}
+
+int main( void )
+{
+	struct text t = { NULL, 0, 0 };
+	struct NSVGimage* img;
+	unsigned long nums;
+	unsigned char* b;
+	size_t n;
+
+	img = image_100k( );
+	b   = img ? encode( img, &n ) : NULL;
+
+	if( !b )
+	{
+		printf( "encode 100k shapes    failed\n" );
+
+		return 1;
+	}
+
+	bench_size( img );
+	bench_image( "100k shapes", img );
+
+	gen_flat( &t, 8, 20000 );
+	bench_xml( "20k icons", &t );
+	bench_image( "20k icons", parse( &t ) );
+	gen_polygons( &t, 20000 );
+	bench_xml( "20k polygons", &t );
+	bench_image( "20k polygons", parse( &t ) );
+	gen_styled( &t, 20, 30000 );
+	bench_xml( "30k styled", &t );
+	bench_image( "30k styled", parse( &t ) );
+	gen_shared_gradients( &t, 6, 20000 );
+	bench_xml( "20k gradients", &t );
+	bench_image( "20k gradients", parse( &t ) );
+	gen_outlines( &t, 400 );
+	bench_xml( "400 outlines", &t );
+	bench_image( "400 outlines", parse( &t ) );
+	gen_attrs( &t, 100000 );
+	bench_xml( "100k attrs", &t );
+	t.n = 0;
+	gen_colors( &t, 100000 );
+	bench_xml( "100k keywords", &t );
+	t.n = 0;
+	gen_chained_gradients( &t, 4000, 20000 );
+	bench_xml( "4k chained", &t );
+	t.n = 0;
+	nums = gen_decimals( &t, 20000 );
+	bench_numbers( "20k decimals", &t, nums );
+	t.n = 0;
+
+	/* A file of one's own, as in BENCH_SVG=drawing.svg make bench */
+	if( getenv( "BENCH_SVG" ) )
+	{
+		if( slurp( getenv( "BENCH_SVG" ), &t ) )
+		{
+			printf( "read  %-14s failed\n", "BENCH_SVG" );
+		}
+		else
+		{
+			bench_xml( "BENCH_SVG", &t );
+			bench_image( "BENCH_SVG", parse( &t ) );
+		}
+	}
+
+	free( t.b );
+	bench_decode_mt( b, n );
+	bench_cull( b, n );
+	bench_f16( );
+	bench_bswap( );
+	free( b );
+
+	return 0;
+}
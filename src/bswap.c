@@ -0,0 +1,302 @@
+#include "bswap.h"
+#include "cpu.h"
+
+#include <string.h>
+
+#ifndef PV_NO_THREADS
+#include <pthread.h>
+#endif /* PV_NO_THREADS */
+
+/* The scalar copies build each value from its bytes most significant first,
+ * which swaps them on little-endian hosts and leaves them be on big-endian
+ * ones */
+
+static void bswap32_n( unsigned char* o, const unsigned char* i, size_t n )
+{
+	unsigned u;
+	size_t k;
+
+	for( k = 0; k < n; ++k )
+	{
+		u = ( (unsigned)( i[0] ) << 24 ) | ( (unsigned)( i[1] ) << 16 ) |
+			( (unsigned)( i[2] ) << 8 ) | i[3];
+
+		memcpy( o, &u, 4 );
+		i += 4;
+		o += 4;
+	}
+}
+
+static void bswap16_n( unsigned char* o, const unsigned char* i, size_t n )
+{
+	unsigned short u;
+	size_t k;
+
+	for( k = 0; k < n; ++k )
+	{
+		u = (unsigned short)( ( i[0] << 8 ) | i[1] );
+
+		memcpy( o, &u, 2 );
+		i += 2;
+		o += 2;
+	}
+}
+
+/* Is the host little-endian? */
+static int host_le( void )
+{
+	unsigned u;
+	unsigned char c;
+
+	u = 1;
+	memcpy( &c, &u, 1 );
+
+	return c == 1;
+}
+
+#ifdef PV_CPU_X86
+
+#include <immintrin.h>
+
+/* x86 is little-endian, so the kernels always swap. They shuffle the bytes of
+ * N bytes' worth of values with the pshufb mask M, as many as fill whole
+ * vectors, and return how many bytes that was */
+
+__attribute__( ( target( "ssse3" ) ) ) static size_t bswap_ssse3(
+	unsigned char* o, const unsigned char* i, size_t n, const char* m )
+{
+	__m128i mask, a, b;
+	size_t k;
+
+	mask = _mm_loadu_si128( (const __m128i*)( m ) );
+
+	for( k = 0; k + 32 <= n; k += 32 )
+	{
+		a = _mm_loadu_si128( (const __m128i*)( i + k ) );
+		b = _mm_loadu_si128( (const __m128i*)( i + k + 16 ) );
+
+		_mm_storeu_si128( (__m128i*)( o + k ), _mm_shuffle_epi8( a, mask ) );
+		_mm_storeu_si128(
+			(__m128i*)( o + k + 16 ), _mm_shuffle_epi8( b, mask ) );
+	}
+
+	for( ; k + 16 <= n; k += 16 )
+	{
+		a = _mm_loadu_si128( (const __m128i*)( i + k ) );
+
+		_mm_storeu_si128( (__m128i*)( o + k ), _mm_shuffle_epi8( a, mask ) );
+	}
+
+	return k;
+}
+
+__attribute__( ( target( "avx2" ) ) ) static size_t bswap_avx2(
+	unsigned char* o, const unsigned char* i, size_t n, const char* m )
+{
+	__m256i mask, a, b;
+	size_t k;
+
+	/* The shuffle works within each 128-bit lane, so both get the mask */
+	mask = _mm256_broadcastsi128_si256(
+		_mm_loadu_si128( (const __m128i*)( m ) ) );
+
+	for( k = 0; k + 64 <= n; k += 64 )
+	{
+		a = _mm256_loadu_si256( (const __m256i*)( i + k ) );
+		b = _mm256_loadu_si256( (const __m256i*)( i + k + 32 ) );
+
+		_mm256_storeu_si256(
+			(__m256i*)( o + k ), _mm256_shuffle_epi8( a, mask ) );
+		_mm256_storeu_si256(
+			(__m256i*)( o + k + 32 ), _mm256_shuffle_epi8( b, mask ) );
+	}
+
+	for( ; k + 32 <= n; k += 32 )
+	{
+		a = _mm256_loadu_si256( (const __m256i*)( i + k ) );
+
+		_mm256_storeu_si256(
+			(__m256i*)( o + k ), _mm256_shuffle_epi8( a, mask ) );
+	}
+
+	return k;
+}
+
+static const char k_mask32[16] =
+{3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12};
+
+static const char k_mask16[16] =
+{1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14};
+
+#endif /* PV_CPU_X86 */
+
+/* Does the CPU have instruction set ISA? */
+static int has_isa( int isa )
+{
+	static const unsigned need[] = { 0, PV_CPU_SSSE3, PV_CPU_AVX2 };
+
+	return isa >= PV_BSWAP_ISA_SCALAR && isa <= PV_BSWAP_ISA_AVX2 &&
+		( pv_cpu_isas( ) & need[isa] ) == need[isa];
+}
+
+/* The best instruction set the CPU has, chosen once, and the one forced by
+ * pv_bswap_isa(), if any */
+static int best_isa;
+static int forced_isa = -1;
+
+#ifndef PV_NO_THREADS
+static pthread_once_t best_once = PTHREAD_ONCE_INIT;
+#endif /* PV_NO_THREADS */
+
+static void choose_isa( void )
+{
+	int i;
+
+	/* Best first */
+	for( i = PV_BSWAP_ISA_AVX2; !has_isa( i ); --i )
+		;
+
+	best_isa = i;
+}
+
+/* The instruction set to use now */
+static int cur_isa( void )
+{
+#ifndef PV_NO_THREADS
+	pthread_once( &best_once, choose_isa );
+#else
+	static int chosen;
+
+	if( !chosen )
+	{
+		choose_isa( );
+		chosen = 1;
+	}
+#endif /* PV_NO_THREADS */
+
+	return forced_isa < 0 ? best_isa : forced_isa;
+}
+
+int pv_bswap_isa( int want )
+{
+	if( want == PV_BSWAP_ISA_BEST )
+	{
+		forced_isa = -1;
+
+		return cur_isa( );
+	}
+
+	forced_isa = has_isa( want ) ? want : PV_BSWAP_ISA_SCALAR;
+
+	return forced_isa;
+}
+
+/* Copy N bytes of values W bytes wide with the best kernel there is, and
+ * return how many bytes were done */
+static size_t bswap_kernel(
+	unsigned char* o, const unsigned char* i, size_t n, size_t w )
+{
+#ifdef PV_CPU_X86
+	const char* m;
+
+	m = w == 4 ? k_mask32 : k_mask16;
+
+	switch( cur_isa( ) )
+	{
+	case PV_BSWAP_ISA_AVX2:
+		return bswap_avx2( o, i, n, m );
+	case PV_BSWAP_ISA_SSSE3:
+		return bswap_ssse3( o, i, n, m );
+	default:
+		break;
+	}
+#else
+	(void)( o );
+	(void)( i );
+	(void)( n );
+	(void)( w );
+#endif /* PV_CPU_X86 */
+
+	return 0;
+}
+
+void pv_bswap32_n( void* o, const void* i, size_t n )
+{
+	unsigned char* d;
+	const unsigned char* s;
+	size_t k;
+
+	d = (unsigned char*)( o );
+	s = (const unsigned char*)( i );
+	k = bswap_kernel( d, s, n * 4, 4 );
+
+	bswap32_n( d + k, s + k, n - ( k / 4 ) );
+}
+
+void pv_bswap16_n( void* o, const void* i, size_t n )
+{
+	unsigned char* d;
+	const unsigned char* s;
+	size_t k;
+
+	d = (unsigned char*)( o );
+	s = (const unsigned char*)( i );
+	k = bswap_kernel( d, s, n * 2, 2 );
+
+	bswap16_n( d + k, s + k, n - ( k / 2 ) );
+}
+
+void pv_le32_n( void* o, const void* i, size_t n )
+{
+	unsigned char* d;
+	const unsigned char* s;
+	unsigned u;
+	size_t k;
+
+	if( host_le( ) )
+	{
+		memmove( o, i, n * 4 );
+
+		return;
+	}
+
+	d = (unsigned char*)( o );
+	s = (const unsigned char*)( i );
+
+	for( k = 0; k < n; ++k )
+	{
+		u = ( (unsigned)( s[3] ) << 24 ) | ( (unsigned)( s[2] ) << 16 ) |
+			( (unsigned)( s[1] ) << 8 ) | s[0];
+
+		memcpy( d, &u, 4 );
+		s += 4;
+		d += 4;
+	}
+}
+
+void pv_le16_n( void* o, const void* i, size_t n )
+{
+	unsigned char* d;
+	const unsigned char* s;
+	unsigned short u;
+	size_t k;
+
+	if( host_le( ) )
+	{
+		memmove( o, i, n * 2 );
+
+		return;
+	}
+
+	d = (unsigned char*)( o );
+	s = (const unsigned char*)( i );
+
+	for( k = 0; k < n; ++k )
+	{
+		u = (unsigned short)( ( s[1] << 8 ) | s[0] );
+
+		memcpy( d, &u, 2 );
+		s += 2;
+		d += 2;
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef INC__PVLIB_BSWAP_H
+#define INC__PVLIB_BSWAP_H
+
+#include <stddef.h>
+
+/* Copy N 32-bit values (uint32 or float32) from I to O, from big-endian to
+ * host order or back, which are the same thing. I may be O */
+void pv_bswap32_n( void*, const void*, size_t );
+
+/* As above, for 16-bit values */
+void pv_bswap16_n( void*, const void*, size_t );
+
+/* Copy N 32-bit values from little-endian to host order or back. I may be
+ * O */
+void pv_le32_n( void*, const void*, size_t );
+
+/* As above, for 16-bit values */
+void pv_le16_n( void*, const void*, size_t );
+
+/* Instruction sets for the copies */
+#define PV_BSWAP_ISA_BEST -1
+#define PV_BSWAP_ISA_SCALAR 0
+#define PV_BSWAP_ISA_SSSE3 1
+#define PV_BSWAP_ISA_AVX2 2
+
+/* Make the copies use instruction set ISA, or the best the CPU has with
+ * PV_BSWAP_ISA_BEST, which they otherwise pick once on first use. Returns the
+ * one they will use, which is the scalar code if the CPU lacks ISA. Not to be
+ * called while other threads copy */
+int pv_bswap_isa( int );
+
+#endif /* INC__PVLIB_BSWAP_H */
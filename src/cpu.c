@@ -0,0 +1,78 @@
+#include "cpu.h"
+
+#ifndef PV_NO_THREADS
+#include <pthread.h>
+#endif /* PV_NO_THREADS */
+
+#ifdef PV_CPU_X86
+
+#include <cpuid.h>
+
+static unsigned cpu_isas( void )
+{
+	unsigned a, b, c, d, xcr0, r;
+
+	r = 0;
+
+	if( !__get_cpuid( 1, &a, &b, &c, &d ) || !( d & bit_SSE2 ) )
+	{
+		return r;
+	}
+
+	r |= PV_CPU_SSE2;
+	r |= c & bit_SSSE3 ? PV_CPU_SSSE3 : 0;
+
+	/* The OS has to save the upper halves of the AVX registers too */
+	if( !( c & bit_OSXSAVE ) || !( c & bit_AVX ) )
+	{
+		return r;
+	}
+
+	__asm__( "xgetbv" : "=a"( xcr0 ), "=d"( d ) : "c"( 0 ) );
+
+	if( ( xcr0 & 6 ) != 6 )
+	{
+		return r;
+	}
+
+	r |= c & bit_F16C ? PV_CPU_F16C : 0;
+
+	if( __get_cpuid_count( 7, 0, &a, &b, &c, &d ) && ( b & bit_AVX2 ) )
+	{
+		r |= PV_CPU_AVX2;
+	}
+
+	return r;
+}
+
+#else
+
+static unsigned cpu_isas( void ) { return 0; }
+
+#endif /* PV_CPU_X86 */
+
+/* cpuid is slow enough to ask only once */
+static unsigned isas;
+
+#ifndef PV_NO_THREADS
+static pthread_once_t isas_once = PTHREAD_ONCE_INIT;
+#endif /* PV_NO_THREADS */
+
+static void ask_isas( void ) { isas = cpu_isas( ); }
+
+unsigned pv_cpu_isas( void )
+{
+#ifndef PV_NO_THREADS
+	pthread_once( &isas_once, ask_isas );
+#else
+	static int known;
+
+	if( !known )
+	{
+		ask_isas( );
+		known = 1;
+	}
+#endif /* PV_NO_THREADS */
+
+	return isas;
+}
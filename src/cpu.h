@@ -0,0 +1,20 @@
+#ifndef INC__PVLIB_CPU_H
+#define INC__PVLIB_CPU_H
+
+/* Builds that can have x86 vector kernels, compiled for their instruction
+ * sets with target attributes and picked at run time */
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define PV_CPU_X86
+#endif
+
+/* Instruction sets, as bits of pv_cpu_isas() */
+#define PV_CPU_SSE2 0x01
+#define PV_CPU_SSSE3 0x02
+#define PV_CPU_AVX2 0x04
+#define PV_CPU_F16C 0x08
+
+/* Which instruction sets the CPU has and the OS saves the registers of. None
+ * without PV_CPU_X86 */
+unsigned pv_cpu_isas( void );
+
+#endif /* INC__PVLIB_CPU_H */
@@ -1,4 +1,9 @@
 #include "float16.h"
+#include "cpu.h"
+
+#ifndef PV_NO_THREADS
+#include <pthread.h>
+#endif /* PV_NO_THREADS */
 
 #define PV_F16_SHIFT 13
 #define PV_F16_SHIFT_SIGN 16
@@ -40,7 +45,8 @@ struct pv_float16_impl
 	};
 };
 
-unsigned short pv_f16_32to16( float input )
+/* The conversions proper, kept static so the batch loops can inline them */
+static unsigned short f16_32to16( float input )
 {
 	struct pv_float16_impl v, s;
 	unsigned sign;
@@ -63,7 +69,7 @@ unsigned short pv_f16_32to16( float input )
 	return v.ui | sign;
 }
 
-float pv_f16_16to32( unsigned short input )
+static float f16_16to32( unsigned short input )
 {
 	struct pv_float16_impl v, s;
 	int sign, mask;
@@ -84,3 +90,389 @@ float pv_f16_16to32( unsigned short input )
 
 	return v.f;
 }
+
+unsigned short pv_f16_32to16( float input ) { return f16_32to16( input ); }
+
+float pv_f16_16to32( unsigned short input ) { return f16_16to32( input ); }
+
+static void f16_32to16_n( unsigned short* o, const float* i, size_t n )
+{
+	size_t k;
+
+	for( k = 0; k < n; ++k )
+	{
+		o[k] = f16_32to16( i[k] );
+	}
+}
+
+static void f16_16to32_n( float* o, const unsigned short* i, size_t n )
+{
+	size_t k;
+
+	for( k = 0; k < n; ++k )
+	{
+		o[k] = f16_16to32( i[k] );
+	}
+}
+
+#ifdef PV_CPU_X86
+
+#include <immintrin.h>
+
+#define PV_F16_SSE2 __attribute__( ( target( "sse2" ) ) )
+#define PV_F16_AVX2 __attribute__( ( target( "avx2" ) ) )
+#define PV_F16_F16C __attribute__( ( target( "avx,f16c" ) ) )
+
+/* The SSE2 and AVX2 kernels are the scalar conversions above a vector at a
+ * time, step for step, so they come out bit for bit the same. Comparisons
+ * give the masks the scalar code negates, and BLEND takes B where M is set */
+
+#define PV_F16_BLEND( A, B, M ) \
+	_mm_xor_si128( ( A ), _mm_and_si128( _mm_xor_si128( ( B ), ( A ) ), ( M ) ) )
+
+#define PV_F16_BLEND256( A, B, M ) \
+	_mm256_xor_si256( \
+		( A ), _mm256_and_si256( _mm256_xor_si256( ( B ), ( A ) ), ( M ) ) )
+
+#define PV_F16_K( X ) _mm_set1_epi32( (int)( X ) )
+#define PV_F16_K256( X ) _mm256_set1_epi32( (int)( X ) )
+
+PV_F16_SSE2 static __m128i f16_32to16_x4( __m128 f )
+{
+	__m128i v, s, sign, m;
+
+	v    = _mm_castps_si128( f );
+	sign = _mm_and_si128( v, PV_F16_K( PV_F16_SIGNN ) );
+	v    = _mm_xor_si128( v, sign );
+	sign = _mm_srli_epi32( sign, PV_F16_SHIFT_SIGN );
+	s    = _mm_cvttps_epi32( _mm_mul_ps(
+		   _mm_castsi128_ps( PV_F16_K( PV_F16_MULN ) ), _mm_castsi128_ps( v ) ) );
+	v = PV_F16_BLEND( v, s, _mm_cmpgt_epi32( PV_F16_K( PV_F16_MINN ), v ) );
+	m = _mm_and_si128( _mm_cmpgt_epi32( PV_F16_K( PV_F16_INFN ), v ),
+		_mm_cmpgt_epi32( v, PV_F16_K( PV_F16_MAXN ) ) );
+	v = PV_F16_BLEND( v, PV_F16_K( PV_F16_INFN ), m );
+	m = _mm_and_si128( _mm_cmpgt_epi32( PV_F16_K( PV_F16_NANN ), v ),
+		_mm_cmpgt_epi32( v, PV_F16_K( PV_F16_INFN ) ) );
+	v = PV_F16_BLEND( v, PV_F16_K( PV_F16_NANN ), m );
+	v = _mm_srli_epi32( v, PV_F16_SHIFT );
+	v = PV_F16_BLEND( v, _mm_sub_epi32( v, PV_F16_K( PV_F16_MAXD ) ),
+		_mm_cmpgt_epi32( v, PV_F16_K( PV_F16_MAXC ) ) );
+	v = PV_F16_BLEND( v, _mm_sub_epi32( v, PV_F16_K( PV_F16_MIND ) ),
+		_mm_cmpgt_epi32( v, PV_F16_K( PV_F16_SUBC ) ) );
+
+	return _mm_or_si128( v, sign );
+}
+
+PV_F16_SSE2 static __m128 f16_16to32_x4( __m128i v )
+{
+	__m128i sign, m;
+	__m128 s;
+
+	sign = _mm_and_si128( v, PV_F16_K( PV_F16_SIGNC ) );
+	v    = _mm_xor_si128( v, sign );
+	sign = _mm_slli_epi32( sign, PV_F16_SHIFT_SIGN );
+	v    = PV_F16_BLEND( v, _mm_add_epi32( v, PV_F16_K( PV_F16_MIND ) ),
+		   _mm_cmpgt_epi32( v, PV_F16_K( PV_F16_SUBC ) ) );
+	v    = PV_F16_BLEND( v, _mm_add_epi32( v, PV_F16_K( PV_F16_MAXD ) ),
+		   _mm_cmpgt_epi32( v, PV_F16_K( PV_F16_MAXC ) ) );
+	s    = _mm_mul_ps(
+		   _mm_castsi128_ps( PV_F16_K( PV_F16_MULC ) ), _mm_cvtepi32_ps( v ) );
+	m    = _mm_cmpgt_epi32( PV_F16_K( PV_F16_NORC ), v );
+	v    = _mm_slli_epi32( v, PV_F16_SHIFT );
+	v    = PV_F16_BLEND( v, _mm_castps_si128( s ), m );
+
+	return _mm_castsi128_ps( _mm_or_si128( v, sign ) );
+}
+
+/* The kernels do as many values as fill whole vectors, and return how many
+ * that was, leaving the rest to the scalar loops */
+
+PV_F16_SSE2 static size_t f16_32to16_sse2(
+	unsigned short* o, const float* i, size_t n )
+{
+	__m128i a, b;
+	size_t k;
+
+	for( k = 0; k + 8 <= n; k += 8 )
+	{
+		a = f16_32to16_x4( _mm_loadu_ps( i + k ) );
+		b = f16_32to16_x4( _mm_loadu_ps( i + k + 4 ) );
+
+		/* Sign extend the halves so they pack without saturating */
+		a = _mm_srai_epi32( _mm_slli_epi32( a, 16 ), 16 );
+		b = _mm_srai_epi32( _mm_slli_epi32( b, 16 ), 16 );
+
+		_mm_storeu_si128( (__m128i*)( o + k ), _mm_packs_epi32( a, b ) );
+	}
+
+	return k;
+}
+
+PV_F16_SSE2 static size_t f16_16to32_sse2(
+	float* o, const unsigned short* i, size_t n )
+{
+	__m128i h;
+	size_t k;
+
+	for( k = 0; k + 8 <= n; k += 8 )
+	{
+		h = _mm_loadu_si128( (const __m128i*)( i + k ) );
+
+		_mm_storeu_ps( o + k,
+			f16_16to32_x4( _mm_unpacklo_epi16( h, _mm_setzero_si128( ) ) ) );
+		_mm_storeu_ps( o + k + 4,
+			f16_16to32_x4( _mm_unpackhi_epi16( h, _mm_setzero_si128( ) ) ) );
+	}
+
+	return k;
+}
+
+PV_F16_AVX2 static size_t f16_32to16_avx2(
+	unsigned short* o, const float* i, size_t n )
+{
+	__m256i v, s, sign, m;
+	size_t k;
+
+	for( k = 0; k + 8 <= n; k += 8 )
+	{
+		v    = _mm256_castps_si256( _mm256_loadu_ps( i + k ) );
+		sign = _mm256_and_si256( v, PV_F16_K256( PV_F16_SIGNN ) );
+		v    = _mm256_xor_si256( v, sign );
+		sign = _mm256_srli_epi32( sign, PV_F16_SHIFT_SIGN );
+		s    = _mm256_cvttps_epi32(
+			   _mm256_mul_ps( _mm256_castsi256_ps( PV_F16_K256( PV_F16_MULN ) ),
+				   _mm256_castsi256_ps( v ) ) );
+		v    = PV_F16_BLEND256(
+			   v, s, _mm256_cmpgt_epi32( PV_F16_K256( PV_F16_MINN ), v ) );
+		m    = _mm256_and_si256(
+			   _mm256_cmpgt_epi32( PV_F16_K256( PV_F16_INFN ), v ),
+			   _mm256_cmpgt_epi32( v, PV_F16_K256( PV_F16_MAXN ) ) );
+		v    = PV_F16_BLEND256( v, PV_F16_K256( PV_F16_INFN ), m );
+		m    = _mm256_and_si256(
+			   _mm256_cmpgt_epi32( PV_F16_K256( PV_F16_NANN ), v ),
+			   _mm256_cmpgt_epi32( v, PV_F16_K256( PV_F16_INFN ) ) );
+		v    = PV_F16_BLEND256( v, PV_F16_K256( PV_F16_NANN ), m );
+		v    = _mm256_srli_epi32( v, PV_F16_SHIFT );
+		v    = PV_F16_BLEND256( v,
+			   _mm256_sub_epi32( v, PV_F16_K256( PV_F16_MAXD ) ),
+			   _mm256_cmpgt_epi32( v, PV_F16_K256( PV_F16_MAXC ) ) );
+		v    = PV_F16_BLEND256( v,
+			   _mm256_sub_epi32( v, PV_F16_K256( PV_F16_MIND ) ),
+			   _mm256_cmpgt_epi32( v, PV_F16_K256( PV_F16_SUBC ) ) );
+		v    = _mm256_or_si256( v, sign );
+
+		/* Packing works within each 128-bit lane, so gather the halves */
+		v = _mm256_permute4x64_epi64( _mm256_packus_epi32( v, v ), 0x08 );
+
+		_mm_storeu_si128(
+			(__m128i*)( o + k ), _mm256_castsi256_si128( v ) );
+	}
+
+	return k;
+}
+
+PV_F16_AVX2 static size_t f16_16to32_avx2(
+	float* o, const unsigned short* i, size_t n )
+{
+	__m256i v, sign, m;
+	__m256 s;
+	size_t k;
+
+	for( k = 0; k + 8 <= n; k += 8 )
+	{
+		v    = _mm256_cvtepu16_epi32(
+			   _mm_loadu_si128( (const __m128i*)( i + k ) ) );
+		sign = _mm256_and_si256( v, PV_F16_K256( PV_F16_SIGNC ) );
+		v    = _mm256_xor_si256( v, sign );
+		sign = _mm256_slli_epi32( sign, PV_F16_SHIFT_SIGN );
+		v    = PV_F16_BLEND256( v,
+			   _mm256_add_epi32( v, PV_F16_K256( PV_F16_MIND ) ),
+			   _mm256_cmpgt_epi32( v, PV_F16_K256( PV_F16_SUBC ) ) );
+		v    = PV_F16_BLEND256( v,
+			   _mm256_add_epi32( v, PV_F16_K256( PV_F16_MAXD ) ),
+			   _mm256_cmpgt_epi32( v, PV_F16_K256( PV_F16_MAXC ) ) );
+		s    = _mm256_mul_ps( _mm256_castsi256_ps( PV_F16_K256( PV_F16_MULC ) ),
+			   _mm256_cvtepi32_ps( v ) );
+		m    = _mm256_cmpgt_epi32( PV_F16_K256( PV_F16_NORC ), v );
+		v    = _mm256_slli_epi32( v, PV_F16_SHIFT );
+		v    = PV_F16_BLEND256( v, _mm256_castps_si256( s ), m );
+
+		_mm256_storeu_ps(
+			o + k, _mm256_castsi256_ps( _mm256_or_si256( v, sign ) ) );
+	}
+
+	return k;
+}
+
+/* The F16C instructions round towards zero as the scalar code does, but turn
+ * values past the largest half into it rather than infinity, and quieten
+ * NaNs. Vectors holding any such value are left to the scalar code */
+
+PV_F16_F16C static size_t f16_32to16_f16c(
+	unsigned short* o, const float* i, size_t n )
+{
+	__m256 f, big;
+	size_t k;
+
+	big = _mm256_castsi256_ps( _mm256_set1_epi32( PV_F16_MAXN ) );
+
+	for( k = 0; k + 8 <= n; k += 8 )
+	{
+		f = _mm256_loadu_ps( i + k );
+
+		/* Unordered, so NaNs count too */
+		if( _mm256_movemask_ps( _mm256_cmp_ps(
+				_mm256_andnot_ps( _mm256_set1_ps( -0.0f ), f ), big,
+				_CMP_NLE_UQ ) ) )
+		{
+			f16_32to16_n( o + k, i + k, 8 );
+
+			continue;
+		}
+
+		_mm_storeu_si128(
+			(__m128i*)( o + k ), _mm256_cvtps_ph( f, _MM_FROUND_TO_ZERO ) );
+	}
+
+	return k;
+}
+
+PV_F16_F16C static size_t f16_16to32_f16c(
+	float* o, const unsigned short* i, size_t n )
+{
+	__m128i h, nan;
+	size_t k;
+
+	for( k = 0; k + 8 <= n; k += 8 )
+	{
+		h   = _mm_loadu_si128( (const __m128i*)( i + k ) );
+		nan = _mm_cmpgt_epi16(
+			_mm_and_si128( h, _mm_set1_epi16( 0x7FFF ) ), _mm_set1_epi16( 0x7C00 ) );
+
+		if( _mm_movemask_epi8( nan ) )
+		{
+			f16_16to32_n( o + k, i + k, 8 );
+
+			continue;
+		}
+
+		_mm256_storeu_ps( o + k, _mm256_cvtph_ps( h ) );
+	}
+
+	return k;
+}
+
+#endif /* PV_CPU_X86 */
+
+/* Does the CPU have instruction set ISA? */
+static int has_isa( int isa )
+{
+	static const unsigned need[] = { 0, PV_CPU_SSE2, PV_CPU_AVX2, PV_CPU_F16C };
+
+	return isa >= PV_F16_ISA_SCALAR && isa <= PV_F16_ISA_F16C &&
+		( pv_cpu_isas( ) & need[isa] ) == need[isa];
+}
+
+/* The best instruction set the CPU has, chosen once, and the one forced by
+ * pv_f16_isa(), if any */
+static int best_isa;
+static int forced_isa = -1;
+
+#ifndef PV_NO_THREADS
+static pthread_once_t best_once = PTHREAD_ONCE_INIT;
+#endif /* PV_NO_THREADS */
+
+static void choose_isa( void )
+{
+	int i;
+
+	/* Best first */
+	for( i = PV_F16_ISA_F16C; !has_isa( i ); --i )
+		;
+
+	best_isa = i;
+}
+
+/* The instruction set to use now */
+static int cur_isa( void )
+{
+#ifndef PV_NO_THREADS
+	pthread_once( &best_once, choose_isa );
+#else
+	static int chosen;
+
+	if( !chosen )
+	{
+		choose_isa( );
+		chosen = 1;
+	}
+#endif /* PV_NO_THREADS */
+
+	return forced_isa < 0 ? best_isa : forced_isa;
+}
+
+int pv_f16_isa( int want )
+{
+	if( want == PV_F16_ISA_BEST )
+	{
+		forced_isa = -1;
+
+		return cur_isa( );
+	}
+
+	forced_isa = has_isa( want ) ? want : PV_F16_ISA_SCALAR;
+
+	return forced_isa;
+}
+
+void pv_f16_32to16_n( unsigned short* o, const float* i, size_t n )
+{
+	size_t k;
+
+	k = 0;
+
+#ifdef PV_CPU_X86
+	switch( cur_isa( ) )
+	{
+	case PV_F16_ISA_F16C:
+		k = f16_32to16_f16c( o, i, n );
+		break;
+	case PV_F16_ISA_AVX2:
+		k = f16_32to16_avx2( o, i, n );
+		break;
+	case PV_F16_ISA_SSE2:
+		k = f16_32to16_sse2( o, i, n );
+		break;
+	default:
+		break;
+	}
+#endif /* PV_CPU_X86 */
+
+	f16_32to16_n( o + k, i + k, n - k );
+}
+
+void pv_f16_16to32_n( float* o, const unsigned short* i, size_t n )
+{
+	size_t k;
+
+	k = 0;
+
+#ifdef PV_CPU_X86
+	switch( cur_isa( ) )
+	{
+	case PV_F16_ISA_F16C:
+		k = f16_16to32_f16c( o, i, n );
+		break;
+	case PV_F16_ISA_AVX2:
+		k = f16_16to32_avx2( o, i, n );
+		break;
+	case PV_F16_ISA_SSE2:
+		k = f16_16to32_sse2( o, i, n );
+		break;
+	default:
+		break;
+	}
+#endif /* PV_CPU_X86 */
+
+	f16_16to32_n( o + k, i + k, n - k );
+}
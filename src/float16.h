@@ -1,7 +1,27 @@
 #ifndef INC__PVLIB_FLOAT16_H
 #define INC__PVLIB_FLOAT16_H
 
+#include <stddef.h>
+
 unsigned short pv_f16_32to16( float );
 float pv_f16_16to32( unsigned short );
 
+/* As above, for N values at a time from I to O, with whichever instruction
+ * set pv_f16_isa() chose. Results are the same bit for bit with any of them */
+void pv_f16_32to16_n( unsigned short*, const float*, size_t );
+void pv_f16_16to32_n( float*, const unsigned short*, size_t );
+
+/* Instruction sets for the batch conversions */
+#define PV_F16_ISA_BEST -1
+#define PV_F16_ISA_SCALAR 0
+#define PV_F16_ISA_SSE2 1
+#define PV_F16_ISA_AVX2 2
+#define PV_F16_ISA_F16C 3
+
+/* Make the batch conversions use instruction set ISA, or the best the CPU has
+ * with PV_F16_ISA_BEST, which they otherwise pick once on first use. Returns
+ * the one they will use, which is the scalar code if the CPU lacks ISA. Not
+ * to be called while other threads convert */
+int pv_f16_isa( int );
+
 #endif /* INC__PVLIB_FLOAT16_H */
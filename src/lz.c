@@ -0,0 +1,905 @@
+#include "lz.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Literal/length and distance alphabet sizes */
+#define LZ_NLIT 285
+#define LZ_NDIST 32
+
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_MATCH 258
+
+/* Longest code, and how many bits of codes the decoder looks up at once */
+#define LZ_MAX_BITS 15
+#define LZ_FAST_BITS 10
+
+/* Match finder: hash table size, and how far along each chain it looks */
+#define LZ_HASH_BITS 15
+#define LZ_CHAIN 48
+
+/* Stop looking once a match is this long */
+#define LZ_NICE 128
+
+static const unsigned short k_len_base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11,
+	13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163,
+	195, 227, 258};
+
+static const unsigned char k_len_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+	1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+static const unsigned short k_dist_base[LZ_NDIST] = {1, 2, 3, 4, 5, 7, 9,
+	13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537,
+	2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577, 32769, 49153};
+
+static const unsigned char k_dist_extra[LZ_NDIST] = {0, 0, 0, 0, 1, 1, 2,
+	2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13,
+	13, 14, 14};
+
+/* Index of the highest set bit of a nonzero U */
+static int top_bit( unsigned u )
+{
+	int k;
+
+	for( k = 0; u > 1; u >>= 1 )
+	{
+		k++;
+	}
+
+	return k;
+}
+
+/* Length code for a match of length LEN */
+static int len_code( unsigned len )
+{
+	unsigned l;
+	int k;
+
+	l = len - LZ_MIN_MATCH;
+
+	if( l < 8 )
+	{
+		return l;
+	}
+
+	if( len == LZ_MAX_MATCH )
+	{
+		return 28;
+	}
+
+	k = top_bit( l );
+
+	return ( ( k - 1 ) * 4 ) + ( ( l >> ( k - 2 ) ) & 3 );
+}
+
+/* Distance code for a match DIST bytes back */
+static int dist_code( unsigned dist )
+{
+	unsigned d;
+	int k;
+
+	d = dist - 1;
+
+	if( d < 4 )
+	{
+		return d;
+	}
+
+	k = top_bit( d );
+
+	return ( k * 2 ) + ( ( d >> ( k - 1 ) ) & 1 );
+}
+
+/* Reverse the low N bits of U */
+static unsigned rev_bits( unsigned u, int n )
+{
+	unsigned r;
+
+	for( r = 0; n > 0; --n, u >>= 1 )
+	{
+		r = ( r << 1 ) | ( u & 1 );
+	}
+
+	return r;
+}
+
+/* -------------------------------------------------------------------------
+ * Packing */
+
+struct huff_node
+{
+	unsigned long f;
+	int s;
+};
+
+static int cmp_nodes( const void* a, const void* b )
+{
+	const struct huff_node *x, *y;
+
+	x = (const struct huff_node*)( a );
+	y = (const struct huff_node*)( b );
+
+	if( x->f != y->f )
+	{
+		return x->f < y->f ? -1 : 1;
+	}
+
+	return x->s - y->s;
+}
+
+/* Work out code lengths of no more than LZ_MAX_BITS for N symbols with
+ * frequencies F, which it may scale down on the way */
+static void huff_lengths( unsigned long* f, int n, unsigned char* len )
+{
+	struct huff_node leaf[LZ_NLIT];
+	unsigned long w[LZ_NLIT];
+	int parent[LZ_NLIT * 2], depth[LZ_NLIT * 2];
+	int i, ct, li, ni, nn, a, b, deep;
+
+	for( ;; )
+	{
+		memset( len, 0, n );
+
+		for( i = 0, ct = 0; i < n; ++i )
+		{
+			if( f[i] )
+			{
+				leaf[ct].f = f[i];
+				leaf[ct].s = i;
+				ct++;
+			}
+		}
+
+		if( ct == 0 )
+		{
+			return;
+		}
+
+		if( ct == 1 )
+		{
+			len[leaf[0].s] = 1;
+
+			return;
+		}
+
+		qsort( leaf, ct, sizeof( struct huff_node ), cmp_nodes );
+
+		/* Leaves are nodes 0 to ct - 1 in order, and the nodes merged from
+		 * them follow, which come out in order too */
+		li = 0;
+		ni = 0;
+
+		for( nn = 0; nn < ct - 1; ++nn )
+		{
+			/* Take the two lightest of either queue */
+			if( li < ct && ( ni >= nn || leaf[li].f <= w[ni] ) )
+			{
+				a = li++;
+			}
+			else
+			{
+				a = ct + ni++;
+			}
+
+			if( li < ct && ( ni >= nn || leaf[li].f <= w[ni] ) )
+			{
+				b = li++;
+			}
+			else
+			{
+				b = ct + ni++;
+			}
+
+			w[nn] = ( a < ct ? leaf[a].f : w[a - ct] ) +
+				( b < ct ? leaf[b].f : w[b - ct] );
+			parent[a] = ct + nn;
+			parent[b] = ct + nn;
+		}
+
+		/* The root is the last node merged */
+		depth[( ct * 2 ) - 2] = 0;
+		deep                  = 0;
+
+		for( i = ( ct * 2 ) - 3; i >= 0; --i )
+		{
+			depth[i] = depth[parent[i]] + 1;
+		}
+
+		for( i = 0; i < ct; ++i )
+		{
+			len[leaf[i].s] = depth[i];
+			deep           = depth[i] > deep ? depth[i] : deep;
+		}
+
+		if( deep <= LZ_MAX_BITS )
+		{
+			return;
+		}
+
+		/* Flatten the frequencies and go again */
+		for( i = 0; i < n; ++i )
+		{
+			f[i] = f[i] ? ( f[i] >> 1 ) | 1 : 0;
+		}
+	}
+}
+
+/* Canonical codes for N symbols of lengths LEN, reversed for writing */
+static void huff_codes(
+	const unsigned char* len, int n, unsigned short* code )
+{
+	unsigned short next[LZ_MAX_BITS + 1];
+	unsigned ct[LZ_MAX_BITS + 1];
+	unsigned c;
+	int i;
+
+	memset( ct, 0, sizeof( ct ) );
+
+	for( i = 0; i < n; ++i )
+	{
+		ct[len[i]]++;
+	}
+
+	ct[0] = 0;
+	c     = 0;
+
+	for( i = 1; i <= LZ_MAX_BITS; ++i )
+	{
+		c       = ( c + ct[i - 1] ) << 1;
+		next[i] = c;
+	}
+
+	for( i = 0; i < n; ++i )
+	{
+		code[i] = len[i] ? rev_bits( next[len[i]]++, len[i] ) : 0;
+	}
+}
+
+struct bit_wr
+{
+	unsigned char* o;
+	size_t n, cap;
+	unsigned long buf;
+	int ct;
+	/* did it run out of room? */
+	int full;
+};
+
+/* Put the low N bits of U, N being no more than 16 */
+static void put_bits( struct bit_wr* w, unsigned u, int n )
+{
+	if( w->full )
+	{
+		return;
+	}
+
+	w->buf |= (unsigned long)( u ) << w->ct;
+	w->ct += n;
+
+	for( ; w->ct >= 8; w->ct -= 8, w->buf >>= 8 )
+	{
+		if( w->n == w->cap )
+		{
+			w->full = 1;
+
+			return;
+		}
+
+		w->o[w->n++] = w->buf & 0xFF;
+	}
+}
+
+/* Put the code lengths for N symbols, with runs of zeros */
+static void put_lengths( struct bit_wr* w, const unsigned char* len, int n )
+{
+	int i, run;
+
+	for( i = 0; i < n; )
+	{
+		put_bits( w, len[i], 4 );
+
+		if( len[i] )
+		{
+			i++;
+
+			continue;
+		}
+
+		for( run = 1; run < 16 && i + run < n && !len[i + run]; ++run )
+			;
+
+		put_bits( w, run - 1, 4 );
+		i += run;
+	}
+}
+
+/* Matches found in a block: each is a literal byte, or 256 plus the length
+ * less LZ_MIN_MATCH along with the distance less one */
+struct tokens
+{
+	unsigned short* sym;
+	unsigned short* dist;
+	size_t ct;
+};
+
+static unsigned hash3( const unsigned char* p )
+{
+	unsigned long h;
+
+	h = ( (unsigned long)( p[0] ) << 16 ) | ( p[1] << 8 ) | p[2];
+
+	return ( ( h * 0x9E3779B1UL ) & 0xFFFFFFFFUL ) >> ( 32 - LZ_HASH_BITS );
+}
+
+/* Longest match for position I of the N bytes at B, which has its length
+ * returned and distance put in *DIST. HEAD and PREV chain the earlier
+ * positions with the same hash */
+static unsigned find_match( const unsigned char* b, size_t n, size_t i,
+	const int* head, const int* prev, unsigned* dist )
+{
+	const unsigned char *p, *q;
+	unsigned best, l, max;
+	int cand, chain;
+
+	max  = n - i < LZ_MAX_MATCH ? n - i : LZ_MAX_MATCH;
+	best = 0;
+
+	if( max < LZ_MIN_MATCH )
+	{
+		return 0;
+	}
+
+	p    = b + i;
+	cand = head[hash3( p )];
+
+	for( chain = LZ_CHAIN; cand >= 0 && chain > 0; --chain )
+	{
+		q = b + cand;
+
+		/* The byte that would make it longer goes first */
+		if( q[best] == p[best] && q[0] == p[0] && q[1] == p[1] )
+		{
+			for( l = 2; l < max && q[l] == p[l]; ++l )
+				;
+
+			if( l > best )
+			{
+				best  = l;
+				*dist = p - q;
+
+				if( l >= LZ_NICE || l == max )
+				{
+					break;
+				}
+			}
+		}
+
+		cand = prev[cand];
+	}
+
+	return best >= LZ_MIN_MATCH ? best : 0;
+}
+
+/* Find the matches of N bytes at B, choosing lazily: a match is put off by a
+ * byte if the next position has a longer one */
+static void find_tokens( const unsigned char* b, size_t n, int* head,
+	int* prev, struct tokens* t )
+{
+	unsigned l, d, nl, nd;
+	size_t i, k, h;
+
+	for( h = 0; h < ( 1 << LZ_HASH_BITS ); ++h )
+	{
+		head[h] = -1;
+	}
+
+	t->ct = 0;
+	l     = 0;
+	d     = 0;
+
+	for( i = 0; i < n; )
+	{
+		if( !l )
+		{
+			l = find_match( b, n, i, head, prev, &d );
+		}
+
+		if( i + LZ_MIN_MATCH <= n )
+		{
+			h       = hash3( b + i );
+			prev[i] = head[h];
+			head[h] = i;
+		}
+
+		nl = 0;
+
+		if( l && l < LZ_NICE && i + 1 < n )
+		{
+			nl = find_match( b, n, i + 1, head, prev, &nd );
+		}
+
+		if( !l || nl > l )
+		{
+			t->sym[t->ct]  = b[i];
+			t->dist[t->ct] = 0;
+			t->ct++;
+			i++;
+			l = nl;
+			d = nd;
+
+			continue;
+		}
+
+		t->sym[t->ct]  = 256 + l - LZ_MIN_MATCH;
+		t->dist[t->ct] = d - 1;
+		t->ct++;
+
+		/* Chain up the positions the match covers */
+		for( k = 1; k < l; ++k )
+		{
+			if( i + k + LZ_MIN_MATCH <= n )
+			{
+				h           = hash3( b + i + k );
+				prev[i + k] = head[h];
+				head[h]     = i + k;
+			}
+		}
+
+		i += l;
+		l = 0;
+	}
+}
+
+int pv_lz_pack( const void* i, size_t n, void* o, size_t* s )
+{
+	unsigned long lit_f[LZ_NLIT], dist_f[LZ_NDIST];
+	unsigned char lit_l[LZ_NLIT], dist_l[LZ_NDIST];
+	unsigned short lit_c[LZ_NLIT], dist_c[LZ_NDIST];
+	const unsigned char* b;
+	struct tokens t;
+	struct bit_wr w;
+	unsigned sym, v;
+	size_t k;
+	int *head, *prev, c;
+
+	if( n > PV_LZ_BLOCK_SZ )
+	{
+		return -1;
+	}
+
+	b = (const unsigned char*)( i );
+
+	/* HEAP ALLOC */
+	head   = malloc( sizeof( int ) * ( 1 << LZ_HASH_BITS ) );
+	prev   = malloc( sizeof( int ) * ( n ? n : 1 ) );
+	t.sym  = malloc( sizeof( unsigned short ) * ( n ? n : 1 ) );
+	t.dist = malloc( sizeof( unsigned short ) * ( n ? n : 1 ) );
+
+	/* OoM check */
+	if( !head || !prev || !( t.sym ) || !( t.dist ) )
+	{
+		free( head );
+		free( prev );
+		free( t.sym );
+		free( t.dist );
+
+		return -2;
+	}
+
+	find_tokens( b, n, head, prev, &t );
+
+	free( head );
+	free( prev );
+
+	memset( lit_f, 0, sizeof( lit_f ) );
+	memset( dist_f, 0, sizeof( dist_f ) );
+
+	for( k = 0; k < t.ct; ++k )
+	{
+		if( t.sym[k] < 256 )
+		{
+			lit_f[t.sym[k]]++;
+
+			continue;
+		}
+
+		lit_f[256 + len_code( t.sym[k] - 256 + LZ_MIN_MATCH )]++;
+		dist_f[dist_code( t.dist[k] + 1 )]++;
+	}
+
+	huff_lengths( lit_f, LZ_NLIT, lit_l );
+	huff_lengths( dist_f, LZ_NDIST, dist_l );
+	huff_codes( lit_l, LZ_NLIT, lit_c );
+	huff_codes( dist_l, LZ_NDIST, dist_c );
+
+	w.o    = (unsigned char*)( o );
+	w.n    = 0;
+	w.cap  = *s;
+	w.buf  = 0;
+	w.ct   = 0;
+	w.full = 0;
+
+	put_lengths( &w, lit_l, LZ_NLIT );
+	put_lengths( &w, dist_l, LZ_NDIST );
+
+	for( k = 0; k < t.ct && !( w.full ); ++k )
+	{
+		sym = t.sym[k];
+
+		if( sym < 256 )
+		{
+			put_bits( &w, lit_c[sym], lit_l[sym] );
+
+			continue;
+		}
+
+		v = sym - 256 + LZ_MIN_MATCH;
+		c = len_code( v );
+		put_bits( &w, lit_c[256 + c], lit_l[256 + c] );
+		put_bits( &w, v - k_len_base[c], k_len_extra[c] );
+
+		v = t.dist[k] + 1;
+		c = dist_code( v );
+		put_bits( &w, dist_c[c], dist_l[c] );
+		put_bits( &w, v - k_dist_base[c], k_dist_extra[c] );
+	}
+
+	/* Pad out the last byte */
+	put_bits( &w, 0, 7 );
+
+	free( t.sym );
+	free( t.dist );
+
+	if( w.full )
+	{
+		return -4;
+	}
+
+	*s = w.n;
+
+	return 0;
+}
+
+/* -------------------------------------------------------------------------
+ * Unpacking */
+
+struct bit_rd
+{
+	const unsigned char* d;
+	size_t i, n;
+	unsigned long buf;
+	int ct;
+};
+
+/* Have at least 25 bits ready, reading zeros past the end */
+static void refill( struct bit_rd* r )
+{
+	/* Away from the end, there is no need to check for it */
+	if( r->n - r->i >= 4 && r->i <= r->n )
+	{
+		for( ; r->ct <= 24; r->ct += 8, r->i++ )
+		{
+			r->buf |= (unsigned long)( r->d[r->i] ) << r->ct;
+		}
+
+		return;
+	}
+
+	for( ; r->ct <= 24; r->ct += 8, r->i++ )
+	{
+		r->buf |= (unsigned long)( r->i < r->n ? r->d[r->i] : 0 ) << r->ct;
+	}
+}
+
+/* Take N bits, of those made ready */
+static unsigned get_bits( struct bit_rd* r, int n )
+{
+	unsigned u;
+
+	u = r->buf & ( ( 1UL << n ) - 1 );
+	r->buf >>= n;
+	r->ct -= n;
+
+	return u;
+}
+
+/* A decoding table: codes of up to LZ_FAST_BITS are looked up straight off
+ * the next bits, with the symbol above and the length in the low 4 bits,
+ * and longer ones are worked out from how many codes there are of each
+ * length, as canonical codes allow */
+struct huff_tbl
+{
+	unsigned short fast[1 << LZ_FAST_BITS];
+	unsigned short ct[LZ_MAX_BITS + 1];
+	unsigned short sym[LZ_NLIT];
+};
+
+static int read_lengths( struct bit_rd* r, unsigned char* len, int n )
+{
+	int i, run;
+
+	for( i = 0; i < n; )
+	{
+		refill( r );
+		len[i] = get_bits( r, 4 );
+
+		if( len[i] )
+		{
+			i++;
+
+			continue;
+		}
+
+		run = get_bits( r, 4 ) + 1;
+
+		if( run > n - i )
+		{
+			return -3;
+		}
+
+		memset( len + i, 0, run );
+		i += run;
+	}
+
+	return 0;
+}
+
+static int build_tbl( struct huff_tbl* t, const unsigned char* len, int n )
+{
+	unsigned short offs[LZ_MAX_BITS + 1], code[LZ_NLIT];
+	long left;
+	unsigned k;
+	int i;
+
+	memset( t->ct, 0, sizeof( t->ct ) );
+
+	for( i = 0; i < n; ++i )
+	{
+		t->ct[len[i]]++;
+	}
+
+	t->ct[0] = 0;
+	left     = 1;
+
+	/* Too many codes of some length cannot be told apart; too few just
+	 * leave some bit patterns that decode to nothing */
+	for( i = 1; i <= LZ_MAX_BITS; ++i )
+	{
+		left = ( left << 1 ) - t->ct[i];
+
+		if( left < 0 )
+		{
+			return -3;
+		}
+	}
+
+	offs[1] = 0;
+
+	for( i = 1; i < LZ_MAX_BITS; ++i )
+	{
+		offs[i + 1] = offs[i] + t->ct[i];
+	}
+
+	for( i = 0; i < n; ++i )
+	{
+		if( len[i] )
+		{
+			t->sym[offs[len[i]]++] = i;
+		}
+	}
+
+	huff_codes( len, n, code );
+	memset( t->fast, 0, sizeof( t->fast ) );
+
+	for( i = 0; i < n; ++i )
+	{
+		if( !len[i] || len[i] > LZ_FAST_BITS )
+		{
+			continue;
+		}
+
+		for( k = code[i]; k < ( 1 << LZ_FAST_BITS ); k += 1 << len[i] )
+		{
+			t->fast[k] = ( i << 4 ) | len[i];
+		}
+	}
+
+	return 0;
+}
+
+/* Decode a symbol off the low bits of BUF, which are at least LZ_MAX_BITS,
+ * putting its length in *L. Returns -1 for bits that are no code */
+static int decode_sym( const struct huff_tbl* t, unsigned long buf, int* l )
+{
+	unsigned e;
+	int code, first, idx;
+
+	e = t->fast[buf & ( ( 1 << LZ_FAST_BITS ) - 1 )];
+
+	if( e )
+	{
+		*l = e & 0xF;
+
+		return e >> 4;
+	}
+
+	/* A bit at a time, most significant first */
+	code  = 0;
+	first = 0;
+	idx   = 0;
+
+	for( *l = 1; *l <= LZ_MAX_BITS; ++( *l ), buf >>= 1 )
+	{
+		code |= buf & 1;
+
+		if( code - first < t->ct[*l] )
+		{
+			return t->sym[idx + ( code - first )];
+		}
+
+		idx += t->ct[*l];
+		first = ( first + t->ct[*l] ) << 1;
+		code <<= 1;
+	}
+
+	return -1;
+}
+
+/* As refill, on a bit reader held in locals, which the compiler cannot keep
+ * in registers once their address is taken, as the bytes written out might
+ * then be any of them */
+#define LZ_REFILL( D, N, AT, BUF, CT ) \
+	do \
+	{ \
+		if( ( N ) - ( AT ) >= 4 && ( AT ) <= ( N ) ) \
+		{ \
+			for( ; ( CT ) <= 24; ( CT ) += 8 ) \
+			{ \
+				( BUF ) |= (unsigned long)( ( D )[( AT )++] ) << ( CT ); \
+			} \
+		} \
+		else \
+		{ \
+			for( ; ( CT ) <= 24; ( CT ) += 8, ( AT )++ ) \
+			{ \
+				( BUF ) |= \
+					(unsigned long)( ( AT ) < ( N ) ? ( D )[( AT )] : 0 ) \
+					<< ( CT ); \
+			} \
+		} \
+	} while( 0 )
+
+/* Decode the symbols after the code lengths, from R into the S bytes at O */
+static int unpack_syms( struct bit_rd* r, const struct huff_tbl* lit,
+	const struct huff_tbl* dist, unsigned char* o, size_t s )
+{
+	const unsigned char* d;
+	unsigned char *p, *end;
+	unsigned long buf;
+	unsigned len, k;
+	size_t n, at;
+	int ct, sym, l;
+
+	d   = r->d;
+	n   = r->n;
+	at  = r->i;
+	buf = r->buf;
+	ct  = r->ct;
+	p   = o;
+	end = o + s;
+
+	while( p < end )
+	{
+		LZ_REFILL( d, n, at, buf, ct );
+		sym = decode_sym( lit, buf, &l );
+
+		if( sym < 0 )
+		{
+			return -3;
+		}
+
+		buf >>= l;
+		ct -= l;
+
+		if( sym < 256 )
+		{
+			*p++ = sym;
+
+			continue;
+		}
+
+		/* Codes and extra bits of lengths take no more than 20 bits */
+		sym -= 256;
+		l   = k_len_extra[sym];
+		len = k_len_base[sym] + ( buf & ( ( 1UL << l ) - 1 ) );
+		buf >>= l;
+		ct -= l;
+
+		LZ_REFILL( d, n, at, buf, ct );
+		sym = decode_sym( dist, buf, &l );
+
+		if( sym < 0 )
+		{
+			return -3;
+		}
+
+		buf >>= l;
+		ct -= l;
+
+		LZ_REFILL( d, n, at, buf, ct );
+		l = k_dist_extra[sym];
+		k = k_dist_base[sym] + ( buf & ( ( 1UL << l ) - 1 ) );
+		buf >>= l;
+		ct -= l;
+
+		if( k > (size_t)( p - o ) || len > (size_t)( end - p ) )
+		{
+			return -3;
+		}
+
+		/* Matches may overlap themselves, so go a byte at a time when
+		 * they do */
+		if( k >= len )
+		{
+			memcpy( p, p - k, len );
+			p += len;
+
+			continue;
+		}
+
+		for( ; len > 0; --len, ++p )
+		{
+			*p = *( p - k );
+		}
+	}
+
+	r->i   = at;
+	r->buf = buf;
+	r->ct  = ct;
+
+	return 0;
+}
+
+int pv_lz_unpack( const void* i, size_t n, void* o, size_t s )
+{
+	unsigned char lit_l[LZ_NLIT], dist_l[LZ_NDIST];
+	struct huff_tbl *lit, *dist;
+	struct bit_rd r;
+	int ret;
+
+	/* HEAP ALLOC */
+	lit  = malloc( sizeof( struct huff_tbl ) );
+	dist = malloc( sizeof( struct huff_tbl ) );
+
+	/* OoM check */
+	if( !lit || !dist )
+	{
+		free( lit );
+		free( dist );
+
+		return -2;
+	}
+
+	r.d   = (const unsigned char*)( i );
+	r.i   = 0;
+	r.n   = n;
+	r.buf = 0;
+	r.ct  = 0;
+
+	ret = read_lengths( &r, lit_l, LZ_NLIT );
+	ret = ret ? ret : read_lengths( &r, dist_l, LZ_NDIST );
+	ret = ret ? ret : build_tbl( lit, lit_l, LZ_NLIT );
+	ret = ret ? ret : build_tbl( dist, dist_l, LZ_NDIST );
+	ret = ret ? ret : unpack_syms( &r, lit, dist, (unsigned char*)( o ), s );
+
+	/* Anything read past the end was made up */
+	if( !ret && ( r.i * 8 ) - r.ct > n * 8 )
+	{
+		ret = -3;
+	}
+
+	free( lit );
+	free( dist );
+
+	return ret;
+}
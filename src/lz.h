@@ -0,0 +1,30 @@
+#ifndef INC__PVLIB_LZ_H
+#define INC__PVLIB_LZ_H
+
+#include <stddef.h>
+
+/* Most bytes packed or unpacked in one go */
+#define PV_LZ_BLOCK_SZ 0x10000
+
+/*
+ * Blocks are packed as LZ77 matches within the block, Huffman coded, and read
+ * a bit at a time from the least significant bit of each byte up. They begin
+ * with the code lengths of the 285 literal/length symbols (0-255 literal
+ * bytes, 256-284 lengths 3 to 258, as in DEFLATE), then those of the 32
+ * distance symbols (distances 1 to 65536, as in Deflate64). Each length is
+ * 4 bits; a zero length is followed by 4 more bits of zeros to repeat. Then
+ * come the symbols, with the DEFLATE extra bits after each length and
+ * distance code, up to the unpacked size, which is known beforehand. Codes
+ * are canonical, and written most significant bit first.
+ */
+
+/* Pack N bytes from I into O, which has room for *S bytes; on success, set
+ * *S to the packed size. Returns -4 if they do not fit, and -2 if out of
+ * memory */
+int pv_lz_pack( const void*, size_t, void*, size_t* );
+
+/* Unpack N bytes from I into exactly S bytes at O. Returns -3 if the packed
+ * bytes are bad or run short */
+int pv_lz_unpack( const void*, size_t, void*, size_t );
+
+#endif /* INC__PVLIB_LZ_H */
@@ -262,7 +262,11 @@ void nsvgDelete( struct NSVGimage* image );
 #define NSVG_INLINE inline
 #endif
 
-static int nsvg__isspace( char c ) { return strchr( " \t\n\v\f\r", c ) != 0; }
+/* Like strchr( " \t\n\v\f\r", c ), the terminator counts as space too */
+static int nsvg__isspace( char c )
+{
+	return c == ' ' || ( c >= '\t' && c <= '\r' ) || c == '\0';
+}
 
 static int nsvg__isdigit( char c ) { return c >= '0' && c <= '9'; }
 
@@ -283,16 +287,131 @@ static float nsvg__maxf( float a, float b )
 
 /* Simple XML parser */
 
-#define NSVG_XML_TAG 1
-#define NSVG_XML_CONTENT 2
 #define NSVG_XML_MAX_ATTRIBS 256
 
+/* The scanners below look at a whole block of input at a time. Blocks are
+ * loaded from aligned addresses, which never straddle a page, so a scan may
+ * read past the terminator but never off the end of the mapping. Define
+ * NSVG_NO_SIMD to use the scalar loops on any target. */
+#if defined( __GNUC__ ) && !defined( NSVG_NO_SIMD ) && \
+	( defined( __AVX2__ ) || defined( __SSE2__ ) )
+#include <immintrin.h>
+#define NSVG_NOASAN __attribute__( ( no_sanitize_address ) )
+#define NSVG_XML_SHORT 4
+#ifdef __AVX2__
+typedef __m256i nsvg__vec;
+#define NSVG_XML_BLOCK 32
+#define NSVG_XML_ALL 0xffffffffu
+#define nsvg__vload( p ) _mm256_load_si256( (const __m256i*)( p ) )
+#define nsvg__vset( c ) _mm256_set1_epi8( c )
+#define nsvg__veq( a, b ) _mm256_cmpeq_epi8( a, b )
+#define nsvg__vor( a, b ) _mm256_or_si256( a, b )
+#define nsvg__vsub( a, b ) _mm256_sub_epi8( a, b )
+#define nsvg__vmin( a, b ) _mm256_min_epu8( a, b )
+#define nsvg__vmask( a ) ( (unsigned)_mm256_movemask_epi8( a ) )
+#else
+typedef __m128i nsvg__vec;
+#define NSVG_XML_BLOCK 16
+#define NSVG_XML_ALL 0xffffu
+#define nsvg__vload( p ) _mm_load_si128( (const __m128i*)( p ) )
+#define nsvg__vset( c ) _mm_set1_epi8( c )
+#define nsvg__veq( a, b ) _mm_cmpeq_epi8( a, b )
+#define nsvg__vor( a, b ) _mm_or_si128( a, b )
+#define nsvg__vsub( a, b ) _mm_sub_epi8( a, b )
+#define nsvg__vmin( a, b ) _mm_min_epu8( a, b )
+#define nsvg__vmask( a ) ( (unsigned)_mm_movemask_epi8( a ) )
+#endif
+
+/* Return the first of a or b at or after s, or the terminator. */
+NSVG_NOASAN static char* nsvg__scanChars( char* s, char a, char b )
+{
+	const char* p;
+	nsvg__vec va, vb, vz, v;
+	unsigned m;
+	int i;
+
+	/* Attribute values are often only a few bytes long */
+	for( i = 0; i < NSVG_XML_SHORT; i++, s++ )
+		if( !*s || *s == a || *s == b )
+			return s;
+
+	p  = s - ( (size_t)s & ( NSVG_XML_BLOCK - 1 ) );
+	va = nsvg__vset( a );
+	vb = nsvg__vset( b );
+	vz = nsvg__vset( 0 );
+	v  = nsvg__vload( p );
+	m  = nsvg__vmask( nsvg__vor(
+			  nsvg__vor( nsvg__veq( v, va ), nsvg__veq( v, vb ) ),
+			  nsvg__veq( v, vz ) ) ) &
+		( ~0u << ( s - p ) );
+
+	while( !m )
+	{
+		p += NSVG_XML_BLOCK;
+		v = nsvg__vload( p );
+		m = nsvg__vmask( nsvg__vor(
+			nsvg__vor( nsvg__veq( v, va ), nsvg__veq( v, vb ) ),
+			nsvg__veq( v, vz ) ) );
+	}
+	return (char*)p + __builtin_ctz( m );
+}
+
+/* Return the first byte at or after s that is not white space. */
+NSVG_NOASAN static char* nsvg__skipSpace( char* s )
+{
+	const char* p;
+	nsvg__vec vsp, vtab, vrun, v, t;
+	unsigned m;
+
+	/* Most runs inside tags are a single byte, if any */
+	if( !*s || !nsvg__isspace( *s ) )
+		return s;
+	if( !*++s || !nsvg__isspace( *s ) )
+		return s;
+
+	p    = s - ( (size_t)s & ( NSVG_XML_BLOCK - 1 ) );
+	vsp  = nsvg__vset( ' ' );
+	vtab = nsvg__vset( '\t' );
+	vrun = nsvg__vset( '\r' - '\t' );
+	v    = nsvg__vload( p );
+	/* '\t' to '\r' are those with c - '\t' at most '\r' - '\t', unsigned */
+	t = nsvg__vsub( v, vtab );
+	m = ~nsvg__vmask( nsvg__vor(
+			 nsvg__veq( v, vsp ), nsvg__veq( nsvg__vmin( t, vrun ), t ) ) ) &
+		NSVG_XML_ALL & ( ~0u << ( s - p ) );
+
+	while( !m )
+	{
+		p += NSVG_XML_BLOCK;
+		v = nsvg__vload( p );
+		t = nsvg__vsub( v, vtab );
+		m = ~nsvg__vmask( nsvg__vor( nsvg__veq( v, vsp ),
+				 nsvg__veq( nsvg__vmin( t, vrun ), t ) ) ) &
+			NSVG_XML_ALL;
+	}
+	return (char*)p + __builtin_ctz( m );
+}
+#else
+static char* nsvg__scanChars( char* s, char a, char b )
+{
+	while( *s && *s != a && *s != b )
+		s++;
+	return s;
+}
+
+static char* nsvg__skipSpace( char* s )
+{
+	while( *s && nsvg__isspace( *s ) )
+		s++;
+	return s;
+}
+#endif
+
 static void nsvg__parseContent(
 	char* s, void ( *contentCb )( void* ud, const char* s ), void* ud )
 {
 	/* Trim start white spaces */
-	while( *s && nsvg__isspace( *s ) )
-		s++;
+	s = nsvg__skipSpace( s );
 	if( !*s )
 		return;
 
@@ -313,8 +432,7 @@ static void nsvg__parseElement( char* s,
 	char quote;
 
 	/* Skip white space after the '<' */
-	while( *s && nsvg__isspace( *s ) )
-		s++;
+	s = nsvg__skipSpace( s );
 
 	/* Check if the tag is end tag */
 	if( *s == '/' )
@@ -347,8 +465,7 @@ static void nsvg__parseElement( char* s,
 		char* value = NULL;
 
 		/* Skip white space before the attrib name */
-		while( *s && nsvg__isspace( *s ) )
-			s++;
+		s = nsvg__skipSpace( s );
 		if( !*s )
 			break;
 		if( *s == '/' )
@@ -365,16 +482,14 @@ static void nsvg__parseElement( char* s,
 			*s++ = '\0';
 		}
 		/* Skip until the beginning of the value. */
-		while( *s && *s != '\"' && *s != '\'' )
-			s++;
+		s = nsvg__scanChars( s, '\"', '\'' );
 		if( !*s )
 			break;
 		quote = *s;
 		s++;
 		/* Store value and find the end of it. */
 		value = s;
-		while( *s && *s != quote )
-			s++;
+		s     = nsvg__scanChars( s, quote, quote );
 		if( *s )
 		{
 			*s++ = '\0';
@@ -405,31 +520,26 @@ int nsvg__parseXML( char* input,
 	void ( *contentCb )( void* ud, const char* s ),
 	void* ud )
 {
-	char* s    = input;
-	char* mark = s;
-	int state  = NSVG_XML_CONTENT;
-	while( *s )
+	char* s = input;
+	char* mark;
+
+	for( ;; )
 	{
-		if( *s == '<' && state == NSVG_XML_CONTENT )
-		{
-			/* Start of a tag */
-			*s++ = '\0';
-			nsvg__parseContent( mark, contentCb, ud );
-			mark  = s;
-			state = NSVG_XML_TAG;
-		}
-		else if( *s == '>' && state == NSVG_XML_TAG )
-		{
-			/* Start of a content or new tag. */
-			*s++ = '\0';
-			nsvg__parseElement( mark, startelCb, endelCb, ud );
-			mark  = s;
-			state = NSVG_XML_CONTENT;
-		}
-		else
-		{
-			s++;
-		}
+		/* Content runs up to the start of a tag */
+		mark = s;
+		s    = nsvg__scanChars( s, '<', '<' );
+		if( !*s )
+			break;
+		*s++ = '\0';
+		nsvg__parseContent( mark, contentCb, ud );
+
+		/* A tag runs up to the start of a content or new tag. */
+		mark = s;
+		s    = nsvg__scanChars( s, '>', '>' );
+		if( !*s )
+			break;
+		*s++ = '\0';
+		nsvg__parseElement( mark, startelCb, endelCb, ud );
 	}
 
 	return 1;
@@ -492,6 +602,9 @@ struct NSVGgradientData
 	float xform[6];
 	int nstops;
 	struct NSVGgradientStop* stops;
+	unsigned int hash;
+	struct NSVGgradientData* resolved;
+	int resolvedGen;
 	struct NSVGgradientData* next;
 };
 
@@ -533,6 +646,10 @@ struct NSVGparser
 	struct NSVGpath* plist;
 	struct NSVGimage* image;
 	struct NSVGgradientData* gradients;
+	struct NSVGgradientData** gradHash;
+	int gradHashBits;
+	int ngradHash;
+	int gradGen;
 	struct NSVGshape* shapesTail;
 	float viewMinx, viewMiny, viewWidth, viewHeight;
 	int alignX, alignY, alignType;
@@ -806,6 +923,7 @@ static void nsvg__deleteParser( struct NSVGparser* p )
 	{
 		nsvg__deletePaths( p->plist );
 		nsvg__deleteGradientData( p->gradients );
+		free( p->gradHash );
 		nsvgDelete( p->image );
 		free( p->pts );
 		free( p );
@@ -937,19 +1055,114 @@ static float nsvg__convertToPixels(
 	return c.value;
 }
 
+/* Gradients are indexed by id in p->gradHash, an open addressed table of
+   1 << gradHashBits slots kept at most half full. A later gradient replaces an
+   earlier one of the same id, which stays in p->gradients only to be freed. */
+
+#define NSVG_GRAD_HASH_MUL 0x9e3779b1u
+
+static unsigned int nsvg__hashString( const char* s )
+{
+	unsigned int h = 0;
+	for( ; *s; s++ )
+		h = h * 33 + (unsigned char)*s;
+	return h;
+}
+
+static int nsvg__gradientSlot( struct NSVGparser* p, unsigned int h )
+{
+	return (int)( ( ( h * NSVG_GRAD_HASH_MUL ) & 0xffffffffu ) >>
+		( 32 - p->gradHashBits ) );
+}
+
 static struct NSVGgradientData* nsvg__findGradientData(
 	struct NSVGparser* p, const char* id )
 {
-	struct NSVGgradientData* grad = p->gradients;
-	while( grad )
+	struct NSVGgradientData* grad;
+	unsigned int h;
+	int i, mask;
+	if( p->gradHash == NULL )
+		return NULL;
+	h    = nsvg__hashString( id );
+	mask = ( 1 << p->gradHashBits ) - 1;
+	for( i = nsvg__gradientSlot( p, h ); ( grad = p->gradHash[i] ) != NULL;
+		  i = ( i + 1 ) & mask )
 	{
-		if( strcmp( grad->id, id ) == 0 )
+		if( grad->hash == h && strcmp( grad->id, id ) == 0 )
 			return grad;
-		grad = grad->next;
 	}
 	return NULL;
 }
 
+static int nsvg__addGradientData(
+	struct NSVGparser* p, struct NSVGgradientData* grad )
+{
+	struct NSVGgradientData* old;
+	int i, mask;
+
+	if( ( p->ngradHash + 1 ) * 2 > ( 1 << p->gradHashBits ) )
+	{
+		struct NSVGgradientData** slots = p->gradHash;
+		int n    = p->gradHash != NULL ? 1 << p->gradHashBits : 0;
+		int bits = p->gradHash != NULL ? p->gradHashBits + 1 : 6;
+		p->gradHash = calloc( (size_t)1 << bits, sizeof( *slots ) );
+		if( p->gradHash == NULL )
+		{
+			p->gradHash = slots;
+			return 0;
+		}
+		p->gradHashBits = bits;
+		mask            = ( 1 << bits ) - 1;
+		while( n-- > 0 )
+		{
+			if( slots[n] == NULL )
+				continue;
+			for( i = nsvg__gradientSlot( p, slots[n]->hash );
+				  p->gradHash[i] != NULL; i = ( i + 1 ) & mask )
+				;
+			p->gradHash[i] = slots[n];
+		}
+		free( slots );
+	}
+
+	grad->hash = nsvg__hashString( grad->id );
+	mask       = ( 1 << p->gradHashBits ) - 1;
+	for( i = nsvg__gradientSlot( p, grad->hash );
+		  ( old = p->gradHash[i] ) != NULL; i = ( i + 1 ) & mask )
+	{
+		if( old->hash == grad->hash && strcmp( old->id, grad->id ) == 0 )
+			break;
+	}
+	if( old == NULL )
+		p->ngradHash++;
+	p->gradHash[i] = grad;
+
+	grad->next   = p->gradients;
+	p->gradients = grad;
+	p->gradGen++;
+	return 1;
+}
+
+/* Follows the xlink:href chain from data to the first gradient with stops.
+   The answer is kept in data until a gradient is added or first gets stops,
+   either of which bumps p->gradGen. A chain longer than the number of ids
+   has looped and resolves to nothing. */
+static struct NSVGgradientData* nsvg__resolveGradientStops(
+	struct NSVGparser* p, struct NSVGgradientData* data )
+{
+	struct NSVGgradientData* ref = data;
+	int n;
+	if( data->resolvedGen == p->gradGen )
+		return data->resolved;
+	for( n = 0; ref != NULL && ref->stops == NULL && n < p->ngradHash; n++ )
+		ref = nsvg__findGradientData( p, ref->ref );
+	if( ref != NULL && ref->stops == NULL )
+		ref = NULL;
+	data->resolved    = ref;
+	data->resolvedGen = p->gradGen;
+	return ref;
+}
+
 static struct NSVGgradient* nsvg__createGradient(
 	struct NSVGparser* p, const char* id, const float* localBounds, char* paintType )
 {
@@ -966,19 +1179,11 @@ static struct NSVGgradient* nsvg__createGradient(
 		return NULL;
 
 	/* TODO: use ref to fill in all unset values too. */
-	ref = data;
-	while( ref != NULL )
-	{
-		if( stops == NULL && ref->stops != NULL )
-		{
-			stops  = ref->stops;
-			nstops = ref->nstops;
-			break;
-		}
-		ref = nsvg__findGradientData( p, ref->ref );
-	}
-	if( stops == NULL )
+	ref = nsvg__resolveGradientStops( p, data );
+	if( ref == NULL )
 		return NULL;
+	stops  = ref->stops;
+	nstops = ref->nstops;
 
 	grad = malloc(
 		sizeof( struct NSVGgradient ) + sizeof( struct NSVGgradientStop ) * ( nstops - 1 ) );
@@ -1283,153 +1488,451 @@ error:
 }
 
 /* We roll our own string to float because the std library one uses locale and
-   messes things up. */
-static double nsvg__atof( const char* s )
+   messes things up. Numbers are read in one pass straight from the source:
+   up to 19 significant digits go into an integer w and the rest into the
+   power of ten q, and w * 10^q is then rounded to the nearest float by the
+   Eisel-Lemire method. w is multiplied by a 128-bit 5^q from the table below
+   and the mantissa is read off the top of the product; the low half of the
+   table is only needed when the bits under the mantissa are all ones. */
+
+#define NSVG_POW5_MIN ( -64 )
+#define NSVG_POW5_MAX 38
+
+/* 5^q for q from NSVG_POW5_MIN to NSVG_POW5_MAX, shifted to fill 128 bits and
+   truncated, upper half first. Negative powers are rounded up. */
+static const unsigned long long nsvg__pow5[][2] = {
+	{0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL}, /* 5^-64 */
+	{0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL}, /* 5^-63 */
+	{0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL}, /* 5^-62 */
+	{0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL}, /* 5^-61 */
+	{0xcdb02555653131b6ULL, 0x3792f412cb06794dULL}, /* 5^-60 */
+	{0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL}, /* 5^-59 */
+	{0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL}, /* 5^-58 */
+	{0xc8de047564d20a8bULL, 0xf245825a5a445275ULL}, /* 5^-57 */
+	{0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL}, /* 5^-56 */
+	{0x9ced737bb6c4183dULL, 0x55464dd69685606bULL}, /* 5^-55 */
+	{0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL}, /* 5^-54 */
+	{0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL}, /* 5^-53 */
+	{0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL}, /* 5^-52 */
+	{0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL}, /* 5^-51 */
+	{0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL}, /* 5^-50 */
+	{0x95a8637627989aadULL, 0xdde7001379a44aa8ULL}, /* 5^-49 */
+	{0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL}, /* 5^-48 */
+	{0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL}, /* 5^-47 */
+	{0x9226712162ab070dULL, 0xcab3961304ca70e8ULL}, /* 5^-46 */
+	{0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL}, /* 5^-45 */
+	{0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL}, /* 5^-44 */
+	{0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL}, /* 5^-43 */
+	{0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL}, /* 5^-42 */
+	{0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL}, /* 5^-41 */
+	{0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL}, /* 5^-40 */
+	{0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL}, /* 5^-39 */
+	{0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL}, /* 5^-38 */
+	{0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL}, /* 5^-37 */
+	{0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL}, /* 5^-36 */
+	{0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL}, /* 5^-35 */
+	{0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL}, /* 5^-34 */
+	{0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL}, /* 5^-33 */
+	{0xcfb11ead453994baULL, 0x67de18eda5814af2ULL}, /* 5^-32 */
+	{0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL}, /* 5^-31 */
+	{0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL}, /* 5^-30 */
+	{0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL}, /* 5^-29 */
+	{0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL}, /* 5^-28 */
+	{0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL}, /* 5^-27 */
+	{0xc612062576589ddaULL, 0x95364afe032a819eULL}, /* 5^-26 */
+	{0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL}, /* 5^-25 */
+	{0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL}, /* 5^-24 */
+	{0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL}, /* 5^-23 */
+	{0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL}, /* 5^-22 */
+	{0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL}, /* 5^-21 */
+	{0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL}, /* 5^-20 */
+	{0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL}, /* 5^-19 */
+	{0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL}, /* 5^-18 */
+	{0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL}, /* 5^-17 */
+	{0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL}, /* 5^-16 */
+	{0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL}, /* 5^-15 */
+	{0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL}, /* 5^-14 */
+	{0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL}, /* 5^-13 */
+	{0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL}, /* 5^-12 */
+	{0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL}, /* 5^-11 */
+	{0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL}, /* 5^-10 */
+	{0x89705f4136b4a597ULL, 0x31680a88f8953031ULL}, /* 5^-9 */
+	{0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL}, /* 5^-8 */
+	{0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL}, /* 5^-7 */
+	{0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL}, /* 5^-6 */
+	{0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL}, /* 5^-5 */
+	{0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL}, /* 5^-4 */
+	{0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL}, /* 5^-3 */
+	{0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL}, /* 5^-2 */
+	{0xccccccccccccccccULL, 0xcccccccccccccccdULL}, /* 5^-1 */
+	{0x8000000000000000ULL, 0x0000000000000000ULL}, /* 5^0 */
+	{0xa000000000000000ULL, 0x0000000000000000ULL}, /* 5^1 */
+	{0xc800000000000000ULL, 0x0000000000000000ULL}, /* 5^2 */
+	{0xfa00000000000000ULL, 0x0000000000000000ULL}, /* 5^3 */
+	{0x9c40000000000000ULL, 0x0000000000000000ULL}, /* 5^4 */
+	{0xc350000000000000ULL, 0x0000000000000000ULL}, /* 5^5 */
+	{0xf424000000000000ULL, 0x0000000000000000ULL}, /* 5^6 */
+	{0x9896800000000000ULL, 0x0000000000000000ULL}, /* 5^7 */
+	{0xbebc200000000000ULL, 0x0000000000000000ULL}, /* 5^8 */
+	{0xee6b280000000000ULL, 0x0000000000000000ULL}, /* 5^9 */
+	{0x9502f90000000000ULL, 0x0000000000000000ULL}, /* 5^10 */
+	{0xba43b74000000000ULL, 0x0000000000000000ULL}, /* 5^11 */
+	{0xe8d4a51000000000ULL, 0x0000000000000000ULL}, /* 5^12 */
+	{0x9184e72a00000000ULL, 0x0000000000000000ULL}, /* 5^13 */
+	{0xb5e620f480000000ULL, 0x0000000000000000ULL}, /* 5^14 */
+	{0xe35fa931a0000000ULL, 0x0000000000000000ULL}, /* 5^15 */
+	{0x8e1bc9bf04000000ULL, 0x0000000000000000ULL}, /* 5^16 */
+	{0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL}, /* 5^17 */
+	{0xde0b6b3a76400000ULL, 0x0000000000000000ULL}, /* 5^18 */
+	{0x8ac7230489e80000ULL, 0x0000000000000000ULL}, /* 5^19 */
+	{0xad78ebc5ac620000ULL, 0x0000000000000000ULL}, /* 5^20 */
+	{0xd8d726b7177a8000ULL, 0x0000000000000000ULL}, /* 5^21 */
+	{0x878678326eac9000ULL, 0x0000000000000000ULL}, /* 5^22 */
+	{0xa968163f0a57b400ULL, 0x0000000000000000ULL}, /* 5^23 */
+	{0xd3c21bcecceda100ULL, 0x0000000000000000ULL}, /* 5^24 */
+	{0x84595161401484a0ULL, 0x0000000000000000ULL}, /* 5^25 */
+	{0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL}, /* 5^26 */
+	{0xcecb8f27f4200f3aULL, 0x0000000000000000ULL}, /* 5^27 */
+	{0x813f3978f8940984ULL, 0x4000000000000000ULL}, /* 5^28 */
+	{0xa18f07d736b90be5ULL, 0x5000000000000000ULL}, /* 5^29 */
+	{0xc9f2c9cd04674edeULL, 0xa400000000000000ULL}, /* 5^30 */
+	{0xfc6f7c4045812296ULL, 0x4d00000000000000ULL}, /* 5^31 */
+	{0x9dc5ada82b70b59dULL, 0xf020000000000000ULL}, /* 5^32 */
+	{0xc5371912364ce305ULL, 0x6c28000000000000ULL}, /* 5^33 */
+	{0xf684df56c3e01bc6ULL, 0xc732000000000000ULL}, /* 5^34 */
+	{0x9a130b963a6c115cULL, 0x3c7f400000000000ULL}, /* 5^35 */
+	{0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL}, /* 5^36 */
+	{0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL}, /* 5^37 */
+	{0x96769950b50d88f4ULL, 0x1314448000000000ULL}, /* 5^38 */
+};
+
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 nsvg__u128;
+#endif
+
+/* Return the upper half of the 128-bit product of a and b, and the lower half
+   in *lo */
+static unsigned long long nsvg__mul64(
+	unsigned long long a, unsigned long long b, unsigned long long* lo )
+{
+#ifdef __SIZEOF_INT128__
+	nsvg__u128 r = (nsvg__u128)a * b;
+	*lo          = (unsigned long long)r;
+	return (unsigned long long)( r >> 64 );
+#else
+	unsigned long long al = a & 0xffffffff, ah = a >> 32;
+	unsigned long long bl = b & 0xffffffff, bh = b >> 32;
+	unsigned long long ll = al * bl, lh = al * bh, hl = ah * bl;
+	unsigned long long mid =
+		( ll >> 32 ) + ( lh & 0xffffffff ) + ( hl & 0xffffffff );
+	*lo = ( mid << 32 ) | ( ll & 0xffffffff );
+	return ah * bh + ( lh >> 32 ) + ( hl >> 32 ) + ( mid >> 32 );
+#endif
+}
+
+/* Round w * 10^q to the nearest float, ties to even */
+static float nsvg__roundFloat( unsigned long long w, int q )
 {
-	char* cur  = (char*)s;
-	char* end  = NULL;
-	double res = 0.0, sign = 1.0;
-	long long intPart = 0, fracPart = 0;
-	char hasIntPart = 0, hasFracPart = 0;
+	unsigned long long hi, lo, hi2, lo2, m;
+	unsigned int bits;
+	int lz = 0, up, shift, e2;
+	float f;
 
-	/* Parse optional sign */
-	if( *cur == '+' )
+	if( w == 0 || q < NSVG_POW5_MIN )
+		return 0.0f;
+	if( q > NSVG_POW5_MAX )
 	{
-		cur++;
+		bits = 0x7f800000;
+		memcpy( &f, &bits, sizeof( f ) );
+		return f;
 	}
-	else if( *cur == '-' )
+
+#ifdef __GNUC__
+	lz = __builtin_clzll( w );
+	w <<= lz;
+#else
+	while( !( w >> 63 ) )
 	{
-		sign = -1;
-		cur++;
+		w <<= 1;
+		lz++;
 	}
+#endif
+	hi = nsvg__mul64( w, nsvg__pow5[q - NSVG_POW5_MIN][0], &lo );
+	if( ( hi & 0x3fffffffffULL ) == 0x3fffffffffULL )
+	{
+		hi2 = nsvg__mul64( w, nsvg__pow5[q - NSVG_POW5_MIN][1], &lo2 );
+		lo += hi2;
+		if( hi2 > lo )
+			hi++;
+	}
+
+	/* Keep 25 bits: the mantissa, its hidden bit and a rounding bit. The
+	   exponent is floor( q * log2( 10 ) ) from the product, plus the bias. */
+	up    = (int)( hi >> 63 );
+	shift = up + 64 - 23 - 3;
+	m     = hi >> shift;
+	e2    = ( ( ( 152170 + 65536 ) * q ) >> 16 ) + 63 + up - lz + 127;
 
-	/* Parse integer part */
-	if( nsvg__isdigit( *cur ) )
+	if( e2 <= 0 )
 	{
-		/* Parse digit sequence */
-		intPart = strtoll( cur, &end, 10 );
-		if( cur != end )
+		/* Subnormal */
+		if( -e2 + 1 >= 64 )
+			return 0.0f;
+		m >>= -e2 + 1;
+		m += m & 1;
+		m >>= 1;
+		e2 = m < ( 1UL << 23 ) ? 0 : 1;
+	}
+	else
+	{
+		/* An exact product halfway between two floats rounds to even. Only
+		   small powers of ten can give one. */
+		if( lo <= 1 && q >= -17 && q <= 10 && ( m & 3 ) == 1 &&
+			( m << shift ) == hi )
+			m &= ~1ULL;
+		m += m & 1;
+		m >>= 1;
+		if( m >= ( 2UL << 23 ) )
+		{
+			m = 1UL << 23;
+			e2++;
+		}
+		m &= ~( 1UL << 23 );
+		if( e2 >= 0xff )
 		{
-			res        = (double)intPart;
-			hasIntPart = 1;
-			cur        = end;
+			e2 = 0xff;
+			m  = 0;
 		}
 	}
 
-	/* Parse fractional part. */
-	if( *cur == '.' )
+	bits = ( (unsigned int)e2 << 23 ) | (unsigned int)m;
+	memcpy( &f, &bits, sizeof( f ) );
+	return f;
+}
+
+/* Numbers with more than 19 significant digits that land next to a rounding
+   boundary are settled exactly: the digits, up to NSVG_BIG_DIGITS of them,
+   are compared with the point halfway between the two candidate floats. */
+
+#define NSVG_BIG_DIGITS 128
+#define NSVG_BIG_WORDS 32
+
+struct NSVGbigNum
+{
+	unsigned int w[NSVG_BIG_WORDS]; /* least significant first */
+	int n;
+};
+
+static void nsvg__bigMulAdd(
+	struct NSVGbigNum* b, unsigned int m, unsigned int a )
+{
+	unsigned long long c = a;
+	int i;
+	for( i = 0; i < b->n; i++ )
+	{
+		c += (unsigned long long)b->w[i] * m;
+		b->w[i] = (unsigned int)c;
+		c >>= 32;
+	}
+	if( c && b->n < NSVG_BIG_WORDS )
+		b->w[b->n++] = (unsigned int)c;
+}
+
+static void nsvg__bigMulPow10( struct NSVGbigNum* b, int k )
+{
+	for( ; k >= 9; k -= 9 )
+		nsvg__bigMulAdd( b, 1000000000, 0 );
+	for( ; k > 0; k-- )
+		nsvg__bigMulAdd( b, 10, 0 );
+}
+
+static void nsvg__bigShl( struct NSVGbigNum* b, int k )
+{
+	int i, words = k / 32, bits = k % 32;
+	if( b->n == 0 )
+		return;
+	if( bits )
+		nsvg__bigMulAdd( b, 1u << bits, 0 );
+	if( words + b->n > NSVG_BIG_WORDS )
+		words = NSVG_BIG_WORDS - b->n;
+	for( i = b->n - 1; i >= 0; i-- )
+		b->w[i + words] = b->w[i];
+	for( i = 0; i < words; i++ )
+		b->w[i] = 0;
+	b->n += words;
+}
+
+static int nsvg__bigCmp(
+	const struct NSVGbigNum* a, const struct NSVGbigNum* b )
+{
+	int i;
+	if( a->n != b->n )
+		return a->n < b->n ? -1 : 1;
+	for( i = a->n - 1; i >= 0; i-- )
+		if( a->w[i] != b->w[i] )
+			return a->w[i] < b->w[i] ? -1 : 1;
+	return 0;
+}
+
+/* Round the digits at s, times 10^e, to lo or the float above it */
+static float nsvg__roundDigits( const char* s, int e, float lo )
+{
+	struct NSVGbigNum a, b;
+	unsigned int bits, m;
+	int nd = 0, more = 0, e2, c;
+	float hi;
+
+	/* The digits, as an integer a times 10^e */
+	a.n = 0;
+	for( ; nsvg__isdigit( *s ); s++ )
 	{
-		cur++; /* Skip '.' */
-		if( nsvg__isdigit( *cur ) )
+		if( nd < NSVG_BIG_DIGITS )
 		{
-			/* Parse digit sequence */
-			fracPart = strtoll( cur, &end, 10 );
-			if( cur != end )
-			{
-				res += (double)fracPart / pow( 10.0, (double)( end - cur ) );
-				hasFracPart = 1;
-				cur         = end;
-			}
+			nsvg__bigMulAdd( &a, 10, (unsigned int)( *s - '0' ) );
+			nd += a.n != 0;
+		}
+		else
+		{
+			e++;
+			more |= *s != '0';
 		}
 	}
-
-	/* A valid number should have integer or fractional part. */
-	if( !hasIntPart && !hasFracPart )
-		return 0.0;
-
-	/* Parse optional exponent */
-	if( *cur == 'e' || *cur == 'E' )
+	if( *s == '.' )
 	{
-		long expPart = 0;
-		cur++; /* skip 'E' */
-		expPart = strtol( cur, &end, 10 ); /* Parse digit sequence with sign */
-		if( cur != end )
+		for( s++; nsvg__isdigit( *s ); s++ )
 		{
-			res *= pow( 10.0, (double)expPart );
+			if( nd < NSVG_BIG_DIGITS )
+			{
+				nsvg__bigMulAdd( &a, 10, (unsigned int)( *s - '0' ) );
+				nd += a.n != 0;
+				e--;
+			}
+			else
+			{
+				more |= *s != '0';
+			}
 		}
 	}
 
-	return res * sign;
+	/* Halfway to the next float up, as an integer b times 2^e2 */
+	memcpy( &bits, &lo, sizeof( bits ) );
+	m      = bits & 0x7fffff;
+	e2     = (int)( bits >> 23 );
+	m      = e2 ? m | 0x800000 : m;
+	e2     = e2 ? e2 - 150 : -149;
+	b.n    = 1;
+	b.w[0] = 2 * m + 1;
+	e2--;
+
+	if( e >= 0 )
+		nsvg__bigMulPow10( &a, e );
+	else
+		nsvg__bigMulPow10( &b, -e );
+	if( e2 >= 0 )
+		nsvg__bigShl( &b, e2 );
+	else
+		nsvg__bigShl( &a, -e2 );
+
+	c = nsvg__bigCmp( &a, &b );
+	if( c == 0 )
+		c = more ? 1 : ( m & 1 ) ? 1 : -1;
+	if( c < 0 )
+		return lo;
+	bits++;
+	memcpy( &hi, &bits, sizeof( hi ) );
+	return hi;
 }
 
-static const char* nsvg__parseNumber( const char* s, char* it, const int size )
+/* Parse a number at s into *val, and return the end of it. An exponent is
+   not taken from the units "em" and "ex". */
+static const char* nsvg__parseFloat( const char* s, float* val )
 {
-	const int last = size - 1;
-	int i          = 0;
+	unsigned long long w = 0;
+	int nd = 0, q = 0, e = 0, neg = 0, more = 0;
+	const char* digits;
+	float f;
 
 	/* sign */
 	if( *s == '-' || *s == '+' )
 	{
-		if( i < last )
-			it[i++] = *s;
+		neg = *s == '-';
 		s++;
 	}
+	digits = s;
 	/* integer part */
-	while( *s && nsvg__isdigit( *s ) )
+	for( ; nsvg__isdigit( *s ); s++ )
 	{
-		if( i < last )
-			it[i++] = *s;
-		s++;
+		if( nd < 19 )
+		{
+			w = w * 10 + (unsigned int)( *s - '0' );
+			nd += w != 0;
+		}
+		else
+		{
+			q++;
+			more |= *s != '0';
+		}
 	}
 	if( *s == '.' )
 	{
-		/* decimal point */
-		if( i < last )
-			it[i++] = *s;
-		s++;
 		/* fraction part */
-		while( *s && nsvg__isdigit( *s ) )
+		for( s++; nsvg__isdigit( *s ); s++ )
 		{
-			if( i < last )
-				it[i++] = *s;
-			s++;
+			if( nd < 19 )
+			{
+				w = w * 10 + (unsigned int)( *s - '0' );
+				nd += w != 0;
+				q--;
+			}
+			else
+			{
+				more |= *s != '0';
+			}
 		}
 	}
 	/* exponent */
 	if( ( *s == 'e' || *s == 'E' ) && ( s[1] != 'm' && s[1] != 'x' ) )
 	{
-		if( i < last )
-			it[i++] = *s;
+		int eneg = 0;
 		s++;
 		if( *s == '-' || *s == '+' )
 		{
-			if( i < last )
-				it[i++] = *s;
+			eneg = *s == '-';
 			s++;
 		}
-		while( *s && nsvg__isdigit( *s ) )
-		{
-			if( i < last )
-				it[i++] = *s;
-			s++;
-		}
-	}
-	it[i] = '\0';
-
+		for( ; nsvg__isdigit( *s ); s++ )
+			if( e < 10000 )
+				e = e * 10 + ( *s - '0' );
+		e = eneg ? -e : e;
+		q += e;
+	}
+
+	/* Dropped digits put the number between w and w + 1; when those round
+	   apart, the exact digits decide. */
+	f = nsvg__roundFloat( w, q );
+	if( more && f != nsvg__roundFloat( w + 1, q ) )
+		f = nsvg__roundDigits( digits, e, f );
+	*val = neg ? -f : f;
 	return s;
 }
 
-static const char* nsvg__getNextPathItem( const char* s, char* it )
+/* Set *it to the first byte of the next item, or '\0' at the end, and *val to
+   its value if it is a number, or else 0 */
+static const char* nsvg__getNextPathItem(
+	const char* s, char* it, float* val )
 {
-	it[0] = '\0';
+	*it  = '\0';
+	*val = 0.0f;
 	/* Skip white spaces and commas */
 	while( *s && ( nsvg__isspace( *s ) || *s == ',' ) )
 		s++;
 	if( !*s )
 		return s;
+	*it = *s;
 	if( *s == '-' || *s == '+' || *s == '.' || nsvg__isdigit( *s ) )
-	{
-		s = nsvg__parseNumber( s, it, 64 );
-	}
-	else
-	{
-		/* Parse command */
-		it[0] = *s++;
-		it[1] = '\0';
-		return s;
-	}
-
-	return s;
+		return nsvg__parseFloat( s, val );
+	/* Parse command */
+	return s + 1;
 }
 
 static unsigned int nsvg__parseColorHex( const char* str )
@@ -1478,19 +1981,9 @@ struct NSVGNamedColor
 	unsigned int color;
 };
 
-struct NSVGNamedColor nsvg__colors[] = {
-
-	{"red", NSVG_RGB( 255, 0, 0 )},
-	{"green", NSVG_RGB( 0, 128, 0 )},
-	{"blue", NSVG_RGB( 0, 0, 255 )},
-	{"yellow", NSVG_RGB( 255, 255, 0 )},
-	{"cyan", NSVG_RGB( 0, 255, 255 )},
-	{"magenta", NSVG_RGB( 255, 0, 255 )},
-	{"black", NSVG_RGB( 0, 0, 0 )},
-	{"grey", NSVG_RGB( 128, 128, 128 )},
-	{"gray", NSVG_RGB( 128, 128, 128 )},
-	{"white", NSVG_RGB( 255, 255, 255 )},
-
+/* Sorted by name for the binary search in nsvg__parseColorName, with the
+   basic colours in their places among the full set */
+static const struct NSVGNamedColor nsvg__colors[] = {
 #ifdef NANOSVG_ALL_COLOR_KEYWORDS
 	{"aliceblue", NSVG_RGB( 240, 248, 255 )},
 	{"antiquewhite", NSVG_RGB( 250, 235, 215 )},
@@ -1499,7 +1992,13 @@ struct NSVGNamedColor nsvg__colors[] = {
 	{"azure", NSVG_RGB( 240, 255, 255 )},
 	{"beige", NSVG_RGB( 245, 245, 220 )},
 	{"bisque", NSVG_RGB( 255, 228, 196 )},
+#endif
+	{"black", NSVG_RGB( 0, 0, 0 )},
+#ifdef NANOSVG_ALL_COLOR_KEYWORDS
 	{"blanchedalmond", NSVG_RGB( 255, 235, 205 )},
+#endif
+	{"blue", NSVG_RGB( 0, 0, 255 )},
+#ifdef NANOSVG_ALL_COLOR_KEYWORDS
 	{"blueviolet", NSVG_RGB( 138, 43, 226 )},
 	{"brown", NSVG_RGB( 165, 42, 42 )},
 	{"burlywood", NSVG_RGB( 222, 184, 135 )},
@@ -1510,6 +2009,9 @@ struct NSVGNamedColor nsvg__colors[] = {
 	{"cornflowerblue", NSVG_RGB( 100, 149, 237 )},
 	{"cornsilk", NSVG_RGB( 255, 248, 220 )},
 	{"crimson", NSVG_RGB( 220, 20, 60 )},
+#endif
+	{"cyan", NSVG_RGB( 0, 255, 255 )},
+#ifdef NANOSVG_ALL_COLOR_KEYWORDS
 	{"darkblue", NSVG_RGB( 0, 0, 139 )},
 	{"darkcyan", NSVG_RGB( 0, 139, 139 )},
 	{"darkgoldenrod", NSVG_RGB( 184, 134, 11 )},
@@ -1542,7 +2044,14 @@ struct NSVGNamedColor nsvg__colors[] = {
 	{"ghostwhite", NSVG_RGB( 248, 248, 255 )},
 	{"gold", NSVG_RGB( 255, 215, 0 )},
 	{"goldenrod", NSVG_RGB( 218, 165, 32 )},
+#endif
+	{"gray", NSVG_RGB( 128, 128, 128 )},
+	{"green", NSVG_RGB( 0, 128, 0 )},
+#ifdef NANOSVG_ALL_COLOR_KEYWORDS
 	{"greenyellow", NSVG_RGB( 173, 255, 47 )},
+#endif
+	{"grey", NSVG_RGB( 128, 128, 128 )},
+#ifdef NANOSVG_ALL_COLOR_KEYWORDS
 	{"honeydew", NSVG_RGB( 240, 255, 240 )},
 	{"hotpink", NSVG_RGB( 255, 105, 180 )},
 	{"indianred", NSVG_RGB( 205, 92, 92 )},
@@ -1571,6 +2080,9 @@ struct NSVGNamedColor nsvg__colors[] = {
 	{"lime", NSVG_RGB( 0, 255, 0 )},
 	{"limegreen", NSVG_RGB( 50, 205, 50 )},
 	{"linen", NSVG_RGB( 250, 240, 230 )},
+#endif
+	{"magenta", NSVG_RGB( 255, 0, 255 )},
+#ifdef NANOSVG_ALL_COLOR_KEYWORDS
 	{"maroon", NSVG_RGB( 128, 0, 0 )},
 	{"mediumaquamarine", NSVG_RGB( 102, 205, 170 )},
 	{"mediumblue", NSVG_RGB( 0, 0, 205 )},
@@ -1604,6 +2116,9 @@ struct NSVGNamedColor nsvg__colors[] = {
 	{"plum", NSVG_RGB( 221, 160, 221 )},
 	{"powderblue", NSVG_RGB( 176, 224, 230 )},
 	{"purple", NSVG_RGB( 128, 0, 128 )},
+#endif
+	{"red", NSVG_RGB( 255, 0, 0 )},
+#ifdef NANOSVG_ALL_COLOR_KEYWORDS
 	{"rosybrown", NSVG_RGB( 188, 143, 143 )},
 	{"royalblue", NSVG_RGB( 65, 105, 225 )},
 	{"saddlebrown", NSVG_RGB( 139, 69, 19 )},
@@ -1627,21 +2142,32 @@ struct NSVGNamedColor nsvg__colors[] = {
 	{"turquoise", NSVG_RGB( 64, 224, 208 )},
 	{"violet", NSVG_RGB( 238, 130, 238 )},
 	{"wheat", NSVG_RGB( 245, 222, 179 )},
+#endif
+	{"white", NSVG_RGB( 255, 255, 255 )},
+#ifdef NANOSVG_ALL_COLOR_KEYWORDS
 	{"whitesmoke", NSVG_RGB( 245, 245, 245 )},
+#endif
+	{"yellow", NSVG_RGB( 255, 255, 0 )},
+#ifdef NANOSVG_ALL_COLOR_KEYWORDS
 	{"yellowgreen", NSVG_RGB( 154, 205, 50 )},
 #endif
 };
 
 static unsigned int nsvg__parseColorName( const char* str )
 {
-	int i, ncolors = sizeof( nsvg__colors ) / sizeof( struct NSVGNamedColor );
+	int lo = 0, hi = sizeof( nsvg__colors ) / sizeof( struct NSVGNamedColor );
 
-	for( i = 0; i < ncolors; i++ )
+	/* Binary search */
+	while( lo < hi )
 	{
-		if( strcmp( nsvg__colors[i].name, str ) == 0 )
-		{
-			return nsvg__colors[i].color;
-		}
+		int mid = ( lo + hi ) / 2;
+		int c   = strcmp( nsvg__colors[mid].name, str );
+		if( c == 0 )
+			return nsvg__colors[mid].color;
+		if( c < 0 )
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
 
 	return NSVG_RGB( 128, 128, 128 );
@@ -1663,7 +2189,8 @@ static unsigned int nsvg__parseColor( const char* str )
 
 static float nsvg__parseOpacity( const char* str )
 {
-	float val = nsvg__atof( str );
+	float val;
+	nsvg__parseFloat( str, &val );
 	if( val < 0.0f )
 		val = 0.0f;
 	if( val > 1.0f )
@@ -1673,7 +2200,8 @@ static float nsvg__parseOpacity( const char* str )
 
 static float nsvg__parseMiterLimit( const char* str )
 {
-	float val = nsvg__atof( str );
+	float val;
+	nsvg__parseFloat( str, &val );
 	if( val < 0.0f )
 		val = 0.0f;
 	return val;
@@ -1705,9 +2233,7 @@ static int nsvg__parseUnits( const char* units )
 static struct NSVGcoordinate nsvg__parseCoordinateRaw( const char* str )
 {
 	struct NSVGcoordinate coord = {0, NSVG_UNITS_USER};
-	char buf[64];
-	coord.units = nsvg__parseUnits( nsvg__parseNumber( str, buf, 64 ) );
-	coord.value = nsvg__atof( buf );
+	coord.units = nsvg__parseUnits( nsvg__parseFloat( str, &coord.value ) );
 	return coord;
 }
 
@@ -1729,7 +2255,6 @@ static int nsvg__parseTransformArgs(
 {
 	const char* end;
 	const char* ptr;
-	char it[64];
 
 	*na = 0;
 	ptr = str;
@@ -1749,8 +2274,7 @@ static int nsvg__parseTransformArgs(
 		{
 			if( *na >= maxNa )
 				return 0;
-			ptr             = nsvg__parseNumber( ptr, it, 64 );
-			args[( *na )++] = (float)nsvg__atof( it );
+			ptr = nsvg__parseFloat( ptr, &args[( *na )++] );
 		}
 		else
 		{
@@ -1977,27 +2501,124 @@ static int nsvg__parseStrokeDashArray(
 
 static void nsvg__parseStyle( struct NSVGparser* p, const char* str );
 
-static int nsvg__parseAttr(
-	struct NSVGparser* p, const char* name, const char* value )
+/* Element and attribute names. A name is looked up by hashing it into
+   nsvg__nameSlots and comparing it with the one name found there. The hash is
+   h = h * 33 + c over the bytes, and its slot the top 7 bits of h times
+   NSVG_NAME_MUL, a multiplier searched for that puts every name in a slot of
+   its own. Adding a name means searching for a new one. */
+
+#define NSVG_NAME_MUL 0x2eb4cb17u
+
+enum NSVGname
+{
+	NSVG_NAME_UNKNOWN = 0,
+	NSVG_NAME_CIRCLE,
+	NSVG_NAME_DEFS,
+	NSVG_NAME_ELLIPSE,
+	NSVG_NAME_G,
+	NSVG_NAME_LINE,
+	NSVG_NAME_LINEARGRADIENT,
+	NSVG_NAME_PATH,
+	NSVG_NAME_POLYGON,
+	NSVG_NAME_POLYLINE,
+	NSVG_NAME_RADIALGRADIENT,
+	NSVG_NAME_RECT,
+	NSVG_NAME_STOP,
+	NSVG_NAME_SVG,
+	NSVG_NAME_STYLE,
+	NSVG_NAME_DISPLAY,
+	NSVG_NAME_FILL,
+	NSVG_NAME_OPACITY,
+	NSVG_NAME_FILL_OPACITY,
+	NSVG_NAME_STROKE,
+	NSVG_NAME_STROKE_WIDTH,
+	NSVG_NAME_STROKE_DASHARRAY,
+	NSVG_NAME_STROKE_DASHOFFSET,
+	NSVG_NAME_STROKE_OPACITY,
+	NSVG_NAME_STROKE_LINECAP,
+	NSVG_NAME_STROKE_LINEJOIN,
+	NSVG_NAME_STROKE_MITERLIMIT,
+	NSVG_NAME_FILL_RULE,
+	NSVG_NAME_FONT_SIZE,
+	NSVG_NAME_TRANSFORM,
+	NSVG_NAME_STOP_COLOR,
+	NSVG_NAME_STOP_OPACITY,
+	NSVG_NAME_OFFSET,
+	NSVG_NAME_ID,
+	NSVG_NAME_D,
+	NSVG_NAME_X,
+	NSVG_NAME_Y,
+	NSVG_NAME_WIDTH,
+	NSVG_NAME_HEIGHT,
+	NSVG_NAME_RX,
+	NSVG_NAME_RY,
+	NSVG_NAME_CX,
+	NSVG_NAME_CY,
+	NSVG_NAME_R,
+	NSVG_NAME_X1,
+	NSVG_NAME_Y1,
+	NSVG_NAME_X2,
+	NSVG_NAME_Y2,
+	NSVG_NAME_FX,
+	NSVG_NAME_FY,
+	NSVG_NAME_POINTS,
+	NSVG_NAME_VIEWBOX,
+	NSVG_NAME_PRESERVEASPECTRATIO,
+	NSVG_NAME_GRADIENTUNITS,
+	NSVG_NAME_GRADIENTTRANSFORM,
+	NSVG_NAME_SPREADMETHOD,
+	NSVG_NAME_XLINK_HREF
+};
+
+static const char* const nsvg__names[] = {"",
+	"circle", "defs", "ellipse", "g", "line", "linearGradient", "path",
+	"polygon", "polyline", "radialGradient", "rect", "stop", "svg", "style",
+	"display", "fill", "opacity", "fill-opacity", "stroke", "stroke-width",
+	"stroke-dasharray", "stroke-dashoffset", "stroke-opacity", "stroke-linecap",
+	"stroke-linejoin", "stroke-miterlimit", "fill-rule", "font-size",
+	"transform", "stop-color", "stop-opacity", "offset", "id", "d", "x", "y",
+	"width", "height", "rx", "ry", "cx", "cy", "r", "x1", "y1", "x2", "y2",
+	"fx", "fy", "points", "viewBox", "preserveAspectRatio", "gradientUnits",
+	"gradientTransform", "spreadMethod", "xlink:href"};
+
+static const unsigned char nsvg__nameSlots[128] = {
+	48, 0, 0, 0, 2, 0, 0, 0, 19, 36, 0, 0, 0, 38, 11, 10,
+	42, 30, 3, 0, 0, 0, 0, 0, 49, 0, 0, 0, 0, 0, 0, 34,
+	39, 0, 0, 0, 0, 53, 26, 0, 14, 20, 0, 22, 0, 0, 0, 0,
+	0, 0, 52, 7, 0, 33, 44, 25, 40, 45, 12, 0, 37, 50, 0, 0,
+	0, 0, 0, 8, 0, 0, 0, 0, 0, 15, 17, 6, 0, 46, 51, 27,
+	47, 0, 0, 0, 0, 0, 9, 56, 0, 0, 0, 1, 0, 0, 54, 0,
+	16, 0, 0, 0, 0, 4, 43, 0, 0, 55, 0, 23, 21, 29, 18, 28,
+	0, 13, 35, 0, 24, 0, 5, 0, 41, 32, 0, 0, 0, 0, 0, 31
+};
+
+
+static int nsvg__nameId( const char* s )
+{
+	unsigned int h = nsvg__hashString( s );
+	int id = nsvg__nameSlots[( ( h * NSVG_NAME_MUL ) & 0xffffffffu ) >> 25];
+	return strcmp( nsvg__names[id], s ) == 0 ? id : NSVG_NAME_UNKNOWN;
+}
+
+static int nsvg__parseAttr( struct NSVGparser* p, int id, const char* value )
 {
 	float xform[6];
 	struct NSVGattrib* attr = nsvg__getAttr( p );
 	if( !attr )
 		return 0;
 
-	if( strcmp( name, "style" ) == 0 )
+	switch( id )
 	{
+	case NSVG_NAME_STYLE:
 		nsvg__parseStyle( p, value );
-	}
-	else if( strcmp( name, "display" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_DISPLAY:
 		if( strcmp( value, "none" ) == 0 )
 			attr->visible = 0;
 		/* Don't reset ->visible on display:inline, one display:none hides the
 		   whole subtree */
-	}
-	else if( strcmp( name, "fill" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_FILL:
 		if( strcmp( value, "none" ) == 0 )
 		{
 			attr->hasFill = 0;
@@ -2012,17 +2633,14 @@ static int nsvg__parseAttr(
 			attr->hasFill   = 1;
 			attr->fillColor = nsvg__parseColor( value );
 		}
-	}
-	else if( strcmp( name, "opacity" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_OPACITY:
 		attr->opacity = nsvg__parseOpacity( value );
-	}
-	else if( strcmp( name, "fill-opacity" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_FILL_OPACITY:
 		attr->fillOpacity = nsvg__parseOpacity( value );
-	}
-	else if( strcmp( name, "stroke" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_STROKE:
 		if( strcmp( value, "none" ) == 0 )
 		{
 			attr->hasStroke = 0;
@@ -2037,71 +2655,56 @@ static int nsvg__parseAttr(
 			attr->hasStroke   = 1;
 			attr->strokeColor = nsvg__parseColor( value );
 		}
-	}
-	else if( strcmp( name, "stroke-width" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_STROKE_WIDTH:
 		attr->strokeWidth =
 			nsvg__parseCoordinate( p, value, 0.0f, nsvg__actualLength( p ) );
-	}
-	else if( strcmp( name, "stroke-dasharray" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_STROKE_DASHARRAY:
 		attr->strokeDashCount =
 			nsvg__parseStrokeDashArray( p, value, attr->strokeDashArray );
-	}
-	else if( strcmp( name, "stroke-dashoffset" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_STROKE_DASHOFFSET:
 		attr->strokeDashOffset =
 			nsvg__parseCoordinate( p, value, 0.0f, nsvg__actualLength( p ) );
-	}
-	else if( strcmp( name, "stroke-opacity" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_STROKE_OPACITY:
 		attr->strokeOpacity = nsvg__parseOpacity( value );
-	}
-	else if( strcmp( name, "stroke-linecap" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_STROKE_LINECAP:
 		attr->strokeLineCap = nsvg__parseLineCap( value );
-	}
-	else if( strcmp( name, "stroke-linejoin" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_STROKE_LINEJOIN:
 		attr->strokeLineJoin = nsvg__parseLineJoin( value );
-	}
-	else if( strcmp( name, "stroke-miterlimit" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_STROKE_MITERLIMIT:
 		attr->miterLimit = nsvg__parseMiterLimit( value );
-	}
-	else if( strcmp( name, "fill-rule" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_FILL_RULE:
 		attr->fillRule = nsvg__parseFillRule( value );
-	}
-	else if( strcmp( name, "font-size" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_FONT_SIZE:
 		attr->fontSize =
 			nsvg__parseCoordinate( p, value, 0.0f, nsvg__actualLength( p ) );
-	}
-	else if( strcmp( name, "transform" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_TRANSFORM:
 		nsvg__parseTransform( xform, value );
 		nsvg__xformPremultiply( attr->xform, xform );
-	}
-	else if( strcmp( name, "stop-color" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_STOP_COLOR:
 		attr->stopColor = nsvg__parseColor( value );
-	}
-	else if( strcmp( name, "stop-opacity" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_STOP_OPACITY:
 		attr->stopOpacity = nsvg__parseOpacity( value );
-	}
-	else if( strcmp( name, "offset" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_OFFSET:
 		attr->stopOffset = nsvg__parseCoordinate( p, value, 0.0f, 1.0f );
-	}
-	else if( strcmp( name, "id" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_ID:
 		strncpy( attr->id, value, 63 );
 		attr->id[63] = '\0';
-	}
-	else
-	{
+		break;
+	default:
 		return 0;
 	}
 	return 1;
@@ -2144,7 +2747,7 @@ static int nsvg__parseNameValue(
 		memcpy( value, val, n );
 	value[n] = 0;
 
-	return nsvg__parseAttr( p, name, value );
+	return nsvg__parseAttr( p, nsvg__nameId( name ), value );
 }
 
 static void nsvg__parseStyle( struct NSVGparser* p, const char* str )
@@ -2177,12 +2780,7 @@ static void nsvg__parseAttribs( struct NSVGparser* p, const char** attr )
 {
 	int i;
 	for( i = 0; attr[i]; i += 2 )
-	{
-		if( strcmp( attr[i], "style" ) == 0 )
-			nsvg__parseStyle( p, attr[i + 1] );
-		else
-			nsvg__parseAttr( p, attr[i], attr[i + 1] );
-	}
+		nsvg__parseAttr( p, nsvg__nameId( attr[i] ), attr[i + 1] );
 }
 
 static int nsvg__getArgsPerElement( char cmd )
@@ -2585,25 +3183,18 @@ static void nsvg__parsePath( struct NSVGparser* p, const char** attr )
 	int nargs;
 	int rargs = 0;
 	float cpx, cpy, cpx2, cpy2;
-	const char* tmp[4];
 	char closedFlag;
 	int i;
-	char item[64];
+	char item;
+	float val;
 
 	for( i = 0; attr[i]; i += 2 )
 	{
-		if( strcmp( attr[i], "d" ) == 0 )
-		{
+		int id = nsvg__nameId( attr[i] );
+		if( id == NSVG_NAME_D )
 			s = attr[i + 1];
-		}
 		else
-		{
-			tmp[0] = attr[i];
-			tmp[1] = attr[i + 1];
-			tmp[2] = 0;
-			tmp[3] = 0;
-			nsvg__parseAttribs( p, tmp );
-		}
+			nsvg__parseAttr( p, id, attr[i + 1] );
 	}
 
 	if( s )
@@ -2618,13 +3209,13 @@ static void nsvg__parsePath( struct NSVGparser* p, const char** attr )
 
 		while( *s )
 		{
-			s = nsvg__getNextPathItem( s, item );
-			if( !*item )
+			s = nsvg__getNextPathItem( s, &item, &val );
+			if( !item )
 				break;
-			if( nsvg__isnum( item[0] ) )
+			if( nsvg__isnum( item ) )
 			{
 				if( nargs < 10 )
-					args[nargs++] = (float)nsvg__atof( item );
+					args[nargs++] = val;
 				if( nargs >= rargs )
 				{
 					switch( cmd )
@@ -2698,7 +3289,7 @@ static void nsvg__parsePath( struct NSVGparser* p, const char** attr )
 			}
 			else
 			{
-				cmd   = item[0];
+				cmd   = item;
 				rargs = nsvg__getArgsPerElement( cmd );
 				if( cmd == 'M' || cmd == 'm' )
 				{
@@ -2751,28 +3342,29 @@ static void nsvg__parseRect( struct NSVGparser* p, const char** attr )
 
 	for( i = 0; attr[i]; i += 2 )
 	{
-		if( !nsvg__parseAttr( p, attr[i], attr[i + 1] ) )
+		int id = nsvg__nameId( attr[i] );
+		if( !nsvg__parseAttr( p, id, attr[i + 1] ) )
 		{
-			if( strcmp( attr[i], "x" ) == 0 )
+			if( id == NSVG_NAME_X )
 				x = nsvg__parseCoordinate( p,
 					attr[i + 1],
 					nsvg__actualOrigX( p ),
 					nsvg__actualWidth( p ) );
-			if( strcmp( attr[i], "y" ) == 0 )
+			if( id == NSVG_NAME_Y )
 				y = nsvg__parseCoordinate( p,
 					attr[i + 1],
 					nsvg__actualOrigY( p ),
 					nsvg__actualHeight( p ) );
-			if( strcmp( attr[i], "width" ) == 0 )
+			if( id == NSVG_NAME_WIDTH )
 				w = nsvg__parseCoordinate(
 					p, attr[i + 1], 0.0f, nsvg__actualWidth( p ) );
-			if( strcmp( attr[i], "height" ) == 0 )
+			if( id == NSVG_NAME_HEIGHT )
 				h = nsvg__parseCoordinate(
 					p, attr[i + 1], 0.0f, nsvg__actualHeight( p ) );
-			if( strcmp( attr[i], "rx" ) == 0 )
+			if( id == NSVG_NAME_RX )
 				rx = fabsf( nsvg__parseCoordinate(
 					p, attr[i + 1], 0.0f, nsvg__actualWidth( p ) ) );
-			if( strcmp( attr[i], "ry" ) == 0 )
+			if( id == NSVG_NAME_RY )
 				ry = fabsf( nsvg__parseCoordinate(
 					p, attr[i + 1], 0.0f, nsvg__actualHeight( p ) ) );
 		}
@@ -2855,19 +3447,20 @@ static void nsvg__parseCircle( struct NSVGparser* p, const char** attr )
 
 	for( i = 0; attr[i]; i += 2 )
 	{
-		if( !nsvg__parseAttr( p, attr[i], attr[i + 1] ) )
+		int id = nsvg__nameId( attr[i] );
+		if( !nsvg__parseAttr( p, id, attr[i + 1] ) )
 		{
-			if( strcmp( attr[i], "cx" ) == 0 )
+			if( id == NSVG_NAME_CX )
 				cx = nsvg__parseCoordinate( p,
 					attr[i + 1],
 					nsvg__actualOrigX( p ),
 					nsvg__actualWidth( p ) );
-			if( strcmp( attr[i], "cy" ) == 0 )
+			if( id == NSVG_NAME_CY )
 				cy = nsvg__parseCoordinate( p,
 					attr[i + 1],
 					nsvg__actualOrigY( p ),
 					nsvg__actualHeight( p ) );
-			if( strcmp( attr[i], "r" ) == 0 )
+			if( id == NSVG_NAME_R )
 				r = fabsf( nsvg__parseCoordinate(
 					p, attr[i + 1], 0.0f, nsvg__actualLength( p ) ) );
 		}
@@ -2923,22 +3516,23 @@ static void nsvg__parseEllipse( struct NSVGparser* p, const char** attr )
 
 	for( i = 0; attr[i]; i += 2 )
 	{
-		if( !nsvg__parseAttr( p, attr[i], attr[i + 1] ) )
+		int id = nsvg__nameId( attr[i] );
+		if( !nsvg__parseAttr( p, id, attr[i + 1] ) )
 		{
-			if( strcmp( attr[i], "cx" ) == 0 )
+			if( id == NSVG_NAME_CX )
 				cx = nsvg__parseCoordinate( p,
 					attr[i + 1],
 					nsvg__actualOrigX( p ),
 					nsvg__actualWidth( p ) );
-			if( strcmp( attr[i], "cy" ) == 0 )
+			if( id == NSVG_NAME_CY )
 				cy = nsvg__parseCoordinate( p,
 					attr[i + 1],
 					nsvg__actualOrigY( p ),
 					nsvg__actualHeight( p ) );
-			if( strcmp( attr[i], "rx" ) == 0 )
+			if( id == NSVG_NAME_RX )
 				rx = fabsf( nsvg__parseCoordinate(
 					p, attr[i + 1], 0.0f, nsvg__actualWidth( p ) ) );
-			if( strcmp( attr[i], "ry" ) == 0 )
+			if( id == NSVG_NAME_RY )
 				ry = fabsf( nsvg__parseCoordinate(
 					p, attr[i + 1], 0.0f, nsvg__actualHeight( p ) ) );
 		}
@@ -2995,24 +3589,25 @@ static void nsvg__parseLine( struct NSVGparser* p, const char** attr )
 
 	for( i = 0; attr[i]; i += 2 )
 	{
-		if( !nsvg__parseAttr( p, attr[i], attr[i + 1] ) )
+		int id = nsvg__nameId( attr[i] );
+		if( !nsvg__parseAttr( p, id, attr[i + 1] ) )
 		{
-			if( strcmp( attr[i], "x1" ) == 0 )
+			if( id == NSVG_NAME_X1 )
 				x1 = nsvg__parseCoordinate( p,
 					attr[i + 1],
 					nsvg__actualOrigX( p ),
 					nsvg__actualWidth( p ) );
-			if( strcmp( attr[i], "y1" ) == 0 )
+			if( id == NSVG_NAME_Y1 )
 				y1 = nsvg__parseCoordinate( p,
 					attr[i + 1],
 					nsvg__actualOrigY( p ),
 					nsvg__actualHeight( p ) );
-			if( strcmp( attr[i], "x2" ) == 0 )
+			if( id == NSVG_NAME_X2 )
 				x2 = nsvg__parseCoordinate( p,
 					attr[i + 1],
 					nsvg__actualOrigX( p ),
 					nsvg__actualWidth( p ) );
-			if( strcmp( attr[i], "y2" ) == 0 )
+			if( id == NSVG_NAME_Y2 )
 				y2 = nsvg__parseCoordinate( p,
 					attr[i + 1],
 					nsvg__actualOrigY( p ),
@@ -3036,22 +3631,22 @@ static void nsvg__parsePoly( struct NSVGparser* p, const char** attr, int closeF
 	const char* s;
 	float args[2];
 	int nargs, npts = 0;
-	char item[64];
+	char item;
 
 	nsvg__resetPath( p );
 
 	for( i = 0; attr[i]; i += 2 )
 	{
-		if( !nsvg__parseAttr( p, attr[i], attr[i + 1] ) )
+		int id = nsvg__nameId( attr[i] );
+		if( !nsvg__parseAttr( p, id, attr[i + 1] ) )
 		{
-			if( strcmp( attr[i], "points" ) == 0 )
+			if( id == NSVG_NAME_POINTS )
 			{
 				s     = attr[i + 1];
 				nargs = 0;
 				while( *s )
 				{
-					s             = nsvg__getNextPathItem( s, item );
-					args[nargs++] = (float)nsvg__atof( item );
+					s = nsvg__getNextPathItem( s, &item, &args[nargs++] );
 					if( nargs >= 2 )
 					{
 						if( npts == 0 )
@@ -3076,44 +3671,40 @@ static void nsvg__parseSVG( struct NSVGparser* p, const char** attr )
 	int i;
 	for( i = 0; attr[i]; i += 2 )
 	{
-		if( !nsvg__parseAttr( p, attr[i], attr[i + 1] ) )
+		int id = nsvg__nameId( attr[i] );
+		if( !nsvg__parseAttr( p, id, attr[i + 1] ) )
 		{
-			if( strcmp( attr[i], "width" ) == 0 )
+			if( id == NSVG_NAME_WIDTH )
 			{
 				p->image->width =
 					nsvg__parseCoordinate( p, attr[i + 1], 0.0f, 0.0f );
 			}
-			else if( strcmp( attr[i], "height" ) == 0 )
+			else if( id == NSVG_NAME_HEIGHT )
 			{
 				p->image->height =
 					nsvg__parseCoordinate( p, attr[i + 1], 0.0f, 0.0f );
 			}
-			else if( strcmp( attr[i], "viewBox" ) == 0 )
+			else if( id == NSVG_NAME_VIEWBOX )
 			{
 				const char* s = attr[i + 1];
-				char buf[64];
-				s           = nsvg__parseNumber( s, buf, 64 );
-				p->viewMinx = nsvg__atof( buf );
+				s             = nsvg__parseFloat( s, &p->viewMinx );
 				while( *s && ( nsvg__isspace( *s ) || *s == '%' || *s == ',' ) )
 					s++;
 				if( !*s )
 					return;
-				s           = nsvg__parseNumber( s, buf, 64 );
-				p->viewMiny = nsvg__atof( buf );
+				s = nsvg__parseFloat( s, &p->viewMiny );
 				while( *s && ( nsvg__isspace( *s ) || *s == '%' || *s == ',' ) )
 					s++;
 				if( !*s )
 					return;
-				s            = nsvg__parseNumber( s, buf, 64 );
-				p->viewWidth = nsvg__atof( buf );
+				s = nsvg__parseFloat( s, &p->viewWidth );
 				while( *s && ( nsvg__isspace( *s ) || *s == '%' || *s == ',' ) )
 					s++;
 				if( !*s )
 					return;
-				s             = nsvg__parseNumber( s, buf, 64 );
-				p->viewHeight = nsvg__atof( buf );
+				s = nsvg__parseFloat( s, &p->viewHeight );
 			}
-			else if( strcmp( attr[i], "preserveAspectRatio" ) == 0 )
+			else if( id == NSVG_NAME_PRESERVEASPECTRATIO )
 			{
 				if( strstr( attr[i + 1], "none" ) != 0 )
 				{
@@ -3174,61 +3765,62 @@ static void nsvg__parseGradient( struct NSVGparser* p, const char** attr, char t
 
 	for( i = 0; attr[i]; i += 2 )
 	{
-		if( strcmp( attr[i], "id" ) == 0 )
+		int id = nsvg__nameId( attr[i] );
+		if( id == NSVG_NAME_ID )
 		{
 			strncpy( grad->id, attr[i + 1], 63 );
 			grad->id[63] = '\0';
 		}
-		else if( !nsvg__parseAttr( p, attr[i], attr[i + 1] ) )
+		else if( !nsvg__parseAttr( p, id, attr[i + 1] ) )
 		{
-			if( strcmp( attr[i], "gradientUnits" ) == 0 )
+			if( id == NSVG_NAME_GRADIENTUNITS )
 			{
 				if( strcmp( attr[i + 1], "objectBoundingBox" ) == 0 )
 					grad->units = NSVG_OBJECT_SPACE;
 				else
 					grad->units = NSVG_USER_SPACE;
 			}
-			else if( strcmp( attr[i], "gradientTransform" ) == 0 )
+			else if( id == NSVG_NAME_GRADIENTTRANSFORM )
 			{
 				nsvg__parseTransform( grad->xform, attr[i + 1] );
 			}
-			else if( strcmp( attr[i], "cx" ) == 0 )
+			else if( id == NSVG_NAME_CX )
 			{
 				grad->radial.cx = nsvg__parseCoordinateRaw( attr[i + 1] );
 			}
-			else if( strcmp( attr[i], "cy" ) == 0 )
+			else if( id == NSVG_NAME_CY )
 			{
 				grad->radial.cy = nsvg__parseCoordinateRaw( attr[i + 1] );
 			}
-			else if( strcmp( attr[i], "r" ) == 0 )
+			else if( id == NSVG_NAME_R )
 			{
 				grad->radial.r = nsvg__parseCoordinateRaw( attr[i + 1] );
 			}
-			else if( strcmp( attr[i], "fx" ) == 0 )
+			else if( id == NSVG_NAME_FX )
 			{
 				grad->radial.fx = nsvg__parseCoordinateRaw( attr[i + 1] );
 			}
-			else if( strcmp( attr[i], "fy" ) == 0 )
+			else if( id == NSVG_NAME_FY )
 			{
 				grad->radial.fy = nsvg__parseCoordinateRaw( attr[i + 1] );
 			}
-			else if( strcmp( attr[i], "x1" ) == 0 )
+			else if( id == NSVG_NAME_X1 )
 			{
 				grad->linear.x1 = nsvg__parseCoordinateRaw( attr[i + 1] );
 			}
-			else if( strcmp( attr[i], "y1" ) == 0 )
+			else if( id == NSVG_NAME_Y1 )
 			{
 				grad->linear.y1 = nsvg__parseCoordinateRaw( attr[i + 1] );
 			}
-			else if( strcmp( attr[i], "x2" ) == 0 )
+			else if( id == NSVG_NAME_X2 )
 			{
 				grad->linear.x2 = nsvg__parseCoordinateRaw( attr[i + 1] );
 			}
-			else if( strcmp( attr[i], "y2" ) == 0 )
+			else if( id == NSVG_NAME_Y2 )
 			{
 				grad->linear.y2 = nsvg__parseCoordinateRaw( attr[i + 1] );
 			}
-			else if( strcmp( attr[i], "spreadMethod" ) == 0 )
+			else if( id == NSVG_NAME_SPREADMETHOD )
 			{
 				if( strcmp( attr[i + 1], "pad" ) == 0 )
 					grad->spread = NSVG_SPREAD_PAD;
@@ -3237,7 +3829,7 @@ static void nsvg__parseGradient( struct NSVGparser* p, const char** attr, char t
 				else if( strcmp( attr[i + 1], "repeat" ) == 0 )
 					grad->spread = NSVG_SPREAD_REPEAT;
 			}
-			else if( strcmp( attr[i], "xlink:href" ) == 0 )
+			else if( id == NSVG_NAME_XLINK_HREF )
 			{
 				const char* href = attr[i + 1];
 				strncpy( grad->ref, href + 1, 62 );
@@ -3246,8 +3838,8 @@ static void nsvg__parseGradient( struct NSVGparser* p, const char** attr, char t
 		}
 	}
 
-	grad->next   = p->gradients;
-	p->gradients = grad;
+	if( !nsvg__addGradientData( p, grad ) )
+		free( grad );
 }
 
 static void nsvg__parseGradientStop( struct NSVGparser* p, const char** attr )
@@ -3255,7 +3847,7 @@ static void nsvg__parseGradientStop( struct NSVGparser* p, const char** attr )
 	struct NSVGattrib* curAttr = nsvg__getAttr( p );
 	struct NSVGgradientData* grad;
 	struct NSVGgradientStop* stop;
-	int i, idx;
+	int i, idx, hadStops;
 
 	curAttr->stopOffset  = 0;
 	curAttr->stopColor   = 0;
@@ -3263,7 +3855,7 @@ static void nsvg__parseGradientStop( struct NSVGparser* p, const char** attr )
 
 	for( i = 0; attr[i]; i += 2 )
 	{
-		nsvg__parseAttr( p, attr[i], attr[i + 1] );
+		nsvg__parseAttr( p, nsvg__nameId( attr[i] ), attr[i + 1] );
 	}
 
 	/* Add stop to the last gradient. */
@@ -3271,9 +3863,12 @@ static void nsvg__parseGradientStop( struct NSVGparser* p, const char** attr )
 	if( grad == NULL )
 		return;
 
+	hadStops = grad->stops != NULL;
 	grad->nstops++;
 	grad->stops = realloc(
 		grad->stops, sizeof( struct NSVGgradientStop ) * grad->nstops );
+	if( hadStops != ( grad->stops != NULL ) )
+		p->gradGen++;
 	if( grad->stops == NULL )
 		return;
 
@@ -3302,93 +3897,84 @@ static void nsvg__parseGradientStop( struct NSVGparser* p, const char** attr )
 static void nsvg__startElement( void* ud, const char* el, const char** attr )
 {
 	struct NSVGparser* p = ud;
+	int id               = nsvg__nameId( el );
 
 	if( p->defsFlag )
 	{
 		/* Skip everything but gradients in defs */
-		if( strcmp( el, "linearGradient" ) == 0 )
+		switch( id )
 		{
+		case NSVG_NAME_LINEARGRADIENT:
 			nsvg__parseGradient( p, attr, NSVG_PAINT_LINEAR_GRADIENT );
-		}
-		else if( strcmp( el, "radialGradient" ) == 0 )
-		{
+			break;
+		case NSVG_NAME_RADIALGRADIENT:
 			nsvg__parseGradient( p, attr, NSVG_PAINT_RADIAL_GRADIENT );
-		}
-		else if( strcmp( el, "stop" ) == 0 )
-		{
+			break;
+		case NSVG_NAME_STOP:
 			nsvg__parseGradientStop( p, attr );
+			break;
 		}
 		return;
 	}
 
-	if( strcmp( el, "g" ) == 0 )
+	switch( id )
 	{
+	case NSVG_NAME_G:
 		nsvg__pushAttr( p );
 		nsvg__parseAttribs( p, attr );
-	}
-	else if( strcmp( el, "path" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_PATH:
 		if( p->pathFlag ) /* Do not allow nested paths. */
 			return;
 		nsvg__pushAttr( p );
 		nsvg__parsePath( p, attr );
 		nsvg__popAttr( p );
-	}
-	else if( strcmp( el, "rect" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_RECT:
 		nsvg__pushAttr( p );
 		nsvg__parseRect( p, attr );
 		nsvg__popAttr( p );
-	}
-	else if( strcmp( el, "circle" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_CIRCLE:
 		nsvg__pushAttr( p );
 		nsvg__parseCircle( p, attr );
 		nsvg__popAttr( p );
-	}
-	else if( strcmp( el, "ellipse" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_ELLIPSE:
 		nsvg__pushAttr( p );
 		nsvg__parseEllipse( p, attr );
 		nsvg__popAttr( p );
-	}
-	else if( strcmp( el, "line" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_LINE:
 		nsvg__pushAttr( p );
 		nsvg__parseLine( p, attr );
 		nsvg__popAttr( p );
-	}
-	else if( strcmp( el, "polyline" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_POLYLINE:
 		nsvg__pushAttr( p );
 		nsvg__parsePoly( p, attr, 0 );
 		nsvg__popAttr( p );
-	}
-	else if( strcmp( el, "polygon" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_POLYGON:
 		nsvg__pushAttr( p );
 		nsvg__parsePoly( p, attr, 1 );
 		nsvg__popAttr( p );
-	}
-	else if( strcmp( el, "linearGradient" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_LINEARGRADIENT:
 		nsvg__parseGradient( p, attr, NSVG_PAINT_LINEAR_GRADIENT );
-	}
-	else if( strcmp( el, "radialGradient" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_RADIALGRADIENT:
 		nsvg__parseGradient( p, attr, NSVG_PAINT_RADIAL_GRADIENT );
-	}
-	else if( strcmp( el, "stop" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_STOP:
 		nsvg__parseGradientStop( p, attr );
-	}
-	else if( strcmp( el, "defs" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_DEFS:
 		p->defsFlag = 1;
-	}
-	else if( strcmp( el, "svg" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_SVG:
 		nsvg__parseSVG( p, attr );
+		break;
 	}
 }
 
@@ -3396,17 +3982,17 @@ static void nsvg__endElement( void* ud, const char* el )
 {
 	struct NSVGparser* p = ud;
 
-	if( strcmp( el, "g" ) == 0 )
+	switch( nsvg__nameId( el ) )
 	{
+	case NSVG_NAME_G:
 		nsvg__popAttr( p );
-	}
-	else if( strcmp( el, "path" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_PATH:
 		p->pathFlag = 0;
-	}
-	else if( strcmp( el, "defs" ) == 0 )
-	{
+		break;
+	case NSVG_NAME_DEFS:
 		p->defsFlag = 0;
+		break;
 	}
 }
 
@@ -1,18 +1,124 @@
 #include "pv.h"
+#include "bswap.h"
 #include "float16.h"
+#include "lz.h"
 
-#include <unilib/shand.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef PV_NO_THREADS
+#include <pthread.h>
+#endif /* PV_NO_THREADS */
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif /* __SSE2__ */
 
 #define HEADER_MAGIC_SZ 8
+#define HEADER_SZ 0x16
+#define HEADER_V1_SZ 0x1A
+#define HEADER_V2_SZ 0x1C
+#define HEADER_V3_SZ 0x20
+#define HEADER_V5_SZ 0x28
+
+/* The format version written out, at offset 0x03 of the magic */
+#define VERSION 5
+
+/* Header flag bits holding the coordinate encoding, one of PV_COORDS_* */
+#define FLAGS_COORDS 0x3
+
+/* Header flag bit for points stored as steps (see PREDICTED POINTS in pv.h) */
+#define FLAGS_PREDICT 0x4
+
+/* Header flag bit for bounds and points starting on ALIGN_SZ boundaries, and
+ * the one for them being little-endian (see ALIGNED FILES in pv.h) */
+#define FLAGS_ALIGN 0x8
+#define FLAGS_LITTLE 0x10
+
+/* Aligned files pad bounds and points out to multiples of this, counted from
+ * the start of the file */
+#define ALIGN_SZ 0x10
+
+/* Paths with at least this many stored coordinates have them in byte planes */
+#define PLANES_MIN 0x100
+
+/* Compressed files: the magic and unpacked size, then the blocks */
+#define ZHEADER_SZ 0xC
+#define ZVERSION 0
+
+/* Block size bit marking a block stored as it is */
+#define ZBLOCK_STORED 0x80000000U
 
 static const char k_header_magic[HEADER_MAGIC_SZ] =
-{0x8A, 'P', 'V', 0, '\r', '\n', 0x1A, '\n'};
+{0x8A, 'P', 'V', VERSION, '\r', '\n', 0x1A, '\n'};
+
+static const char k_zheader_magic[HEADER_MAGIC_SZ] =
+{0x8A, 'P', 'Z', ZVERSION, '\r', '\n', 0x1A, '\n'};
+
+/* Loaders and storers for the big-endian fields of the format. Buffers are
+ * not aligned to anything, so everything goes through bytes. */
+
+static unsigned short ld_u16( const unsigned char* p )
+{
+	return ( p[0] << 8 ) | p[1];
+}
+
+static unsigned ld_u32( const unsigned char* p )
+{
+	return ( (unsigned)( p[0] ) << 24 ) | ( (unsigned)( p[1] ) << 16 ) |
+		( (unsigned)( p[2] ) << 8 ) | p[3];
+}
+
+static float ld_f32( const unsigned char* p )
+{
+	unsigned u;
+	float f;
+
+	u = ld_u32( p );
+	memcpy( &f, &u, 4 );
+
+	return f;
+}
+
+static void st_u16( unsigned char* p, unsigned short v )
+{
+	p[0] = v >> 8;
+	p[1] = v & 0xFF;
+}
+
+static void st_u32( unsigned char* p, unsigned v )
+{
+	p[0] = v >> 24;
+	p[1] = ( v >> 16 ) & 0xFF;
+	p[2] = ( v >> 8 ) & 0xFF;
+	p[3] = v & 0xFF;
+}
+
+static void st_f32( unsigned char* p, float f )
+{
+	unsigned u;
+
+	memcpy( &u, &f, 4 );
+	st_u32( p, u );
+}
+
+/* Is the host little-endian? */
+static int host_le( void )
+{
+	unsigned u;
+	unsigned char c;
+
+	u = 1;
+	memcpy( &c, &u, 1 );
+
+	return c == 1;
+}
 
 #ifndef PV_NO_STDIO
 
 int pv_fchksig( FILE * f )
 {
-	int i, r;
+	int r;
 	char buf[0x16];
 
 	if( !f )
@@ -45,586 +151,5368 @@ int pv_fchksig( FILE * f )
 	return pv_chksig( (void*)( buf ) );
 }
 
-#endif /* PV_NO_STDIO */
-
-int pv_chksig( void* b )
+static int read_file( void* f, void* b, size_t n )
 {
-	char* c;
-	int i;
+	return fread( b, sizeof( char ), n, (FILE*)( f ) ) < n;
+}
 
-	c = (char*)( b );
+int pv_fpv2nsvg( FILE* f, struct NSVGimage* img )
+{
+	int r;
+	long sz;
+	unsigned char* b;
+	unsigned char sig[HEADER_MAGIC_SZ];
 
-	for( i = 0; i < 8; ++i )
+	if( !f || !img )
 	{
-		if( c[i] != k_header_magic[i] )
-		{
-			return -1;
-		}
+		return -1;
 	}
 
-	float canvas_w, canvas_h;
+	/* Compressed files stream in, even from pipes that cannot seek */
+	if( fseek( f, 0, SEEK_SET ) )
+	{
+		return pv_pv2nsvg_cb( read_file, f, img );
+	}
 
-	memcpy( &canvas_w, &( c[0x8] ), 4 );
-	memcpy( &canvas_h, &( c[0xC] ), 4 );
+	r = fread( sig, sizeof( char ), HEADER_MAGIC_SZ, f ) < HEADER_MAGIC_SZ;
+	r = r || fseek( f, 0, SEEK_SET );
 
-	if( !canvas_w || !canvas_h )
+	if( r )
 	{
-		return -1;
+		return -3;
 	}
 
-	return 0;
-}
+	if( !memcmp( sig, k_zheader_magic, HEADER_MAGIC_SZ ) )
+	{
+		return pv_pv2nsvg_cb( read_file, f, img );
+	}
 
-struct stop
-{
-	float offs;
-	unsigned col;
-};
+	/* Slurp the whole file so the decoder can run over it in one go */
+	r = fseek( f, 0, SEEK_END );
 
-struct gradient
-{
-	float xform[6];
-	float fx, fy;
-	int is_radial;
-	unsigned short stops_ct : 14;
-	unsigned short spread : 2;
-	struct stop* stops;
-};
+	if( r )
+	{
+		return -3;
+	}
 
-static int catalog_gradient(
-	struct NSVGshape* sh, int is_fill, struct gradient** grads, size_t* grads_sz )
-{
-	struct gradient* g;
-	size_t g_i, i;
-	char typ;
-	struct NSVGgradient* og;
+	sz = ftell( f );
 
-	/* null ref check */
-	if( !sh || !grads )
+	if( sz < 0 )
 	{
-		return -1;
+		return -3;
 	}
 
-	/* TODO: Scan existing catalog for duplicates */
+	r = fseek( f, 0, SEEK_SET );
+
+	if( r )
+	{
+		return -3;
+	}
 
-	/* Realloc array */
 	/* HEAP ALLOC */
-	g = realloc( *grads, ( sizeof( struct gradient ) * (*grads_sz) ) + 1 );
+	b = malloc( sz > 0 ? sz : 1 );
 
 	/* OoM check */
-	if( !g )
+	if( !b )
 	{
 		return -2;
 	}
 
-	*grads = g;
-	g_i    = *grads_sz;
-	*grads_sz++;
-
-	/* Get the right data fields */
-	typ = is_fill ? sh->fill.type : sh->stroke.type;
-	og  = is_fill ? sh->fill.gradient : sh->stroke.gradient;
-
-	/* Copy the fields anew */
-	for( i = 0; i < 6; ++i )
+	if( fread( b, sizeof( char ), sz, f ) < (size_t)( sz ) )
 	{
-		g[g_i].xform[i] = og->xform[i];
-	}
+		free( b );
 
-	g[g_i].fx        = og->fx;
-	g[g_i].fy        = og->fy;
-	g[g_i].is_radial = typ == NSVG_PAINT_RADIAL_GRADIENT ? 1 : 0;
-
-	/* Ensure valid bounds for bitfielded variables */
-	if( ( og->spread & 0x3 ) != og->spread )
-	{
 		return -3;
 	}
 
-	if( ( og->nstops & 0x3FFF ) != og->nstops )
-	{
-		return -4;
-	}
+	r = pv_pv2nsvg( b, sz, img );
 
-	g[g_i].spread   = og->spread & 0x3;
-	g[g_i].stops_ct = og->nstops & 0x3FFF;
+	free( b );
 
-	/* Allocate for the gradient stops */
-	/* HEAP ALLOC */
-	g[g_i].stops = malloc( sizeof( struct stop ) * g[g_i].stops_ct );
+	return r;
+}
 
-	/* OoM check */
-	if( !( g[g_i].stops ) )
+#endif /* PV_NO_STDIO */
+
+int pv_chksig( void* b )
+{
+	unsigned char* c;
+	float canvas_w, canvas_h;
+	int i;
+
+	c = (unsigned char*)( b );
+
+	for( i = 0; i < 8; ++i )
 	{
-		return -2;
+		/* Any version up to our own will do */
+		if( i == 3 ? c[i] > VERSION :
+						 c[i] != (unsigned char)( k_header_magic[i] ) )
+		{
+			return -1;
+		}
 	}
 
-	/* Copy the stop data */
-	for( i = 0; i < g[g_i].stops_ct; ++i )
+	canvas_w = ld_f32( &( c[0x8] ) );
+	canvas_h = ld_f32( &( c[0xC] ) );
+
+	if( !canvas_w || !canvas_h )
 	{
-		g[g_i].stops[i].offs = og->stops[i].offset;
-		g[g_i].stops[i].col  = og->stops[i].color;
+		return -1;
 	}
 
 	return 0;
 }
 
-#define TMPBUF_CPY_WRITE( OBJ, N )             \
-	do                                          \
-	{                                           \
-		memcpy( buf, ( OBJ ), N );               \
-		r = fwrite( buf, sizeof( char ), N, f ); \
-		if( r < N )                              \
-		{                                        \
-			return -2;                            \
-		}                                        \
-	} while( 0 )
+/* Paint type used while decoding for a gradient that has not been read yet;
+ * the paint colour holds the gradient ID until the table is reached. */
+#define PAINT_GRADIENT_REF 0x7F
 
-#define TMPBUF_WRITE(BUF, PTR, SZ, F) do { \
-		memcpy( (BUF), (OBJ), (SZ) ); \
-		if(fwrite( (BUF), sizeof(u8), (SZ), (F))) { \
-			return -2; \
-		} \
-	} while(0)
-#define FWRITE_WRAP(F, D, S, C) do { \
-	if(fwrite( D, S, C, F ) < S) { return -2; } while(0)
+/* Arena records start on multiples of this, enough for any of them */
+#define ARENA_ALIGN 0x10
 
-static
+/* One block that every record of a decoded image is carved out of, sized
+ * beforehand, with the first shape at its start */
+struct arena
+{
+	unsigned char* b;
+	size_t i, sz;
+};
 
-static int process_shape( struct NSVGshape* shape, FILE* f )
+/* Bytes an arena record of N bytes takes */
+static size_t arena_rec_sz( size_t n )
 {
-	u8 opts;
+	return ( n + ARENA_ALIGN - 1 ) & ~( (size_t)( ARENA_ALIGN ) - 1 );
+}
 
-	if(f == NULL ) { return -1; }
+/* Allocate N bytes from arena A, or on the heap without one */
+static void* rec_alloc( struct arena* a, size_t n )
+{
+	void* p;
 
-	if( shape == NULL )
+	if( !a )
 	{
-		return 0;
+		/* HEAP ALLOC */
+		return malloc( n );
 	}
 
-	opts = 0;
+	n = arena_rec_sz( n );
 
-	/* set the fill type */
-	switch(shape->fill.type)
+	/* The arena was sized for exactly these records */
+	if( a->sz - a->i < n )
 	{
-	case NSVG_PAINT_LINEAR_GRADIENT:
-	case NSVG_PAINT_RADIAL_GRADIENT:
-		opts |= 1 << 4;
-		/* goto case; */
-	case NSVG_PAINT_COLOR:
-		opts |= 1;
-		/* goto case; */
-	case NSVG_PAINT_NONE:
-		break;
+		return NULL;
 	}
 
-	/* set the stroke type */
-	switch( shape->stroke.type )
+	p = a->b + a->i;
+	a->i += n;
+
+	return p;
+}
+
+/* Give back record P from rec_alloc(); arena records go with the arena */
+static void rec_free( struct arena* a, void* p )
+{
+	if( !a )
 	{
-	case NSVG_PAINT_LINEAR_GRADIENT:
-	case NSVG_PAINT_RADIAL_GRADIENT:
-		opts |= 1 << 5;
-		/* goto case; */
-	case NSVG_PAINT_COLOR:
-		opts |= 1 << 1;
-		/* goto case; */
-	case NSVG_PAINT_NONE:
-		break;
+		free( p );
 	}
+}
 
-	/* is not fully opaque? */
-	opts |= shape->opacity < 1.0f ? 1 << 3 : 0;
+struct cursor
+{
+	const unsigned char* b;
+	size_t sz;
+	size_t i;
+	/* the buffer style records are read from, which is only not B when
+	 * decoding a compressed file */
+	const unsigned char* pre;
+	size_t pre_sz;
+	/* the palette colour fields index into, if the file has one */
+	const unsigned char* pal;
+	unsigned pal_ct;
+	/* the style offset table, if the file has one */
+	const unsigned char* styles;
+	unsigned style_ct;
+	/* do paths tag their segments? */
+	int seg_tags;
+	/* the coordinate encoding, and the grid step if on a grid */
+	int coords;
+	float quantum;
+	/* are points stored as steps? */
+	int predict;
+	/* are bounds and points aligned, and are they little-endian? */
+	int align;
+	int little;
+	/* the file offset B is at, which alignment is counted from */
+	size_t base;
+	/* where decoded shapes and paths go, or NULL to allocate each */
+	struct arena* arena;
+	/* only find where records end, leaving indexed styles and bounds
+	 * unread? */
+	int skim;
+};
 
-	/* stroke has dashes? */
-	opts |= shape->strokeDashOffset > 0 && shape->strokeDashCount > 0 ?
-		1 << 2 : 0;
+/* Is the cursor short of N bytes? */
+#define CUR_SHORT( C, N ) ( (C)->sz - (C)->i < (size_t)( N ) )
 
-	/* record fill rule */
-	opts |= ( shape->fillRule & 1 ) << 6;
+/* Bytes per style index, which are as few as the number of styles allows */
+static int style_idx_w( size_t style_ct )
+{
+	if( style_ct <= 0x100 )
+	{
+		return 1;
+	}
+
+	return style_ct <= 0x10000 ? 2 : 4;
 }
 
-int pv_fnsvg2pv( struct NSVGimage* svg, FILE* f )
+/* Start a cursor at offset I of the buffer a view is over */
+static void cur_init( struct cursor* c, const struct pv_view* v, size_t i )
 {
-	int r;
-	unsigned char buf[4], opts;
-	unsigned i, j, shape_ct, grads_ct;
-	struct NSVGshape* cur_shape;
-	struct gradient* grads;
+	c->b      = v->b;
+	c->sz     = v->sz;
+	c->i      = i;
+	c->pre    = v->b;
+	c->pre_sz = v->sz;
+	c->pal      = v->pal_ct ? v->b + v->pal_offs : NULL;
+	c->pal_ct   = v->pal_ct;
+	c->styles   = v->style_ct ? v->b + v->styles_offs : NULL;
+	c->style_ct = v->style_ct;
+	c->seg_tags = v->ver >= 4;
+	c->coords   = v->flags & FLAGS_COORDS;
+	c->quantum  = v->quantum;
+	c->predict  = ( v->flags & FLAGS_PREDICT ) != 0;
+	c->align    = ( v->flags & FLAGS_ALIGN ) != 0;
+	c->little   = ( v->flags & FLAGS_LITTLE ) != 0;
+	c->base     = 0;
+	c->arena    = NULL;
+	c->skim     = 0;
+}
+
+/* Bytes of padding needed at file offset I to reach an ALIGN_SZ boundary */
+static size_t pad_sz( size_t i )
+{
+	return ( ALIGN_SZ - ( i & ( ALIGN_SZ - 1 ) ) ) & ( ALIGN_SZ - 1 );
+}
 
-	grads    = NULL;
-	grads_ct = 0;
+/* Skip the padding before bounds or points, if the file has any */
+static int cur_align( struct cursor* c )
+{
+	size_t n;
 
-	if( !svg || !f )
+	if( !( c->align ) )
 	{
-		return -1;
+		return 0;
 	}
 
-	r = fseek( f, 0, SEEK_SET );
+	n = pad_sz( c->base + c->i );
 
-	if( r )
+	if( CUR_SHORT( c, n ) )
 	{
-		return -2;
+		return -3;
 	}
 
-	FWRITE_WRAP( f, k_header_magic, sizeof(u8), HEADER_MAGIC_SZ );
+	c->i += n;
 
-	TMPBUF_WRITE( buf, &(svg->width), 4, f );
-	TMPBUF_WRITE( buf, &(svg->width), 4, f );
+	return 0;
+}
 
-	shape_ct  = 0;
-	cur_shape = svg->shapes;
+/* Fewest bytes a path record can take */
+static size_t path_min_sz( const struct cursor* c )
+{
+	switch( c->coords )
+	{
+	case PV_COORDS_GRID:
+		/* a byte for the count, four for the bounds and one for the size of
+		 * the points */
+		return 6;
+	case PV_COORDS_F16:
+		return 0xC;
+	default:
+		return 0x14;
+	}
+}
 
-	while( cur_shape != NULL )
+/* Fewest bytes a shape record can take */
+static size_t shape_min_sz( const struct cursor* c )
+{
+	switch( c->coords )
 	{
-		long path_ct_pos, cur_pos;
-		unsigned short miter;
-		struct NSVGpath* cur_path;
-		unsigned path_ct;
+	case PV_COORDS_GRID:
+		/* a byte for the style, four for the bounds and one for the count */
+		return 6;
+	case PV_COORDS_F16:
+		return 0xD;
+	default:
+		return 0x15;
+	}
+}
 
-		opts = 0;
-		shape_ct++;
+/* Number of whole segments in a path of N points */
+static unsigned seg_ct( unsigned npts )
+{
+	return npts > 0 ? ( npts - 1 ) / 3 : 0;
+}
 
-		switch( cur_shape->fill.type )
-		{
-		case NSVG_PAINT_LINEAR_GRADIENT:
-		case NSVG_PAINT_RADIAL_GRADIENT:
-			opts |= 1 << 4;
-			/* goto case; */
-		case NSVG_PAINT_COLOR:
-			opts |= 1;
-			/* goto case; */
-		case NSVG_PAINT_NONE:
-			break;
-		}
+static void free_shapes( struct NSVGshape* sh )
+{
+	struct NSVGshape* sh_next;
+	struct NSVGpath *p, *p_next;
+
+	while( sh != NULL )
+	{
+		sh_next = sh->next;
 
-		switch( cur_shape->stroke.type )
+		for( p = sh->paths; p != NULL; p = p_next )
 		{
-		case NSVG_PAINT_LINEAR_GRADIENT:
-		case NSVG_PAINT_RADIAL_GRADIENT:
-			opts |= 1 << 5;
-			/* goto case; */
-		case NSVG_PAINT_COLOR:
-			opts |= 1 << 1;
-			/* goto case; */
-		case NSVG_PAINT_NONE:
-			break;
+			p_next = p->next;
+			free( p->pts );
+			free( p );
 		}
 
-		if( cur_shape->opacity < 1.0f )
+		if( sh->fill.type == NSVG_PAINT_LINEAR_GRADIENT ||
+			sh->fill.type == NSVG_PAINT_RADIAL_GRADIENT )
 		{
-			opts |= 1 << 3;
+			free( sh->fill.gradient );
 		}
 
-		if( cur_shape->strokeDashOffset > 0 && cur_shape->strokeDashCount > 0 )
+		if( sh->stroke.type == NSVG_PAINT_LINEAR_GRADIENT ||
+			sh->stroke.type == NSVG_PAINT_RADIAL_GRADIENT )
 		{
-			opts |= 1 << 2;
+			free( sh->stroke.gradient );
 		}
 
-		opts |= ( ( cur_shape->fillRule & 1 ) << 6 ) |
-			( ( cur_shape->flags & NSVG_FLAGS_VISIBLE ) ? 1 << 7 : 0 );
+		free( sh );
+		sh = sh_next;
+	}
+}
 
-#define WRITE_COLOURS( N )                                                 \
-	do                                                                      \
-	{                                                                       \
-		if( opts & ( 1 << N ) )                                              \
-		{                                                                    \
-			if( opts & ( 1 << ( 4 + N ) ) )                                   \
-			{                                                                 \
-				size_t grads_i;                                                \
-				grads_i = grads_ct;                                            \
-				r       = catalog_gradient( cur_shape, N, &grads, &grads_ct ); \
-				if( r < 0 )                                                    \
-				{                                                              \
-					return -10 + r;                                             \
-				}                                                              \
-				if( r == 0 )                                                   \
-				{                                                              \
-					TMPBUF_CPY_WRITE( &( grads_i ), 2 );                        \
-					/* if r is positive, the gradient already exists */         \
-				}                                                              \
-			}                                                                 \
-			else                                                              \
-			{                                                                 \
-				struct NSVGpaint p = N == 1 ? cur_shape->fill : cur_shape->stroke; \
-				buf[0]      = p.color & 0xFF;                                  \
-				buf[1]      = ( p.color >> 8 ) & 0xFF;                         \
-				buf[2]      = ( p.color >> 16 ) & 0xFF;                        \
-				r           = fwrite( buf, sizeof( char ), 3, f );             \
-				if( r < 3 )                                                    \
-				{                                                              \
-					return -2;                                                  \
-				}                                                              \
-			}                                                                 \
-		}                                                                    \
-	} while( 0 )
+static void ld_f32_n( float* o, const unsigned char* p, size_t n )
+{
+	pv_bswap32_n( o, p, n );
+}
 
-		WRITE_COLOURS( 1 ); /* fill comes first */
-		WRITE_COLOURS( 0 );
+static void ld_f16_n( float* o, const unsigned char* p, size_t n, int le )
+{
+	unsigned short h[0x100];
+	size_t k;
 
-#undef WRITE_COLOURS
+	/* Gather the halves a chunk at a time for the batch conversion */
+	while( n > 0 )
+	{
+		k = n < 0x100 ? n : 0x100;
 
-		if( opts & ( 1 << 3 ) )
+		if( le )
 		{
-			/* Record opacity as 8-bit fixed point */
-			buf[0] = ( cur_shape->opacity * ( ( 1 << 8 ) - 1 ) );
-
-			r = fwrite( buf, sizeof( char ), 1, f );
-
-			if( r < 1 )
-			{
-				return -2;
-			}
+			pv_le16_n( h, p, k );
 		}
-
-		if( opts & ( 1 << 1 ) )
+		else
 		{
-			/* Record stroke properties */
-			unsigned short stroke_w;
-			unsigned char join_cap;
+			pv_bswap16_n( h, p, k );
+		}
+
+		pv_f16_16to32_n( o, h, k );
+		o += k;
+		p += k * 2;
+		n -= k;
+	}
+}
 
-			stroke_w = pv_f16_32to16( cur_shape->strokeWidth );
+/* Bytes per coordinate when stored as floats, either float32 or float16 */
+static size_t coord_sz( int coords )
+{
+	return coords == PV_COORDS_F16 ? 2 : 4;
+}
 
-			r = fwrite( &stroke_w, sizeof( char ), 2, f );
+/* Gather the bit patterns of stored coordinates I to I+K of the N there are,
+ * each W bytes, laid out one after another or in byte planes */
+static void ld_bits_n( unsigned* u, const unsigned char* p, size_t i,
+	size_t k, size_t n, size_t w )
+{
+	size_t j;
 
-			if( r < 2 )
-			{
-				return -2;
-			}
+	if( n < PLANES_MIN && w == 4 )
+	{
+		pv_bswap32_n( u, p + ( i * 4 ), k );
 
-			if( opts & ( 1 << 2 ) )
-			{
-				/* Record dash characteristics */
-				unsigned short stroke_dash_offs;
-				unsigned char dash_ct;
+		return;
+	}
+
+	if( n < PLANES_MIN )
+	{
+		for( j = 0; j < k; ++j )
+		{
+			u[j] = ld_u16( p + ( ( i + j ) * 2 ) );
+		}
 
-				stroke_dash_offs = pv_f16_32to16( cur_shape->strokeDashOffset );
+		return;
+	}
 
-				r = fwrite( &stroke_dash_offs, sizeof( char ), 2, f );
+	p += i;
 
-				if( r < 2 )
-				{
-					return -2;
-				}
+	for( j = 0; j < k && w == 4; ++j )
+	{
+		u[j] = ( (unsigned)( p[j] ) << 24 ) | ( (unsigned)( p[n + j] ) << 16 ) |
+			( (unsigned)( p[( n * 2 ) + j] ) << 8 ) | p[( n * 3 ) + j];
+	}
 
-				dash_ct = cur_shape->strokeDashCount;
+	for( j = 0; j < k && w == 2; ++j )
+	{
+		u[j] = ( (unsigned)( p[j] ) << 8 ) | p[n + j];
+	}
+}
 
-				r = fwrite( &dash_ct, sizeof( char ), 1, f );
+#ifdef __SSE2__
 
-				if( r < 1 )
-				{
-					return -2;
-				}
+/* As ld_pred_n, for float32 byte planes, sixteen coordinates at a time. Sets
+ * *X and *Y to the last of each, and returns how many were loaded */
+static size_t ld_planes_f32(
+	float* o, const unsigned char* p, size_t n, unsigned* x, unsigned* y )
+{
+	__m128i b0, b1, b2, b3, lo, hi, v[4], c;
+	size_t i;
+	int j;
 
-				for( i = 0; i < dash_ct; ++i )
-				{
-					unsigned short dash;
+	c = _mm_setzero_si128( );
 
-					dash = pv_f16_32to16( cur_shape->strokeDashArray[i] );
+	for( i = 0; i + 16 <= n; i += 16 )
+	{
+		b0 = _mm_loadu_si128( (const __m128i*)( p + i ) );
+		b1 = _mm_loadu_si128( (const __m128i*)( p + n + i ) );
+		b2 = _mm_loadu_si128( (const __m128i*)( p + ( n * 2 ) + i ) );
+		b3 = _mm_loadu_si128( (const __m128i*)( p + ( n * 3 ) + i ) );
+
+		/* Interleave the planes back into host order, least significant
+		 * byte first */
+		lo   = _mm_unpacklo_epi8( b3, b2 );
+		hi   = _mm_unpacklo_epi8( b1, b0 );
+		v[0] = _mm_unpacklo_epi16( lo, hi );
+		v[1] = _mm_unpackhi_epi16( lo, hi );
+		lo   = _mm_unpackhi_epi8( b3, b2 );
+		hi   = _mm_unpackhi_epi8( b1, b0 );
+		v[2] = _mm_unpacklo_epi16( lo, hi );
+		v[3] = _mm_unpackhi_epi16( lo, hi );
+
+		/* Sum the steps of each pair of x and y onto the last pair */
+		for( j = 0; j < 4; ++j )
+		{
+			v[j] = _mm_add_epi32( v[j], _mm_slli_si128( v[j], 8 ) );
+			v[j] = _mm_add_epi32( v[j], c );
+			c    = _mm_shuffle_epi32( v[j], _MM_SHUFFLE( 3, 2, 3, 2 ) );
 
-					r = fwrite( &dash, sizeof( char ), 2, f );
+			_mm_storeu_si128( (__m128i*)( o + i + ( j * 4 ) ), v[j] );
+		}
+	}
 
-					if( r < 2 )
-					{
-						return -2;
-					}
-				}
-			}
+	*x = (unsigned)( _mm_cvtsi128_si32( c ) );
+	*y = (unsigned)( _mm_cvtsi128_si32( _mm_srli_si128( c, 4 ) ) );
 
-			/* Record line join and cap styling */
-			join_cap = ( cur_shape->strokeLineJoin & 0x3 ) |
-				( ( cur_shape->strokeLineCap & 0x3 ) << 2 );
+	return i;
+}
 
-			r = fwrite( &join_cap, sizeof( char ), 1, f );
+#endif /* __SSE2__ */
 
-			if( r < 1 )
-			{
-				return -2;
-			}
-		}
+/* Load N coordinates stored as floats, each the step from the bit pattern of
+ * the one two before it */
+static void ld_pred_n(
+	float* o, const unsigned char* p, size_t n, int coords )
+{
+	unsigned u[0x100];
+	unsigned short h[0x100];
+	unsigned x, y;
+	size_t i, j, k, w;
+
+	w = coord_sz( coords );
+	x = 0;
+	y = 0;
+	i = 0;
+
+#ifdef __SSE2__
+	if( w == 4 && n >= PLANES_MIN )
+	{
+		i = ld_planes_f32( o, p, n, &x, &y );
+	}
+#endif /* __SSE2__ */
 
-		/* Record the miter limit */
-		miter = pv_f16_32to16( cur_shape->miterLimit );
+	/* Chunks are even, so x and y keep to their places in them */
+	for( ; i < n; i += k )
+	{
+		k = n - i < 0x100 ? n - i : 0x100;
 
-		r = fwrite( &miter, sizeof( char ), 2, f );
+		ld_bits_n( u, p, i, k, n, w );
 
-		if( r < 2 )
+		for( j = 0; j + 1 < k; j += 2 )
 		{
-			return -2;
+			x += u[j];
+			y += u[j + 1];
+			u[j]     = x;
+			u[j + 1] = y;
 		}
 
-		/* Record shape bounds */
-		for( i = 0; i < 4; ++i )
+		if( w == 4 )
 		{
-			TMPBUF_CPY_WRITE( &( cur_shape->bounds[i] ), 4 );
-		}
-
-		/* Once all paths are written, we’ll come back to set this */
-		path_ct_pos = ftell( f );
+			memcpy( o + i, u, k * 4 );
 
-		r = fwrite( buf, sizeof( char ), 4, f ); /* buf is garbage for now */
+			continue;
+		}
 
-		if( r < 4 )
+		for( j = 0; j < k; ++j )
 		{
-			return -2;
+			h[j] = u[j] & 0xFFFF;
 		}
 
-		/* Record all paths */
-		path_ct  = 0;
-		cur_path = cur_shape->paths;
+		pv_f16_16to32_n( o + i, h, k );
+	}
+}
 
-		while( cur_path != NULL )
-		{
-			unsigned elem_ct, npts;
+/* Load N coordinates stored as floats, little-endian if LE is nonzero */
+static void ld_coords_n(
+	float* o, const unsigned char* p, size_t n, int coords, int le )
+{
+	if( coords == PV_COORDS_F16 )
+	{
+		ld_f16_n( o, p, n, le );
 
-			path_ct++;
+		return;
+	}
 
-			elem_ct = cur_path->npts < 0 ? 0 : cur_path->npts;
-			npts    = elem_ct; /* used as a count later, elem_ct is bitwised */
-			elem_ct >>= 1; /* divide by 2 bitwise */
-			elem_ct |= ( cur_path->closed == 1 ? 1 : 0 ) << 31;
+	if( le )
+	{
+		pv_le32_n( o, p, n );
 
-			r = fwrite( &elem_ct, sizeof( char ), 4, f );
+		return;
+	}
 
-			if( r < 4 )
-			{
-				return -2;
-			}
+	ld_f32_n( o, p, n );
+}
 
-			for( i = 0; i < 4; ++i )
-			{
-				r = fwrite( cur_path->bounds, sizeof( float ), 4, f );
+/* Two's complement reading of an unsigned, without leaning on the
+ * implementation to convert it */
+static int as_int( unsigned u )
+{
+	return u <= 0x7FFFFFFFU ? (int)( u ) : -(int)( ~u ) - 1;
+}
 
-				if( r < 4 )
-				{
-					return -2;
-				}
-			}
+/* Undo the zig-zag mapping of signed numbers, keeping the result unsigned so
+ * it can be added on with wraparound */
+static unsigned unzigzag( unsigned u )
+{
+	return ( u >> 1 ) ^ ( 0U - ( u & 1 ) );
+}
+
+/* Read a varint of no more than five bytes */
+static int cur_varint( struct cursor* c, unsigned* u )
+{
+	const unsigned char* d;
+	unsigned n;
+
+	d  = c->b + c->i;
+	*u = 0;
+
+	for( n = 0; n < 5 && !CUR_SHORT( c, n + 1 ); ++n )
+	{
+		*u |= (unsigned)( d[n] & 0x7F ) << ( n * 7 );
+
+		if( !( d[n] & 0x80 ) )
+		{
+			c->i += n + 1;
+
+			return 0;
+		}
+	}
+
+	return -3;
+}
+
+/* Read grid bounds into float bounds of (min_x, min_y, max_x, max_y) */
+static int read_grid_bounds( struct cursor* c, float* b )
+{
+	unsigned u[4];
+	int i, r;
+
+	for( i = 0; i < 4; ++i )
+	{
+		r = cur_varint( c, u + i );
+
+		if( r )
+		{
+			return r;
+		}
+	}
+
+	/* The width and height are counted from the minimum */
+	u[0] = unzigzag( u[0] );
+	u[1] = unzigzag( u[1] );
+	u[2] += u[0];
+	u[3] += u[1];
+
+	for( i = 0; i < 4; ++i )
+	{
+		b[i] = (float)( as_int( u[i] ) * (double)( c->quantum ) );
+	}
+
+	return 0;
+}
+
+/* Grid coordinates being read off a path, each pair a step from the pair
+ * before */
+struct grid_rd
+{
+	const unsigned char* d;
+	const unsigned char* end;
+	unsigned x, y;
+	double q;
+	/* set once the bytes run out or a varint runs too long */
+	int bad;
+};
+
+static void grid_rd_init(
+	struct grid_rd* g, const void* d, size_t sz, float q )
+{
+	g->d   = (const unsigned char*)( d );
+	g->end = g->d + sz;
+	g->x   = 0;
+	g->y   = 0;
+	g->q   = q;
+	g->bad = 0;
+}
+
+/* Read a varint without checking for the end of the bytes, which there must
+ * be at least five of. Returns NULL if it runs longer than that */
+static const unsigned char* ld_varint( const unsigned char* d, unsigned* u )
+{
+	unsigned v, b, s;
+
+	v = *( d++ );
+
+	/* Most steps fit in one byte */
+	if( !( v & 0x80 ) )
+	{
+		*u = v;
+
+		return d;
+	}
+
+	v &= 0x7F;
+
+	for( s = 7; s <= 28; s += 7 )
+	{
+		b = *( d++ );
+		v |= ( b & 0x7F ) << s;
+
+		if( !( b & 0x80 ) )
+		{
+			*u = v;
+
+			return d;
+		}
+	}
+
+	return NULL;
+}
+
+/* Read N / 2 points into O as floats. Whatever cannot be read is zeroed */
+static void grid_rd_n( struct grid_rd* g, float* o, size_t n )
+{
+	unsigned char tail[0x10];
+	const unsigned char *d, *end;
+	unsigned u, v, x, y;
+	double q;
+	size_t k;
+
+	if( g->bad )
+	{
+		memset( o, 0, sizeof( float ) * n );
+
+		return;
+	}
+
+	/* Keep the running point out of memory while reading */
+	d = g->d;
+	x = g->x;
+	y = g->y;
+	q = g->q;
+	k = 0;
+
+	/* While two of the longest varints fit, nothing needs checking */
+	for( ; k < n && g->end - d >= 10; k += 2 )
+	{
+		d = ld_varint( d, &u );
+		d = d ? ld_varint( d, &v ) : NULL;
+
+		if( !d )
+		{
+			break;
+		}
 
-			/* Write the beziér */
-			r = fwrite( cur_path->pts, sizeof( float ), npts, f );
+		x += unzigzag( u );
+		y += unzigzag( v );
+		o[k]     = (float)( as_int( x ) * q );
+		o[k + 1] = (float)( as_int( y ) * q );
+	}
+
+	/* The last few bytes go through a copy with zeroes after them, which end
+	 * any varint, so the same reader never goes past them */
+	if( d && k < n )
+	{
+		memset( tail, 0, sizeof( tail ) );
+		memcpy( tail, d, g->end - d );
+
+		end = tail + ( g->end - d );
+		d   = tail;
 
-			if( r < npts )
+		for( ; k < n && d < end; k += 2 )
+		{
+			d = ld_varint( d, &u );
+			d = d ? ld_varint( d, &v ) : NULL;
+
+			if( !d || d > end )
 			{
-				return -2;
+				break;
 			}
 
-			cur_path = cur_path->next;
+			x += unzigzag( u );
+			y += unzigzag( v );
+			o[k]     = (float)( as_int( x ) * q );
+			o[k + 1] = (float)( as_int( y ) * q );
 		}
 
-		/* Write in the number of paths now */
-		cur_pos = ftell( f );
+		d = k < n ? NULL : g->end - ( end - d );
+	}
+
+	g->x = x;
+	g->y = y;
+	g->d = d ? d : g->end;
+
+	if( k < n )
+	{
+		g->bad = 1;
+		memset( o + k, 0, sizeof( float ) * ( n - k ) );
+	}
+}
 
-		r = fseek( f, path_ct_pos, SEEK_SET );
+static int read_paint(
+	struct cursor* c, unsigned char opts, int n, unsigned* p )
+{
+	const unsigned char* d;
+	unsigned idx;
 
-		if( r )
+	if( !( opts & ( 1 << n ) ) )
+	{
+		*p = 0;
+
+		return 0;
+	}
+
+	if( opts & ( 1 << ( 4 + n ) ) )
+	{
+		if( CUR_SHORT( c, 2 ) )
 		{
 			return -3;
 		}
 
-		r = fwrite( &path_ct, sizeof( char ), 4, f );
+		*p = ld_u16( c->b + c->i );
+		c->i += 2;
+
+		return 0;
+	}
+
+	if( c->pal )
+	{
+		/* Indices are as narrow as the palette allows */
+		if( c->pal_ct <= 0x100 )
+		{
+			if( CUR_SHORT( c, 1 ) )
+			{
+				return -3;
+			}
 
-		if( r < 4 )
+			idx = c->b[c->i];
+			c->i += 1;
+		}
+		else
 		{
-			return -2;
+			if( CUR_SHORT( c, 2 ) )
+			{
+				return -3;
+			}
+
+			idx = ld_u16( c->b + c->i );
+			c->i += 2;
 		}
 
-		r = fseek( f, cur_pos, SEEK_SET );
+		if( idx >= c->pal_ct )
+		{
+			return -3;
+		}
 
-		if( r )
+		d = c->pal + ( idx * 3 );
+	}
+	else
+	{
+		if( CUR_SHORT( c, 3 ) )
 		{
 			return -3;
 		}
 
-		cur_shape = cur_shape->next;
+		d = c->b + c->i;
+		c->i += 3;
 	}
 
-	cur_pos = ftell( f );
+	/* RRGGBB on disk, 0xAABBGGRR in memory */
+	*p = d[0] | ( d[1] << 8 ) | ( d[2] << 16 ) | 0xFF000000;
+
+	return 0;
+}
 
-	/* Record the number of shapes */
-	r = fseek( f, 0x10, SEEK_SET );
+/* Read a style record, from the sentinel up to the miter limit */
+static int read_style( struct cursor* c, struct pv_vshape* s )
+{
+	const unsigned char* d;
+	unsigned char opts;
+	unsigned i;
+	int r;
 
-	if( r )
+	if( CUR_SHORT( c, 1 ) )
 	{
 		return -3;
 	}
 
-	r = fwrite( &shape_ct, sizeof( char ), 4, f );
+	opts    = c->b[c->i];
+	s->opts = opts;
+	c->i += 1;
+
+	r = read_paint( c, opts, 0, &( s->fill ) );
 
-	if( r < 4 )
+	if( r )
 	{
-		return -2;
+		return r;
 	}
 
-	/* Record the gradient table now */
-	r = fwrite( &grads_ct, sizeof( char ), 4, f );
+	r = read_paint( c, opts, 1, &( s->stroke ) );
 
-	if( r < 4 )
+	if( r )
 	{
-		return -2;
+		return r;
 	}
 
-	r = fseek( f, cur_pos, SEEK_SET );
+	s->opacity   = 1.0f;
+	s->stroke_w  = 0.0f;
+	s->dash_offs = 0.0f;
+	s->dash_ct   = 0;
+	s->join      = 0;
+	s->cap       = 0;
 
-	if( r )
+	if( opts & PV_SHAPE_TRANSLUCENT )
+	{
+		if( CUR_SHORT( c, 1 ) )
+		{
+			return -3;
+		}
+
+		s->opacity = c->b[c->i] / 255.0f;
+		c->i += 1;
+	}
+
+	if( opts & PV_SHAPE_STROKE )
+	{
+		if( CUR_SHORT( c, 2 ) )
+		{
+			return -3;
+		}
+
+		s->stroke_w = pv_f16_16to32( ld_u16( c->b + c->i ) );
+		c->i += 2;
+
+		if( opts & PV_SHAPE_DASHED )
+		{
+			unsigned dash_ct;
+
+			if( CUR_SHORT( c, 3 ) )
+			{
+				return -3;
+			}
+
+			d            = c->b + c->i;
+			s->dash_offs = pv_f16_16to32( ld_u16( d ) );
+			dash_ct      = d[2];
+			c->i += 3;
+
+			/* nanoSVG has room for no more than 8 */
+			if( dash_ct > 8 || CUR_SHORT( c, dash_ct * 2 ) )
+			{
+				return -3;
+			}
+
+			d = c->b + c->i;
+
+			for( i = 0; i < dash_ct; ++i )
+			{
+				s->dashes[i] = pv_f16_16to32( ld_u16( d + ( i * 2 ) ) );
+			}
+
+			s->dash_ct = dash_ct;
+			c->i += dash_ct * 2;
+		}
+
+		if( CUR_SHORT( c, 1 ) )
+		{
+			return -3;
+		}
+
+		s->join = c->b[c->i] & 0x3;
+		s->cap  = ( c->b[c->i] >> 2 ) & 0x3;
+		c->i += 1;
+	}
+
+	if( CUR_SHORT( c, 2 ) )
 	{
 		return -3;
 	}
 
-	for( i = 0; i < grads_ct; ++i )
+	s->miter = pv_f16_16to32( ld_u16( c->b + c->i ) );
+	c->i += 2;
+
+	return 0;
+}
+
+/* Read a shape record up to and including its path count */
+static int read_shape_hdr( struct cursor* c, struct pv_vshape* s )
+{
+	struct cursor sc;
+	const unsigned char* d;
+	unsigned i, idx;
+	size_t w;
+	int r;
+
+	if( !( c->styles ) )
+	{
+		/* The style is inline without a style table */
+		s->style = PV_NO_STYLE;
+		r        = read_style( c, s );
+	}
+	else
 	{
-		unsigned short stops_b;
+		i = style_idx_w( c->style_ct );
+
+		if( CUR_SHORT( c, i ) )
+		{
+			return -3;
+		}
 
-		r = fwrite( &( grads[i].xform ), sizeof( float ), 6, f );
+		d = c->b + c->i;
 
-		if( r < 6 )
+		switch( i )
 		{
-			return -2;
+		case 1:
+			idx = d[0];
+			break;
+		case 2:
+			idx = ld_u16( d );
+			break;
+		default:
+			idx = ld_u32( d );
+			break;
 		}
 
-		r = fwrite( &( grads[i].fx ), sizeof( float ), 1, f );
+		c->i += i;
 
-		if( r < 1 )
+		if( idx >= c->style_ct )
 		{
-			return -2;
+			return -3;
 		}
 
-		r = fwrite( &( grads[i].fy ), sizeof( float ), 1, f );
+		sc    = *c;
+		sc.b  = c->pre;
+		sc.sz = c->pre_sz;
+		sc.i  = ld_u32( c->styles + ( (size_t)( idx ) * 4 ) );
 
-		if( r < 1 )
+		if( sc.i > sc.sz )
 		{
-			return -2;
+			return -3;
 		}
 
-		stops_b = grads[i].stops_ct |
-			( grads[i].spread << 14 );
+		s->style = idx;
+		r        = c->skim ? 0 : read_style( &sc, s );
+	}
+
+	if( r )
+	{
+		return r;
+	}
+
+	if( c->coords == PV_COORDS_GRID )
+	{
+		r = read_grid_bounds( c, s->bounds );
+		r = r ? r : cur_varint( c, &( s->path_ct ) );
 
-		r = fwrite( &stops_b, sizeof( char ), 2, f );
+		if( r )
+		{
+			return r;
+		}
+	}
+	else
+	{
+		w = coord_sz( c->coords ) * 4;
+		r = cur_align( c );
 
-		if( r < 2 )
+		if( r || CUR_SHORT( c, w + 4 ) )
 		{
-			return -2;
+			return -3;
 		}
 
-		/* TODO: Record all stops into a ready-to-write buffer */
-		for(j = 0; j < grads[i].stops_ct; ++i)
+		d = c->b + c->i;
+
+		if( !( c->skim ) )
 		{
-			unsigned short offs;
+			ld_coords_n( s->bounds, d, 4, c->coords, c->little );
+		}
 
-			offs = pv_f16_32to16( grads[i].stops[j].offs );
+		s->path_ct = ld_u32( d + w );
+		c->i += w + 4;
+	}
+
+	/* Every path takes at least its header */
+	if( ( c->sz - c->i ) / path_min_sz( c ) < s->path_ct )
+	{
+		return -3;
+	}
+
+	s->paths_offs = c->i;
+	s->last_j     = 0;
+	s->last_offs  = c->i;
+
+	return 0;
+}
+
+/* Read a path record, leaving the points where they are */
+static int read_path_hdr( struct cursor* c, struct pv_vpath* p )
+{
+	unsigned elem;
+	size_t w;
+	int r;
+
+	w = coord_sz( c->coords );
+
+	if( c->coords == PV_COORDS_GRID )
+	{
+		r = cur_varint( c, &elem );
+		r = r ? r : read_grid_bounds( c, p->bounds );
+
+		if( r )
+		{
+			return r;
+		}
+
+		p->npts   = elem >> 1;
+		p->closed = elem & 1;
+	}
+	else
+	{
+		if( CUR_SHORT( c, 4 ) )
+		{
+			return -3;
+		}
+
+		elem      = ld_u32( c->b + c->i );
+		p->npts   = elem & 0x7FFFFFFF;
+		p->closed = elem >> 31;
+		c->i += 4;
+		r = cur_align( c );
+
+		if( r || CUR_SHORT( c, w * 4 ) )
+		{
+			return -3;
+		}
+
+		if( !( c->skim ) )
+		{
+			ld_coords_n( p->bounds, c->b + c->i, 4, c->coords, c->little );
+		}
+
+		c->i += w * 4;
+	}
+
+	p->pts_ct  = p->npts;
+	p->tags    = NULL;
+	p->coords  = c->coords;
+	p->quantum = 0.0f;
+	p->predict = c->predict;
+	p->little  = c->little;
+
+	if( c->seg_tags )
+	{
+		const unsigned char* t;
+		unsigned segs, lines, k;
+
+		segs = seg_ct( p->npts );
+
+		if( CUR_SHORT( c, ( segs + 7 ) / 8 ) )
+		{
+			return -3;
+		}
+
+		/* Lines only store their end point */
+		t     = c->b + c->i;
+		lines = 0;
 
-			r = fwrite( &offs, sizeof( char ), 2, f );
+		for( k = 0; k < segs; k += 8 )
+		{
+			unsigned char m;
+
+			/* Bits past the last segment do not count */
+			m = t[k >> 3] & ( segs - k < 8 ? ( 1 << ( segs - k ) ) - 1 : 0xFF );
 
-			if( r < 2 )
+			for( ; m; m &= m - 1 )
 			{
-				return -2;
+				lines++;
 			}
+		}
 
-			buf[0] = grads[i].stops[j].col >> 24;
-			buf[1] = (grads[i].stops[j].col >> 16) & 0xFF;
-			buf[2] = (grads[i].stops[j].col >> 8) & 0xFF;
-			buf[3] = grads[i].stops[j].col & 0xFF;
+		p->tags   = t;
+		p->pts_ct = p->npts - ( lines * 2 );
+		c->i += ( segs + 7 ) / 8;
+	}
+
+	if( c->coords == PV_COORDS_GRID )
+	{
+		r = cur_varint( c, &elem );
+
+		if( r )
+		{
+			return r;
+		}
+
+		/* Each point takes at least a byte for x and one for y */
+		p->pts_sz  = elem;
+		p->quantum = c->quantum;
 
-			r = fwrite( buf, sizeof(char), 4, f );
+		if( CUR_SHORT( c, p->pts_sz ) || p->pts_sz / 2 < p->pts_ct )
+		{
+			return -3;
 		}
 	}
-}
+	else
+	{
+		/* Each point is two floats */
+		r = cur_align( c );
+
+		if( r || ( c->sz - c->i ) / ( w * 2 ) < p->pts_ct )
+		{
+			return -3;
+		}
+
+		p->pts_sz = (size_t)( p->pts_ct ) * w * 2;
+	}
+
+	p->pts = c->b + c->i;
+	c->i += p->pts_sz;
+
+	return 0;
+}
+
+static int skip_paths( struct cursor* c, unsigned path_ct )
+{
+	struct pv_vpath p;
+	unsigned i;
+	int r;
+
+	for( i = 0; i < path_ct; ++i )
+	{
+		r = read_path_hdr( c, &p );
+
+		if( r )
+		{
+			return r;
+		}
+	}
+
+	return 0;
+}
+
+/* Load the points of a path as nanoSVG has them, making lines back into
+ * cubics the way nsvg__lineTo does */
+static void expand_pts( const struct pv_vpath* p, float* o )
+{
+	const unsigned char *d, *t;
+	unsigned segs, k, run;
+	size_t n;
+	float dx, dy;
+
+	d = (const unsigned char*)( p->pts );
+	t = (const unsigned char*)( p->tags );
+
+	if( !t || p->npts == 0 )
+	{
+		ld_f32_n( o, d, (size_t)( p->npts ) * 2 );
+
+		return;
+	}
+
+	segs = seg_ct( p->npts );
+
+	ld_f32_n( o, d, 2 );
+	o += 2;
+	d += 8;
+
+	for( k = 0; k < segs; k = run )
+	{
+		/* Load runs of cubics in one go */
+		for( run = k; run < segs && !( ( t[run >> 3] >> ( run & 7 ) ) & 1 );
+			++run )
+			;
+
+		if( run > k )
+		{
+			n = (size_t)( run - k ) * 6;
+			ld_f32_n( o, d, n );
+			o += n;
+			d += n * 4;
+
+			continue;
+		}
+
+		o[4] = ld_f32( d );
+		o[5] = ld_f32( d + 4 );
+		d += 8;
+
+		dx   = o[4] - o[-2];
+		dy   = o[5] - o[-1];
+		o[0] = o[-2] + dx / 3.0f;
+		o[1] = o[-1] + dy / 3.0f;
+		o[2] = o[4] - dx / 3.0f;
+		o[3] = o[5] - dy / 3.0f;
+		o += 6;
+		run = k + 1;
+	}
+
+	/* Any points short of a whole segment */
+	ld_f32_n( o, d, (size_t)( p->npts - 1 - ( segs * 3 ) ) * 2 );
+}
+
+/* Spread the stored points of a path, already loaded into the end of O, out
+ * to all of them, as expand_pts does. Lines only ever move points further
+ * along, so this works from the front */
+static void spread_pts( const struct pv_vpath* p, float* o )
+{
+	const unsigned char* t;
+	const float* s;
+	unsigned segs, k, run;
+	size_t n;
+	float x, y, dx, dy;
+
+	s = o + ( (size_t)( p->npts - p->pts_ct ) * 2 );
+	t = (const unsigned char*)( p->tags );
+
+	if( s == o || p->npts == 0 )
+	{
+		return;
+	}
+
+	segs = seg_ct( p->npts );
+
+	o[0] = s[0];
+	o[1] = s[1];
+	o += 2;
+	s += 2;
+
+	for( k = 0; k < segs; k = run )
+	{
+		for( run = k; run < segs && !( ( t[run >> 3] >> ( run & 7 ) ) & 1 );
+			++run )
+			;
+
+		if( run > k )
+		{
+			n = (size_t)( run - k ) * 6;
+			memmove( o, s, sizeof( float ) * n );
+			o += n;
+			s += n;
+
+			continue;
+		}
+
+		/* The end point may be where the control points go */
+		x = s[0];
+		y = s[1];
+		s += 2;
+
+		dx   = x - o[-2];
+		dy   = y - o[-1];
+		o[0] = o[-2] + dx / 3.0f;
+		o[1] = o[-1] + dy / 3.0f;
+		o[2] = x - dx / 3.0f;
+		o[3] = y - dy / 3.0f;
+		o[4] = x;
+		o[5] = y;
+		o += 6;
+		run = k + 1;
+	}
+
+	memmove( o, s, sizeof( float ) * ( p->npts - 1 - ( segs * 3 ) ) * 2 );
+}
+
+/* As expand_pts, for points on a grid. Returns nonzero if the points do not
+ * take up exactly the bytes they were said to */
+static int expand_grid_pts( const struct pv_vpath* p, float* o )
+{
+	struct grid_rd g;
+
+	grid_rd_init( &g, p->pts, p->pts_sz, p->quantum );
+	grid_rd_n( &g, o + ( (size_t)( p->npts - p->pts_ct ) * 2 ),
+		(size_t)( p->pts_ct ) * 2 );
+
+	if( g.bad || g.d != g.end )
+	{
+		return -3;
+	}
+
+	spread_pts( p, o );
+
+	return 0;
+}
+
+/* Load the stored coordinates of a path not on a grid */
+static void ld_stored_pts( const struct pv_vpath* p, float* o )
+{
+	const unsigned char* d;
+	size_t n;
+
+	d = (const unsigned char*)( p->pts );
+	n = (size_t)( p->pts_ct ) * 2;
+
+	if( p->predict )
+	{
+		ld_pred_n( o, d, n, p->coords );
+
+		return;
+	}
+
+	ld_coords_n( o, d, n, p->coords, p->little );
+}
+
+/* Load the points of a path whichever way they are stored, as expand_pts
+ * does. Returns nonzero if they turn out to be bad */
+static int load_pts( const struct pv_vpath* p, float* o )
+{
+	if( p->coords == PV_COORDS_GRID )
+	{
+		return expand_grid_pts( p, o );
+	}
+
+	if( p->coords == PV_COORDS_F32 && !( p->predict ) && !( p->little ) )
+	{
+		expand_pts( p, o );
+
+		return 0;
+	}
+
+	/* Convert the halves, swap the bytes or undo the steps in one batch,
+	 * then spread them out */
+	ld_stored_pts( p, o + ( (size_t)( p->npts - p->pts_ct ) * 2 ) );
+	spread_pts( p, o );
+
+	return 0;
+}
+
+/* Bytes the NSVGpath and the points of a path of N points take */
+static size_t path_sz( unsigned npts )
+{
+	return sizeof( float ) * 2 * ( npts > 0 ? npts : 1 );
+}
+
+static int read_path( struct arena* a, const struct pv_vpath* vp,
+	struct NSVGpath** out )
+{
+	struct NSVGpath* p;
+
+	/* HEAP ALLOC */
+	p = rec_alloc( a, sizeof( struct NSVGpath ) );
+
+	/* OoM check */
+	if( !p )
+	{
+		return -2;
+	}
+
+	memset( p, 0, sizeof( struct NSVGpath ) );
+
+	/* HEAP ALLOC */
+	p->pts = rec_alloc( a, path_sz( vp->npts ) );
+
+	/* OoM check */
+	if( !( p->pts ) )
+	{
+		rec_free( a, p );
+
+		return -2;
+	}
+
+	p->npts   = vp->npts;
+	p->closed = vp->closed;
+	memcpy( p->bounds, vp->bounds, sizeof( float ) * 4 );
+
+	/* Hand the path over right away so the caller can free it on error */
+	*out = p;
+
+	return load_pts( vp, p->pts );
+}
+
+/* Do bounds grown by PAD on every side overlap the rectangle CLIP? */
+static int overlaps( const float* bounds, float pad, const float* clip )
+{
+	return bounds[0] - pad <= clip[2] && bounds[2] + pad >= clip[0] &&
+		bounds[1] - pad <= clip[3] && bounds[3] + pad >= clip[1];
+}
+
+/* How far a shape's stroke can reach past its bounds: half the width, as far
+ * again as the miter limit for a spike at a mitred join, or the half-diagonal
+ * of a square cap */
+static float stroke_pad( const struct pv_vshape* s )
+{
+	float k;
+
+	if( !( s->opts & PV_SHAPE_STROKE ) )
+	{
+		return 0.0f;
+	}
+
+	k = 1.0f;
+
+	if( s->join == NSVG_JOIN_MITER && s->miter > k )
+	{
+		k = s->miter;
+	}
+
+	if( s->cap == NSVG_CAP_SQUARE && k < 1.41421356f )
+	{
+		k = 1.41421356f;
+	}
+
+	return s->stroke_w * 0.5f * k;
+}
+
+/* Read a shape record in full, or return 1 if CLIP is given and it falls
+ * outside of it; with CLIP_PATHS set, that goes for every path as well */
+static int read_shape( struct cursor* c, const float* clip, int clip_paths,
+	struct NSVGshape** out )
+{
+	struct NSVGshape* sh;
+	struct NSVGpath** tail;
+	struct pv_vshape vs;
+	struct pv_vpath vp;
+	float pad;
+	unsigned i;
+	int r;
+
+	r = read_shape_hdr( c, &vs );
+
+	if( r )
+	{
+		return r;
+	}
+
+	/* Bounds do not take the stroke into account */
+	pad = stroke_pad( &vs );
+
+	if( clip && !overlaps( vs.bounds, pad, clip ) )
+	{
+		r = skip_paths( c, vs.path_ct );
+
+		return r ? r : 1;
+	}
+
+	/* HEAP ALLOC */
+	sh = rec_alloc( c->arena, sizeof( struct NSVGshape ) );
+
+	/* OoM check */
+	if( !sh )
+	{
+		return -2;
+	}
+
+	memset( sh, 0, sizeof( struct NSVGshape ) );
+
+	/* Hand the shape over right away so the caller can free it on error */
+	*out = sh;
+
+	sh->fill.type = !( vs.opts & PV_SHAPE_FILL ) ? NSVG_PAINT_NONE :
+		( vs.opts & PV_SHAPE_FILL_GRADIENT ) ? PAINT_GRADIENT_REF :
+		NSVG_PAINT_COLOR;
+	sh->fill.color   = vs.fill;
+	sh->stroke.type  = !( vs.opts & PV_SHAPE_STROKE ) ? NSVG_PAINT_NONE :
+		( vs.opts & PV_SHAPE_STROKE_GRADIENT ) ? PAINT_GRADIENT_REF :
+		NSVG_PAINT_COLOR;
+	sh->stroke.color = vs.stroke;
+
+	sh->opacity          = vs.opacity;
+	sh->strokeWidth      = vs.stroke_w;
+	sh->strokeDashOffset = vs.dash_offs;
+	sh->strokeDashCount  = vs.dash_ct;
+	sh->strokeLineJoin   = vs.join;
+	sh->strokeLineCap    = vs.cap;
+	sh->miterLimit       = vs.miter;
+	sh->fillRule         = ( vs.opts & PV_SHAPE_EVENODD ) ? 1 : 0;
+	sh->flags = ( vs.opts & PV_SHAPE_VISIBLE ) ? NSVG_FLAGS_VISIBLE : 0;
+
+	memcpy( sh->strokeDashArray, vs.dashes, sizeof( float ) * vs.dash_ct );
+	memcpy( sh->bounds, vs.bounds, sizeof( float ) * 4 );
+
+	tail = &( sh->paths );
+
+	for( i = 0; i < vs.path_ct; ++i )
+	{
+		r = read_path_hdr( c, &vp );
+
+		if( r )
+		{
+			return r;
+		}
+
+		if( clip && clip_paths && !overlaps( vp.bounds, pad, clip ) )
+		{
+			continue;
+		}
+
+		r = read_path( c->arena, &vp, tail );
+
+		if( r )
+		{
+			return r;
+		}
+
+		tail = &( ( *tail )->next );
+	}
+
+	/* Nothing left of it */
+	if( !( sh->paths ) && vs.path_ct > 0 )
+	{
+		rec_free( c->arena, sh );
+		*out = NULL;
+
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Read a gradient record, leaving the stops where they are */
+static int read_gradient_hdr( struct cursor* c, struct pv_vgradient* g )
+{
+	const unsigned char* d;
+	unsigned short stops_b;
+	unsigned i;
+
+	if( CUR_SHORT( c, 0x22 ) )
+	{
+		return -3;
+	}
+
+	d           = c->b + c->i;
+	stops_b     = ld_u16( d + 0x20 );
+	g->stops_ct = stops_b & 0x1FFF;
+	c->i += 0x22;
+
+	if( CUR_SHORT( c, g->stops_ct * 6 ) )
+	{
+		return -3;
+	}
+
+	for( i = 0; i < 6; ++i )
+	{
+		g->xform[i] = ld_f32( d + ( i * 4 ) );
+	}
+
+	g->fx     = ld_f32( d + 0x18 );
+	g->fy     = ld_f32( d + 0x1C );
+	g->spread = stops_b >> 14;
+	g->type   = ( stops_b & ( 1 << 13 ) ) ? NSVG_PAINT_RADIAL_GRADIENT :
+		NSVG_PAINT_LINEAR_GRADIENT;
+	g->stops  = c->b + c->i;
+	c->i += g->stops_ct * 6;
+
+	return 0;
+}
+
+static int read_gradient( struct cursor* c, struct NSVGgradient** out,
+	char* typ )
+{
+	struct NSVGgradient* g;
+	struct pv_vgradient vg;
+	int r;
+
+	r = read_gradient_hdr( c, &vg );
+
+	if( r )
+	{
+		return r;
+	}
+
+	/* HEAP ALLOC */
+	g = malloc( sizeof( struct NSVGgradient ) + sizeof( struct NSVGgradientStop ) *
+		( vg.stops_ct > 0 ? vg.stops_ct - 1 : 0 ) );
+
+	/* OoM check */
+	if( !g )
+	{
+		return -2;
+	}
+
+	memcpy( g->xform, vg.xform, sizeof( float ) * 6 );
+
+	g->fx     = vg.fx;
+	g->fy     = vg.fy;
+	g->spread = vg.spread;
+	g->nstops = vg.stops_ct;
+	*typ      = vg.type;
+
+	pv_view_gradient_stops( &vg, g->stops );
+
+	*out = g;
+
+	return 0;
+}
+
+/* Gradients as decoded from the table, to be copied into each shape */
+struct grad_tbl
+{
+	struct NSVGgradient** g;
+	char* typs;
+	unsigned ct;
+	/* where the copies go, or NULL to allocate each */
+	struct arena* arena;
+};
+
+static void free_grad_tbl( struct grad_tbl* t )
+{
+	unsigned i;
+
+	if( t->g )
+	{
+		for( i = 0; i < t->ct; ++i )
+		{
+			free( t->g[i] );
+		}
+	}
+
+	free( t->g );
+	free( t->typs );
+}
+
+static int read_grad_tbl( struct cursor* c, unsigned grads_ct,
+	struct grad_tbl* t )
+{
+	unsigned i;
+	int r;
+
+	t->g    = NULL;
+	t->typs = NULL;
+	t->ct   = grads_ct;
+	t->arena = NULL;
+
+	if( grads_ct == 0 )
+	{
+		return 0;
+	}
+
+	/* HEAP ALLOC */
+	t->g    = calloc( grads_ct, sizeof( struct NSVGgradient* ) );
+	t->typs = malloc( grads_ct );
+
+	/* OoM check */
+	if( !( t->g ) || !( t->typs ) )
+	{
+		return -2;
+	}
+
+	for( i = 0; i < grads_ct; ++i )
+	{
+		r = read_gradient( c, &( t->g[i] ), &( t->typs[i] ) );
+
+		if( r )
+		{
+			return r;
+		}
+	}
+
+	return 0;
+}
+
+/* Bytes a gradient with N stops takes */
+static size_t gradient_sz( unsigned n )
+{
+	return sizeof( struct NSVGgradient ) +
+		sizeof( struct NSVGgradientStop ) * ( n > 0 ? n - 1 : 0 );
+}
+
+/* Swap a gradient reference for a copy of the gradient it refers to */
+static int resolve_gradient( struct NSVGpaint* p, const struct grad_tbl* t )
+{
+	struct NSVGgradient* g;
+	size_t sz;
+	unsigned id;
+
+	if( p->type != PAINT_GRADIENT_REF )
+	{
+		return 0;
+	}
+
+	id = p->color;
+
+	if( id >= t->ct )
+	{
+		return -3;
+	}
+
+	sz = gradient_sz( t->g[id]->nstops );
+
+	/* HEAP ALLOC */
+	g = rec_alloc( t->arena, sz );
+
+	/* OoM check */
+	if( !g )
+	{
+		return -2;
+	}
+
+	memcpy( g, t->g[id], sz );
+
+	p->type     = t->typs[id];
+	p->gradient = g;
+
+	return 0;
+}
+
+static int resolve_gradients( struct NSVGshape* sh, const struct grad_tbl* t )
+{
+	int r;
+
+	r = resolve_gradient( &( sh->fill ), t );
+
+	if( r )
+	{
+		return r;
+	}
+
+	return resolve_gradient( &( sh->stroke ), t );
+}
+
+/* Is the buffer a compressed file? */
+static int chk_zsig( const unsigned char* b, size_t s )
+{
+	return s >= HEADER_MAGIC_SZ &&
+		!memcmp( b, k_zheader_magic, HEADER_MAGIC_SZ );
+}
+
+/* Where the blocks of a compressed file come from */
+struct zreader
+{
+	pv_read_fn in;
+	void* ctx;
+	/* size of the pv file inside, and how much of it is yet to be unpacked */
+	size_t raw_sz, left;
+	/* room for the packed bytes of a block */
+	unsigned char* packed;
+};
+
+/* Unpack the next block, of N bytes, into O */
+static int zrd_block( struct zreader* z, unsigned char* o, size_t n )
+{
+	unsigned char hdr[4];
+	size_t sz;
+
+	if( z->in( z->ctx, hdr, 4 ) )
+	{
+		return -3;
+	}
+
+	sz = ld_u32( hdr );
+
+	if( sz & ZBLOCK_STORED )
+	{
+		sz &= ~ZBLOCK_STORED;
+
+		return sz != n || z->in( z->ctx, o, n ) ? -3 : 0;
+	}
+
+	/* Blocks are only ever packed when that makes them smaller */
+	if( sz >= n || z->in( z->ctx, z->packed, sz ) )
+	{
+		return -3;
+	}
+
+	return pv_lz_unpack( z->packed, sz, o, n );
+}
+
+/* The unpacked bytes of a compressed file that are still needed, which start
+ * at offset BASE of the pv file inside */
+struct window
+{
+	unsigned char* b;
+	size_t base, len, cap;
+};
+
+/* Unpack blocks until the window reaches offset END, first letting go of
+ * everything before offset START if there is more to unpack */
+static int win_fill(
+	struct window* w, struct zreader* z, size_t start, size_t end )
+{
+	unsigned char* b;
+	size_t n, cap;
+	int r;
+
+	while( w->base + w->len < end )
+	{
+		n = z->left < PV_LZ_BLOCK_SZ ? z->left : PV_LZ_BLOCK_SZ;
+
+		if( n == 0 )
+		{
+			return -3;
+		}
+
+		if( start > w->base )
+		{
+			memmove( w->b, w->b + ( start - w->base ),
+				w->len - ( start - w->base ) );
+
+			w->len -= start - w->base;
+			w->base = start;
+		}
+
+		if( w->cap - w->len < n )
+		{
+			/* Shapes spanning many blocks should not cost a copy each */
+			cap = w->cap * 2 > w->len + n ? w->cap * 2 : w->len + n;
+
+			/* HEAP ALLOC */
+			b = realloc( w->b, cap );
+
+			/* OoM check */
+			if( !b )
+			{
+				return -2;
+			}
+
+			w->b   = b;
+			w->cap = cap;
+		}
+
+		r = zrd_block( z, w->b + w->len, n );
+
+		if( r )
+		{
+			return r;
+		}
+
+		w->len += n;
+		z->left -= n;
+	}
+
+	return 0;
+}
+
+/* Decode a compressed file as decode does, starting just past its magic.
+ * Everything before the shapes is kept as the shapes refer to it, then each
+ * shape is decoded as soon as the whole of it has been unpacked, so only the
+ * blocks it spans are held at once */
+static int decode_stream( struct zreader* z, struct NSVGimage* img,
+	const float* clip, int clip_paths )
+{
+	unsigned char hdr[4];
+	unsigned char* pre;
+	struct window w;
+	struct cursor c;
+	struct pv_view v;
+	struct NSVGshape *shapes, **tail, *sh;
+	struct grad_tbl grads;
+	size_t start, end;
+	unsigned i;
+	int r;
+
+	if( z->in( z->ctx, hdr, 4 ) )
+	{
+		return -3;
+	}
+
+	z->raw_sz = ld_u32( hdr );
+	z->left   = z->raw_sz;
+
+	pre        = NULL;
+	w.b        = NULL;
+	w.base     = 0;
+	w.len      = 0;
+	w.cap      = 0;
+	shapes     = NULL;
+	tail       = &shapes;
+	grads.g    = NULL;
+	grads.typs = NULL;
+
+	/* HEAP ALLOC */
+	z->packed = malloc( PV_LZ_BLOCK_SZ );
+
+	/* OoM check */
+	if( !( z->packed ) )
+	{
+		return -2;
+	}
+
+	/* The header and the start of the tables after it, all in one block */
+	end = HEADER_V5_SZ + 4;
+	r   = win_fill( &w, z, 0, z->raw_sz < end ? z->raw_sz : end );
+	r   = r ? r : pv_view_init( w.b, z->raw_sz, &v );
+
+	if( r )
+	{
+		goto fail;
+	}
+
+	/* Without a shape offset table there is no telling where shapes end,
+	 * and all the tables had better be before the shapes */
+	if( v.ver < 1 ||
+		v.shapes_offs < v.table_offs + ( (size_t)( v.shape_ct ) * 4 ) ||
+		v.shapes_offs < v.pal_offs + ( (size_t)( v.pal_ct ) * 3 ) ||
+		v.shapes_offs < v.styles_offs + ( (size_t)( v.style_ct ) * 4 ) )
+	{
+		r = -3;
+		goto fail;
+	}
+
+	r = win_fill( &w, z, 0, v.shapes_offs );
+
+	if( r )
+	{
+		goto fail;
+	}
+
+	/* HEAP ALLOC */
+	pre = malloc( v.shapes_offs );
+
+	/* OoM check */
+	if( !pre )
+	{
+		r = -2;
+		goto fail;
+	}
+
+	memcpy( pre, w.b, v.shapes_offs );
+
+	v.b  = pre;
+	v.sz = v.shapes_offs;
+
+	cur_init( &c, &v, 0 );
+
+	start = v.shapes_offs;
+
+	for( i = 0; i < v.shape_ct; ++i )
+	{
+		end = i + 1 < v.shape_ct ?
+			ld_u32( pre + v.table_offs + ( (size_t)( i + 1 ) * 4 ) ) :
+			v.grads_offs;
+
+		/* Shapes can only be visited in order, one right after another */
+		if( ld_u32( pre + v.table_offs + ( (size_t)( i ) * 4 ) ) != start ||
+			end < start || end > z->raw_sz )
+		{
+			r = -3;
+			goto fail;
+		}
+
+		r = win_fill( &w, z, start, end );
+
+		if( r )
+		{
+			goto fail;
+		}
+
+		c.b    = w.b;
+		c.sz   = end - w.base;
+		c.i    = start - w.base;
+		c.base = w.base;
+
+		r = read_shape( &c, clip, clip_paths, tail );
+
+		if( r < 0 )
+		{
+			goto fail;
+		}
+
+		if( r == 0 )
+		{
+			tail = &( ( *tail )->next );
+		}
+
+		start = end;
+	}
+
+	if( v.grads_offs != start )
+	{
+		r = -3;
+		goto fail;
+	}
+
+	r = win_fill( &w, z, start, z->raw_sz );
+
+	if( r )
+	{
+		goto fail;
+	}
+
+	c.b    = w.b;
+	c.sz   = z->raw_sz - w.base;
+	c.i    = start - w.base;
+	c.base = w.base;
+
+	r = read_grad_tbl( &c, v.grads_ct, &grads );
+
+	if( r )
+	{
+		goto fail;
+	}
+
+	for( sh = shapes; sh != NULL; sh = sh->next )
+	{
+		r = resolve_gradients( sh, &grads );
+
+		if( r )
+		{
+			goto fail;
+		}
+	}
+
+	img->width  = v.width;
+	img->height = v.height;
+	img->shapes = shapes;
+	shapes      = NULL;
+
+fail:
+	free_grad_tbl( &grads );
+	free_shapes( shapes );
+	free( pre );
+	free( w.b );
+	free( z->packed );
+
+	return r;
+}
+
+/* A compressed file in memory, read as pv_read_fn */
+struct mem_src
+{
+	const unsigned char* b;
+	size_t sz, i;
+};
+
+static int read_mem( void* ctx, void* b, size_t n )
+{
+	struct mem_src* m;
+
+	m = (struct mem_src*)( ctx );
+
+	if( m->sz - m->i < n )
+	{
+		return 1;
+	}
+
+	memcpy( b, m->b + m->i, n );
+	m->i += n;
+
+	return 0;
+}
+
+/* Decode the file a view is open over, putting every record in arena A if
+ * given. The records are only freed on failure without one */
+static int decode_view( const struct pv_view* v, struct NSVGimage* img,
+	const float* clip, int clip_paths, struct arena* a )
+{
+	struct cursor c;
+	struct NSVGshape *shapes, **tail, *sh;
+	struct grad_tbl grads;
+	unsigned i;
+	int r;
+
+	cur_init( &c, v, v->shapes_offs );
+
+	c.arena    = a;
+	shapes     = NULL;
+	tail       = &shapes;
+	grads.g    = NULL;
+	grads.typs = NULL;
+
+	for( i = 0; i < v->shape_ct; ++i )
+	{
+		r = read_shape( &c, clip, clip_paths, tail );
+
+		if( r < 0 )
+		{
+			goto fail;
+		}
+
+		if( r == 0 )
+		{
+			tail = &( ( *tail )->next );
+		}
+	}
+
+	r           = read_grad_tbl( &c, v->grads_ct, &grads );
+	grads.arena = a;
+
+	if( r )
+	{
+		goto fail;
+	}
+
+	for( sh = shapes; sh != NULL; sh = sh->next )
+	{
+		r = resolve_gradients( sh, &grads );
+
+		if( r )
+		{
+			goto fail;
+		}
+	}
+
+	img->width  = v->width;
+	img->height = v->height;
+	img->shapes = shapes;
+	shapes      = NULL;
+
+fail:
+	free_grad_tbl( &grads );
+
+	if( !a )
+	{
+		free_shapes( shapes );
+	}
+
+	return r;
+}
+
+static int decode( void* b, size_t s, struct NSVGimage* img,
+	const float* clip, int clip_paths )
+{
+	struct pv_view v;
+	struct zreader z;
+	struct mem_src m;
+	int r;
+
+	if( !img )
+	{
+		return -1;
+	}
+
+	if( b && chk_zsig( (unsigned char*)( b ), s ) )
+	{
+		m.b   = (unsigned char*)( b );
+		m.sz  = s;
+		m.i   = HEADER_MAGIC_SZ;
+		z.in  = read_mem;
+		z.ctx = &m;
+
+		return decode_stream( &z, img, clip, clip_paths );
+	}
+
+	r = pv_view_init( b, s, &v );
+
+	return r ? r : decode_view( &v, img, clip, clip_paths, NULL );
+}
+
+int pv_pv2nsvg( void* b, size_t s, struct NSVGimage* img )
+{
+	return decode( b, s, img, NULL, 0 );
+}
+
+int pv_pv2nsvg_cb( pv_read_fn in, void* ctx, struct NSVGimage* img )
+{
+	unsigned char sig[HEADER_MAGIC_SZ];
+	struct zreader z;
+
+	if( !in || !img )
+	{
+		return -1;
+	}
+
+	if( in( ctx, sig, HEADER_MAGIC_SZ ) )
+	{
+		return -3;
+	}
+
+	/* Only compressed files say how far their shapes go up front */
+	if( !chk_zsig( sig, HEADER_MAGIC_SZ ) )
+	{
+		return -1;
+	}
+
+	z.in  = in;
+	z.ctx = ctx;
+
+	return decode_stream( &z, img, NULL, 0 );
+}
+
+int pv_pv2nsvg_cull( void* b, size_t s, struct NSVGimage* img,
+	const float* rect, int paths )
+{
+	if( !rect )
+	{
+		return -1;
+	}
+
+	return decode( b, s, img, rect, paths );
+}
+
+/* Count K more uses of each gradient a style paints with in USES, out of
+ * CT */
+static int use_gradients(
+	unsigned* uses, unsigned ct, const struct pv_vshape* s, unsigned k )
+{
+	if( ( s->opts & PV_SHAPE_FILL ) && ( s->opts & PV_SHAPE_FILL_GRADIENT ) )
+	{
+		if( s->fill >= ct )
+		{
+			return -3;
+		}
+
+		uses[s->fill] += k;
+	}
+
+	if( ( s->opts & PV_SHAPE_STROKE ) &&
+		( s->opts & PV_SHAPE_STROKE_GRADIENT ) )
+	{
+		if( s->stroke >= ct )
+		{
+			return -3;
+		}
+
+		uses[s->stroke] += k;
+	}
+
+	return 0;
+}
+
+/* Size the arena for decoding the file a view is open over, from its shape
+ * and path headers, its styles and its gradient table */
+static int arena_size( const struct pv_view* v, size_t* sz )
+{
+	struct cursor c, sc;
+	struct pv_vshape vs;
+	struct pv_vpath vp;
+	struct pv_vgradient g;
+	unsigned *uses, *style_uses;
+	unsigned i, j;
+	size_t n;
+	int r;
+
+	/* HEAP ALLOC */
+	uses       = calloc( v->grads_ct ? v->grads_ct : 1, sizeof( unsigned ) );
+	style_uses = calloc( v->style_ct ? v->style_ct : 1, sizeof( unsigned ) );
+
+	/* OoM check */
+	if( !uses || !style_uses )
+	{
+		r = -2;
+		goto fail;
+	}
+
+	cur_init( &c, v, v->shapes_offs );
+
+	c.skim = 1;
+	n      = 0;
+	r      = 0;
+
+	for( i = 0; !r && i < v->shape_ct; ++i )
+	{
+		r = read_shape_hdr( &c, &vs );
+		n += arena_rec_sz( sizeof( struct NSVGshape ) );
+
+		for( j = 0; !r && j < vs.path_ct; ++j )
+		{
+			r = read_path_hdr( &c, &vp );
+			n += arena_rec_sz( sizeof( struct NSVGpath ) ) +
+				arena_rec_sz( path_sz( vp.npts ) );
+		}
+
+		/* Indexed styles are left unread, and only counted here */
+		if( !r && v->style_ct )
+		{
+			style_uses[vs.style]++;
+		}
+		else if( !r )
+		{
+			r = use_gradients( uses, v->grads_ct, &vs, 1 );
+		}
+	}
+
+	/* Shapes get a copy of each gradient their style paints with */
+	for( i = 0; !r && i < v->style_ct; ++i )
+	{
+		if( !( style_uses[i] ) )
+		{
+			continue;
+		}
+
+		cur_init(
+			&sc, v, ld_u32( v->b + v->styles_offs + ( (size_t)( i ) * 4 ) ) );
+
+		r = sc.i > sc.sz ? -3 : read_style( &sc, &vs );
+		r = r ? r : use_gradients( uses, v->grads_ct, &vs, style_uses[i] );
+	}
+
+	/* The gradient table comes right after the last shape */
+	for( i = 0; !r && i < v->grads_ct; ++i )
+	{
+		r = read_gradient_hdr( &c, &g );
+		n += (size_t)( uses[i] ) * arena_rec_sz( gradient_sz( g.stops_ct ) );
+	}
+
+	*sz = n;
+
+fail:
+	free( uses );
+	free( style_uses );
+
+	return r;
+}
+
+/* Unpack a whole compressed file in memory into a new buffer *O of *N
+ * bytes */
+static int unpack_all(
+	const unsigned char* b, size_t s, unsigned char** o, size_t* n )
+{
+	unsigned char hdr[4];
+	unsigned char* raw;
+	struct zreader z;
+	struct mem_src m;
+	size_t i, k;
+	int r;
+
+	m.b   = b;
+	m.sz  = s;
+	m.i   = HEADER_MAGIC_SZ;
+	z.in  = read_mem;
+	z.ctx = &m;
+
+	if( z.in( z.ctx, hdr, 4 ) )
+	{
+		return -3;
+	}
+
+	z.raw_sz = ld_u32( hdr );
+	z.left   = z.raw_sz;
+
+	/* HEAP ALLOC */
+	raw      = malloc( z.raw_sz > 0 ? z.raw_sz : 1 );
+	z.packed = malloc( PV_LZ_BLOCK_SZ );
+
+	/* OoM check */
+	if( !raw || !( z.packed ) )
+	{
+		r = -2;
+		goto fail;
+	}
+
+	for( i = 0, r = 0; !r && i < z.raw_sz; i += k )
+	{
+		k = z.raw_sz - i < PV_LZ_BLOCK_SZ ? z.raw_sz - i : PV_LZ_BLOCK_SZ;
+		r = zrd_block( &z, raw + i, k );
+	}
+
+	if( !r )
+	{
+		*o  = raw;
+		*n  = z.raw_sz;
+		raw = NULL;
+	}
+
+fail:
+	free( raw );
+	free( z.packed );
+
+	return r;
+}
+
+int pv_pv2nsvg_arena( void* b, size_t s, struct NSVGimage* img )
+{
+	struct pv_view v;
+	struct arena a;
+	unsigned char* raw;
+	size_t raw_sz;
+	int r;
+
+	if( !img )
+	{
+		return -1;
+	}
+
+	raw = NULL;
+	a.b = NULL;
+	a.i = 0;
+
+	/* The arena is sized from the whole file, so unpack it first */
+	if( b && chk_zsig( (unsigned char*)( b ), s ) )
+	{
+		r = unpack_all( (unsigned char*)( b ), s, &raw, &raw_sz );
+
+		if( r )
+		{
+			return r;
+		}
+
+		b = raw;
+		s = raw_sz;
+	}
+
+	r = pv_view_init( b, s, &v );
+	r = r ? r : arena_size( &v, &( a.sz ) );
+
+	if( r )
+	{
+		goto fail;
+	}
+
+	if( a.sz > 0 )
+	{
+		/* HEAP ALLOC */
+		a.b = malloc( a.sz );
+
+		/* OoM check */
+		if( !( a.b ) )
+		{
+			r = -2;
+			goto fail;
+		}
+	}
+
+	r = decode_view( &v, img, NULL, 0, &a );
+
+	/* The first shape is the start of the arena, which is how it is freed */
+	if( !r )
+	{
+		a.b = NULL;
+	}
+
+fail:
+	free( a.b );
+	free( raw );
+
+	return r;
+}
+
+void pv_nsvg_delete( struct NSVGimage* img )
+{
+	if( !img )
+	{
+		return;
+	}
+
+	free( img->shapes );
+	free( img );
+}
+
+/* A run of shapes for one thread to decode */
+struct decode_job
+{
+	const struct pv_view* v;
+	const size_t* offs;
+	const struct grad_tbl* grads;
+	struct NSVGshape** shapes;
+	unsigned first, last;
+	int r;
+};
+
+static void* decode_range( void* arg )
+{
+	struct decode_job* job;
+	struct cursor c;
+	unsigned i;
+
+	job    = (struct decode_job*)( arg );
+	job->r = 0;
+
+	cur_init( &c, job->v, 0 );
+
+	for( i = job->first; i < job->last; ++i )
+	{
+		c.i = job->offs[i];
+
+		if( c.i > c.sz )
+		{
+			job->r = -3;
+			break;
+		}
+
+		job->r = read_shape( &c, NULL, 0, &( job->shapes[i] ) );
+
+		if( job->r )
+		{
+			break;
+		}
+
+		job->r = resolve_gradients( job->shapes[i], job->grads );
+
+		if( job->r )
+		{
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+int pv_pv2nsvg_mt( void* b, size_t s, struct NSVGimage* img, unsigned n )
+{
+	struct cursor c;
+	struct pv_view v;
+	struct pv_vshape vs;
+	struct NSVGshape** shapes;
+	struct decode_job* jobs;
+	struct grad_tbl grads;
+	size_t* offs;
+	size_t per_job, shapes_sz;
+	unsigned i, j;
+	int r;
+
+#ifdef PV_NO_THREADS
+	n = 1;
+#endif /* PV_NO_THREADS */
+
+	/* Compressed files can only be unpacked in order */
+	if( n <= 1 || ( b && chk_zsig( (unsigned char*)( b ), s ) ) )
+	{
+		return pv_pv2nsvg( b, s, img );
+	}
+
+	if( !img )
+	{
+		return -1;
+	}
+
+	r = pv_view_init( b, s, &v );
+
+	if( r )
+	{
+		return r;
+	}
+
+	cur_init( &c, &v, v.shapes_offs );
+
+	/* Every shape takes at least its header, so a bogus count stops here */
+	if( ( v.sz - v.shapes_offs ) / shape_min_sz( &c ) < v.shape_ct )
+	{
+		return -3;
+	}
+
+	grads.g    = NULL;
+	grads.typs = NULL;
+	shapes     = NULL;
+	jobs       = NULL;
+
+	/* HEAP ALLOC */
+	offs = malloc( sizeof( size_t ) * ( v.shape_ct + 1 ) );
+
+	/* OoM check */
+	if( !offs )
+	{
+		return -2;
+	}
+
+	/* Find where every shape starts, skipping over the points */
+	for( i = 0; i < v.shape_ct; ++i )
+	{
+		if( v.ver >= 1 )
+		{
+			offs[i] = ld_u32( v.b + v.table_offs + ( (size_t)( i ) * 4 ) );
+
+			continue;
+		}
+
+		offs[i] = c.i;
+		r       = read_shape_hdr( &c, &vs );
+
+		if( r )
+		{
+			goto fail;
+		}
+
+		r = skip_paths( &c, vs.path_ct );
+
+		if( r )
+		{
+			goto fail;
+		}
+	}
+
+	offs[v.shape_ct] = v.ver >= 1 ? v.grads_offs : c.i;
+
+	/* The gradients are needed up front, as every job resolves its own */
+	c.i = offs[v.shape_ct];
+	r   = read_grad_tbl( &c, v.grads_ct, &grads );
+
+	if( r )
+	{
+		goto fail;
+	}
+
+	/* HEAP ALLOC */
+	shapes = calloc( v.shape_ct + 1, sizeof( struct NSVGshape* ) );
+	jobs   = calloc( n, sizeof( struct decode_job ) );
+
+	/* OoM check */
+	if( !shapes || !jobs )
+	{
+		r = -2;
+		goto fail;
+	}
+
+	/* Split the shapes into runs of roughly equal byte size */
+	shapes_sz = offs[v.shape_ct] > v.shapes_offs ?
+		offs[v.shape_ct] - v.shapes_offs : 0;
+	per_job   = shapes_sz / n + 1;
+	j         = 0;
+
+	for( i = 0; i < n; ++i )
+	{
+		jobs[i].v      = &v;
+		jobs[i].offs   = offs;
+		jobs[i].grads  = &grads;
+		jobs[i].shapes = shapes;
+		jobs[i].first  = j;
+
+		while( j < v.shape_ct &&
+			( i == n - 1 || offs[j] < v.shapes_offs + per_job * ( i + 1 ) ) )
+		{
+			j++;
+		}
+
+		jobs[i].last = j;
+	}
+
+#ifndef PV_NO_THREADS
+	{
+		pthread_t* th;
+		char* started;
+
+		/* HEAP ALLOC */
+		th      = malloc( sizeof( pthread_t ) * n );
+		started = calloc( n, 1 );
+
+		/* OoM check */
+		if( !th || !started )
+		{
+			free( th );
+			free( started );
+			r = -2;
+			goto fail;
+		}
+
+		/* Run the first job here; any that fail to start run here too */
+		for( i = 1; i < n; ++i )
+		{
+			started[i] = !pthread_create( &( th[i] ), NULL, decode_range,
+				&( jobs[i] ) );
+		}
+
+		decode_range( &( jobs[0] ) );
+
+		for( i = 1; i < n; ++i )
+		{
+			if( started[i] )
+			{
+				pthread_join( th[i], NULL );
+			}
+			else
+			{
+				decode_range( &( jobs[i] ) );
+			}
+		}
+
+		free( th );
+		free( started );
+	}
+#else
+	for( i = 0; i < n; ++i )
+	{
+		decode_range( &( jobs[i] ) );
+	}
+#endif /* PV_NO_THREADS */
+
+	for( i = 0; i < n; ++i )
+	{
+		if( jobs[i].r )
+		{
+			r = jobs[i].r;
+			goto fail;
+		}
+	}
+
+	/* Stitch the shapes together in order */
+	for( i = 1; i < v.shape_ct; ++i )
+	{
+		shapes[i - 1]->next = shapes[i];
+	}
+
+	img->width  = v.width;
+	img->height = v.height;
+	img->shapes = shapes[0];
+
+	free( shapes );
+	shapes = NULL;
+
+fail:
+	if( shapes )
+	{
+		for( i = 0; i < v.shape_ct; ++i )
+		{
+			free_shapes( shapes[i] );
+		}
+	}
+
+	free_grad_tbl( &grads );
+	free( shapes );
+	free( jobs );
+	free( offs );
+
+	return r;
+}
+
+int pv_view_init( const void* b, size_t s, struct pv_view* v )
+{
+	const unsigned char* c;
+
+	if( !b || !v || s < HEADER_SZ )
+	{
+		return -1;
+	}
+
+	if( pv_chksig( (void*)( b ) ) )
+	{
+		return -1;
+	}
+
+	c = (const unsigned char*)( b );
+
+	v->b           = c;
+	v->sz          = s;
+	v->ver         = c[3];
+	v->width       = ld_f32( c + 0x8 );
+	v->height      = ld_f32( c + 0xC );
+	v->shape_ct    = ld_u32( c + 0x10 );
+	v->grads_ct    = ld_u16( c + 0x14 );
+	v->table_offs  = 0;
+	v->shapes_offs = HEADER_SZ;
+	v->grads_offs  = 0;
+	v->pal_ct      = 0;
+	v->pal_offs    = 0;
+	v->style_ct    = 0;
+	v->styles_offs = 0;
+	v->flags       = 0;
+	v->quantum     = 0.0f;
+
+	if( v->ver >= 1 )
+	{
+		v->table_offs = HEADER_V1_SZ;
+
+		if( v->ver >= 5 )
+		{
+			v->table_offs = HEADER_V5_SZ;
+		}
+		else if( v->ver >= 3 )
+		{
+			v->table_offs = HEADER_V3_SZ;
+		}
+		else if( v->ver >= 2 )
+		{
+			v->table_offs = HEADER_V2_SZ;
+		}
+
+		/* Make sure the whole offset table is there */
+		if( s < v->table_offs || ( s - v->table_offs ) / 4 < v->shape_ct )
+		{
+			return -3;
+		}
+
+		v->shapes_offs = v->table_offs + (size_t)( v->shape_ct ) * 4;
+		v->grads_offs  = ld_u32( c + 0x16 );
+
+		if( v->grads_offs > s )
+		{
+			return -3;
+		}
+	}
+
+	if( v->ver >= 5 )
+	{
+		v->flags = ld_u32( c + 0x20 );
+
+		if( v->flags & ~( FLAGS_COORDS | FLAGS_PREDICT | FLAGS_ALIGN |
+							 FLAGS_LITTLE ) )
+		{
+			return -3;
+		}
+
+		/* Grid points are steps already, and varints have no alignment or
+		 * byte order */
+		if( ( v->flags & ( FLAGS_PREDICT | FLAGS_ALIGN | FLAGS_LITTLE ) ) &&
+			( v->flags & FLAGS_COORDS ) == PV_COORDS_GRID )
+		{
+			return -3;
+		}
+
+		/* Steps are only ever stored big-endian */
+		if( ( v->flags & FLAGS_PREDICT ) && ( v->flags & FLAGS_LITTLE ) )
+		{
+			return -3;
+		}
+
+		switch( v->flags & FLAGS_COORDS )
+		{
+		case PV_COORDS_F32:
+			break;
+		case PV_COORDS_GRID:
+			v->quantum = ld_f32( c + 0x24 );
+
+			/* Steps must be positive and finite, and NaN is neither */
+			if( !( v->quantum > 0.0f && v->quantum - v->quantum == 0.0f ) )
+			{
+				return -3;
+			}
+
+			break;
+		case PV_COORDS_F16:
+			break;
+		default:
+			return -3;
+		}
+	}
+
+	if( v->ver >= 2 )
+	{
+		/* The palette sits between the offset table and the shapes */
+		v->pal_ct   = ld_u16( c + 0x1A );
+		v->pal_offs = v->shapes_offs;
+
+		if( ( s - v->pal_offs ) / 3 < v->pal_ct )
+		{
+			return -3;
+		}
+
+		v->shapes_offs += (size_t)( v->pal_ct ) * 3;
+	}
+
+	if( v->ver >= 3 )
+	{
+		/* Then the style offset table and style records, which the shape
+		 * offset table already steps over */
+		v->style_ct    = ld_u32( c + 0x1C );
+		v->styles_offs = v->shapes_offs;
+
+		if( ( s - v->styles_offs ) / 4 < v->style_ct )
+		{
+			return -3;
+		}
+
+		v->shapes_offs = v->shape_ct > 0 ? ld_u32( c + v->table_offs ) :
+			v->grads_offs;
+
+		if( v->shapes_offs > s )
+		{
+			return -3;
+		}
+	}
+
+	v->last_i    = 0;
+	v->last_offs = v->shapes_offs;
+
+	return 0;
+}
+
+int pv_view_shape( struct pv_view* v, unsigned i, struct pv_vshape* sh )
+{
+	struct cursor c;
+	int r;
+
+	if( !v || !sh || i >= v->shape_ct )
+	{
+		return -1;
+	}
+
+	/* Shapes can only be found going forwards */
+	if( i < v->last_i )
+	{
+		v->last_i    = 0;
+		v->last_offs = v->shapes_offs;
+	}
+
+	cur_init( &c, v, 0 );
+
+	/* Newer files say where each shape is */
+	if( v->ver >= 1 )
+	{
+		c.i = ld_u32( v->b + v->table_offs + ( (size_t)( i ) * 4 ) );
+
+		if( c.i > c.sz )
+		{
+			return -3;
+		}
+
+		return read_shape_hdr( &c, sh );
+	}
+
+	c.i = v->last_offs;
+
+	while( v->last_i < i )
+	{
+		r = read_shape_hdr( &c, sh );
+
+		if( r )
+		{
+			return r;
+		}
+
+		r = skip_paths( &c, sh->path_ct );
+
+		if( r )
+		{
+			return r;
+		}
+
+		v->last_i++;
+		v->last_offs = c.i;
+	}
+
+	return read_shape_hdr( &c, sh );
+}
+
+int pv_view_path(
+	struct pv_view* v, struct pv_vshape* sh, unsigned j, struct pv_vpath* p )
+{
+	struct cursor c;
+	int r;
+
+	if( !v || !sh || !p || j >= sh->path_ct )
+	{
+		return -1;
+	}
+
+	if( j < sh->last_j )
+	{
+		sh->last_j    = 0;
+		sh->last_offs = sh->paths_offs;
+	}
+
+	cur_init( &c, v, sh->last_offs );
+
+	while( sh->last_j < j )
+	{
+		r = read_path_hdr( &c, p );
+
+		if( r )
+		{
+			return r;
+		}
+
+		sh->last_j++;
+		sh->last_offs = c.i;
+	}
+
+	return read_path_hdr( &c, p );
+}
+
+void pv_view_path_pts( const struct pv_vpath* p, float* o )
+{
+	if( !p || !o )
+	{
+		return;
+	}
+
+	load_pts( p, o );
+}
+
+void pv_view_path_segs(
+	const struct pv_vpath* p, unsigned char* tags, float* o )
+{
+	const unsigned char* t;
+	unsigned k, segs;
+
+	if( !p || !tags || !o )
+	{
+		return;
+	}
+
+	t    = (const unsigned char*)( p->tags );
+	segs = seg_ct( p->npts );
+
+	for( k = 0; k < segs; ++k )
+	{
+		tags[k] = PV_SEG_CUBIC;
+
+		if( t && ( ( t[k >> 3] >> ( k & 7 ) ) & 1 ) )
+		{
+			tags[k] = PV_SEG_LINE;
+		}
+	}
+
+	if( p->coords == PV_COORDS_GRID )
+	{
+		struct grid_rd g;
+
+		grid_rd_init( &g, p->pts, p->pts_sz, p->quantum );
+		grid_rd_n( &g, o, (size_t)( p->pts_ct ) * 2 );
+
+		return;
+	}
+
+	ld_stored_pts( p, o );
+}
+
+const float* pv_view_path_floats( const struct pv_vpath* p )
+{
+	if( !p || p->coords != PV_COORDS_F32 || p->predict ||
+		p->little != host_le( ) ||
+		(size_t)( p->pts ) % sizeof( float ) != 0 )
+	{
+		return NULL;
+	}
+
+	return (const float*)( p->pts );
+}
+
+int pv_view_gradient( struct pv_view* v, unsigned id, struct pv_vgradient* g )
+{
+	struct cursor c;
+	unsigned i;
+	int r;
+
+	if( !v || !g || id >= v->grads_ct )
+	{
+		return -1;
+	}
+
+	cur_init( &c, v, 0 );
+
+	/* The gradient table comes after the last shape */
+	if( !v->grads_offs )
+	{
+		c.i = v->shapes_offs;
+
+		if( v->shape_ct > 0 )
+		{
+			struct pv_vshape sh;
+
+			r = pv_view_shape( v, v->shape_ct - 1, &sh );
+
+			if( r )
+			{
+				return r;
+			}
+
+			c.i = sh.paths_offs;
+			r   = skip_paths( &c, sh.path_ct );
+
+			if( r )
+			{
+				return r;
+			}
+		}
+
+		v->grads_offs = c.i;
+	}
+
+	c.i = v->grads_offs;
+
+	for( i = 0; i < id; ++i )
+	{
+		r = read_gradient_hdr( &c, g );
+
+		if( r )
+		{
+			return r;
+		}
+	}
+
+	return read_gradient_hdr( &c, g );
+}
+
+void pv_view_gradient_stops(
+	const struct pv_vgradient* g, struct NSVGgradientStop* o )
+{
+	const unsigned char* d;
+	unsigned i;
+	float offs;
+
+	if( !g || !o )
+	{
+		return;
+	}
+
+	/* Stop offsets are stored relative to the one before */
+	d    = (const unsigned char*)( g->stops );
+	offs = 0.0f;
+
+	for( i = 0; i < g->stops_ct; ++i )
+	{
+		offs += pv_f16_16to32( ld_u16( d + ( i * 6 ) ) );
+
+		o[i].offset = offs;
+		o[i].color  = ld_u32( d + ( i * 6 ) + 2 );
+	}
+}
+
+/* Open-addressed hash table over the entries of a catalog. Each slot keeps
+ * the hash of its entry, so the table can grow without looking at them */
+struct slot
+{
+	unsigned hash;
+	/* index + 1 of the entry, zero when empty */
+	size_t i;
+};
+
+struct slots
+{
+	struct slot* s;
+	/* always zero or a power of two */
+	size_t ct;
+};
+
+/* Make room for entry number N, keeping the load at or under half */
+static int slots_reserve( struct slots* t, size_t n )
+{
+	struct slot* s;
+	size_t ct, i, j, mask;
+
+	if( ( n + 1 ) * 2 <= t->ct )
+	{
+		return 0;
+	}
+
+	ct   = t->ct ? t->ct * 2 : 0x10;
+	mask = ct - 1;
+
+	/* HEAP ALLOC */
+	s = calloc( ct, sizeof( struct slot ) );
+
+	/* OoM check */
+	if( !s )
+	{
+		return -2;
+	}
+
+	for( i = 0; i < t->ct; ++i )
+	{
+		if( !( t->s[i].i ) )
+		{
+			continue;
+		}
+
+		for( j = t->s[i].hash & mask; s[j].i; j = ( j + 1 ) & mask )
+			;
+
+		s[j] = t->s[i];
+	}
+
+	free( t->s );
+
+	t->s  = s;
+	t->ct = ct;
+
+	return 0;
+}
+
+/* Grow a catalog array to hold entry number N */
+static int cat_reserve( void** a, size_t* cap, size_t n, size_t elem_sz )
+{
+	void* b;
+	size_t c;
+
+	if( n < *cap )
+	{
+		return 0;
+	}
+
+	c = *cap ? *cap * 2 : 0x10;
+
+	/* HEAP ALLOC */
+	b = realloc( *a, elem_sz * c );
+
+	/* OoM check */
+	if( !b )
+	{
+		return -2;
+	}
+
+	*a   = b;
+	*cap = c;
+
+	return 0;
+}
+
+static unsigned hash_words( unsigned h, const void* d, size_t n )
+{
+	const unsigned char* b;
+	unsigned v;
+	size_t i;
+
+	b = (const unsigned char*)( d );
+
+	for( i = 0; i < n; ++i )
+	{
+		memcpy( &v, b + ( i * 4 ), 4 );
+		h = ( h ^ v ) * 0x01000193U;
+		h ^= h >> 15;
+	}
+
+	return h;
+}
+
+/* A gradient as the encoder sees it, borrowed from nanosvg rather than
+ * copied */
+struct gradient
+{
+	const struct NSVGgradient* src;
+	int is_radial;
+};
+
+/* The distinct gradients of an image in ID order, hashed so identical
+ * gradients share one ID */
+struct grad_cat
+{
+	struct gradient* g;
+	size_t ct, cap;
+	struct slots slots;
+	/* bytes wr_gradients will write */
+	size_t sz;
+};
+
+/* Hash what gets written out. The focal point is left out for linear
+ * gradients, as nanosvg does not set it for them */
+static unsigned hash_gradient( const struct NSVGgradient* og, int is_radial )
+{
+	unsigned h;
+
+	h = 0x811C9DC5U ^ ( og->nstops | ( is_radial << 13 ) |
+		( og->spread << 14 ) );
+	h = hash_words( h, og->xform, 6 );
+
+	if( is_radial )
+	{
+		h = hash_words( h, &( og->fx ), 1 );
+		h = hash_words( h, &( og->fy ), 1 );
+	}
+
+	return hash_words( h, og->stops, (size_t)( og->nstops ) * 2 );
+}
+
+/* Bitwise equality, to agree with the hash */
+static int same_gradient(
+	const struct gradient* g, const struct NSVGgradient* og, int is_radial )
+{
+	const struct NSVGgradient* a;
+
+	a = g->src;
+
+	return a == og ||
+		( g->is_radial == is_radial && a->spread == og->spread &&
+			a->nstops == og->nstops &&
+			!memcmp( a->xform, og->xform, sizeof( float ) * 6 ) &&
+			( !is_radial || ( !memcmp( &( a->fx ), &( og->fx ), 4 ) &&
+								 !memcmp( &( a->fy ), &( og->fy ), 4 ) ) ) &&
+			!memcmp( a->stops, og->stops,
+				sizeof( struct NSVGgradientStop ) * og->nstops ) );
+}
+
+/* Find the ID of the gradient of a paint, adding it if it is new */
+static int catalog_gradient(
+	struct grad_cat* cat, const struct NSVGpaint* p, unsigned short* id )
+{
+	const struct NSVGgradient* og;
+	struct gradient* g;
+	size_t i, mask;
+	unsigned h;
+	int is_radial, r;
+
+	/* null ref check */
+	if( !cat || !p || !id )
+	{
+		return -1;
+	}
+
+	og        = p->gradient;
+	is_radial = p->type == NSVG_PAINT_RADIAL_GRADIENT ? 1 : 0;
+
+	/* Ensure valid bounds for bitfielded variables */
+	if( ( og->spread & 0x3 ) != og->spread )
+	{
+		return -3;
+	}
+
+	if( ( og->nstops & 0x1FFF ) != og->nstops )
+	{
+		return -4;
+	}
+
+	r = slots_reserve( &( cat->slots ), cat->ct );
+
+	if( r )
+	{
+		return r;
+	}
+
+	h    = hash_gradient( og, is_radial );
+	mask = cat->slots.ct - 1;
+
+	for( i = h & mask; cat->slots.s[i].i; i = ( i + 1 ) & mask )
+	{
+		g = cat->g + ( cat->slots.s[i].i - 1 );
+
+		if( cat->slots.s[i].hash == h && same_gradient( g, og, is_radial ) )
+		{
+			*id = cat->slots.s[i].i - 1;
+
+			return 0;
+		}
+	}
+
+	/* Gradient IDs are 16 bits wide */
+	if( cat->ct >= 0xFFFF )
+	{
+		return -5;
+	}
+
+	r = cat_reserve(
+		(void**)( &( cat->g ) ), &( cat->cap ), cat->ct, sizeof( struct gradient ) );
+
+	if( r )
+	{
+		return r;
+	}
+
+	g            = cat->g + cat->ct;
+	g->src       = og;
+	g->is_radial = is_radial;
+
+	*id = cat->ct;
+
+	cat->ct++;
+	cat->slots.s[i].hash = h;
+	cat->slots.s[i].i    = cat->ct;
+	cat->sz += 0x22 + ( (size_t)( og->nstops ) * 6 );
+
+	return 0;
+}
+
+static void free_catalog( struct grad_cat* cat )
+{
+	free( cat->g );
+	free( cat->slots.s );
+}
+
+/* The distinct colours of an image in index order */
+struct palette
+{
+	/* RRGGBB, as written */
+	unsigned* col;
+	size_t ct, cap;
+	struct slots slots;
+	/* colour paints written */
+	size_t uses;
+	/* more colours than can be indexed */
+	int full;
+	/* bytes per index as written, or zero to write colours inline */
+	int idx_w;
+};
+
+static unsigned paint_rgb( const struct NSVGpaint* p )
+{
+	/* 0xAABBGGRR in memory */
+	return ( ( p->color & 0xFF ) << 16 ) | ( p->color & 0xFF00 ) |
+		( ( p->color >> 16 ) & 0xFF );
+}
+
+static unsigned hash_colour( unsigned rgb )
+{
+	rgb *= 0x9E3779B1U;
+
+	return rgb ^ ( rgb >> 16 );
+}
+
+/* Find the slot a colour is in, or the empty one it would go in */
+static size_t palette_slot( const struct palette* pal, unsigned rgb )
+{
+	size_t i, mask;
+
+	mask = pal->slots.ct - 1;
+
+	for( i = hash_colour( rgb ) & mask; pal->slots.s[i].i;
+		i = ( i + 1 ) & mask )
+	{
+		if( pal->col[pal->slots.s[i].i - 1] == rgb )
+		{
+			break;
+		}
+	}
+
+	return i;
+}
+
+/* Add a colour written out N times */
+static int catalog_colour(
+	struct palette* pal, const struct NSVGpaint* p, size_t n )
+{
+	unsigned rgb;
+	size_t i;
+	int r;
+
+	if( p->type != NSVG_PAINT_COLOR )
+	{
+		return 0;
+	}
+
+	pal->uses += n;
+
+	if( pal->full )
+	{
+		return 0;
+	}
+
+	r = slots_reserve( &( pal->slots ), pal->ct );
+
+	if( r )
+	{
+		return r;
+	}
+
+	rgb = paint_rgb( p );
+	i   = palette_slot( pal, rgb );
+
+	if( pal->slots.s[i].i )
+	{
+		return 0;
+	}
+
+	/* Palette indices are 16 bits wide */
+	if( pal->ct >= 0xFFFF )
+	{
+		pal->full = 1;
+
+		return 0;
+	}
+
+	r = cat_reserve(
+		(void**)( &( pal->col ) ), &( pal->cap ), pal->ct, sizeof( unsigned ) );
+
+	if( r )
+	{
+		return r;
+	}
+
+	pal->col[pal->ct] = rgb;
+	pal->ct++;
+	pal->slots.s[i].hash = hash_colour( rgb );
+	pal->slots.s[i].i    = pal->ct;
+
+	return 0;
+}
+
+/* Use the palette only where it comes out smaller than inline colours */
+static void choose_palette( struct palette* pal )
+{
+	int idx_w;
+
+	pal->idx_w = 0;
+
+	if( pal->full || pal->ct == 0 )
+	{
+		return;
+	}
+
+	idx_w = pal->ct <= 0x100 ? 1 : 2;
+
+	if( pal->ct * 3 + pal->uses * idx_w < pal->uses * 3 )
+	{
+		pal->idx_w = idx_w;
+	}
+}
+
+static void free_palette( struct palette* pal )
+{
+	free( pal->col );
+	free( pal->slots.s );
+}
+
+/* Longest a style record can be: sentinel, two inline colours, opacity,
+ * stroke width, eight dashes with their offset and count, join and cap, and
+ * miter limit */
+#define STYLE_MAX_SZ 0x20
+
+/* A style record as written with inline colours, which is what styles are
+ * told apart by */
+struct style
+{
+	/* the first shape with this style */
+	struct NSVGshape* sh;
+	unsigned char key[STYLE_MAX_SZ];
+	size_t key_sz;
+	/* shapes with this style */
+	size_t uses;
+};
+
+/* The distinct styles of an image in index order */
+struct style_cat
+{
+	struct style* s;
+	size_t ct, cap;
+	struct slots slots;
+	/* style index of every shape, in order */
+	unsigned* of_shape;
+	size_t shape_ct;
+	/* bytes per index as written, or zero to write styles inline */
+	int idx_w;
+};
+
+static void free_styles( struct style_cat* cat )
+{
+	free( cat->s );
+	free( cat->slots.s );
+	free( cat->of_shape );
+}
+
+/* Everything catalogued from an image before it is written */
+struct tables
+{
+	struct grad_cat grads;
+	struct palette pal;
+	struct style_cat styles;
+	/* the options being encoded with */
+	struct pv_opts opts;
+	/* are bounds and points written little-endian? */
+	int little;
+	/* where the file starts in the output, which alignment is counted
+	 * from */
+	size_t start;
+};
+
+static void free_tables( struct tables* t )
+{
+	free_catalog( &( t->grads ) );
+	free_palette( &( t->pal ) );
+	free_styles( &( t->styles ) );
+}
+
+/* Build the field sentinel for a shape */
+static unsigned char shape_opts( struct NSVGshape* shape )
+{
+	unsigned char opts;
+
+	opts = 0;
+
+	/* set the fill type */
+	switch( shape->fill.type )
+	{
+	case NSVG_PAINT_LINEAR_GRADIENT:
+	case NSVG_PAINT_RADIAL_GRADIENT:
+		opts |= 1 << 4;
+		/* goto case; */
+	case NSVG_PAINT_COLOR:
+		opts |= 1;
+		/* goto case; */
+	case NSVG_PAINT_NONE:
+		break;
+	}
+
+	/* set the stroke type */
+	switch( shape->stroke.type )
+	{
+	case NSVG_PAINT_LINEAR_GRADIENT:
+	case NSVG_PAINT_RADIAL_GRADIENT:
+		opts |= 1 << 5;
+		/* goto case; */
+	case NSVG_PAINT_COLOR:
+		opts |= 1 << 1;
+		/* goto case; */
+	case NSVG_PAINT_NONE:
+		break;
+	}
+
+	/* is not fully opaque? */
+	opts |= shape->opacity < 1.0f ? 1 << 3 : 0;
+
+	/* stroke has dashes? */
+	opts |= shape->strokeDashCount > 0 ? 1 << 2 : 0;
+
+	/* record fill rule and visibility */
+	opts |= ( shape->fillRule & 1 ) << 6;
+	opts |= ( shape->flags & NSVG_FLAGS_VISIBLE ) ? 1 << 7 : 0;
+
+	return opts;
+}
+
+/* Size of the staging buffer the writer fills before each flush */
+#define WRITER_BLOCK_SZ 0x10000
+
+/* How far a control point may sit from where a straight line would put it,
+ * relative to the size of the coordinates, for the segment to be stored as a
+ * line. Build with zero to only take lines that come back out bit-exact */
+#ifndef PV_LINE_TOL
+#define PV_LINE_TOL 1.0e-5f
+#endif /* PV_LINE_TOL */
+
+#define ABS( X ) ( ( X ) < 0.0f ? -( X ) : ( X ) )
+
+/* Is the cubic at S, as p0 c1 c2 p1, a straight line nsvg__lineTo could have
+ * made? With Q nonzero, the end points go on a grid of that step, which moves
+ * the control points by up to half of it, so the tolerance is kept to the
+ * other half */
+static int is_line( const float* s, float q )
+{
+	float dx, dy, m, tol;
+
+	dx = s[6] - s[0];
+	dy = s[7] - s[1];
+
+	m = ABS( s[0] );
+	m = ABS( s[1] ) > m ? ABS( s[1] ) : m;
+	m = ABS( s[6] ) > m ? ABS( s[6] ) : m;
+	m = ABS( s[7] ) > m ? ABS( s[7] ) : m;
+
+	tol = PV_LINE_TOL * ( 1.0f + m );
+	tol = q && tol > q * 0.5f ? q * 0.5f : tol;
+
+	return ABS( s[2] - ( s[0] + dx / 3.0f ) ) <= tol &&
+		ABS( s[3] - ( s[1] + dy / 3.0f ) ) <= tol &&
+		ABS( s[4] - ( s[6] - dx / 3.0f ) ) <= tol &&
+		ABS( s[5] - ( s[7] - dy / 3.0f ) ) <= tol;
+}
+
+/* Number of lines among the segments of a path, as with is_line */
+static unsigned count_lines( const struct NSVGpath* p, float q )
+{
+	unsigned k, segs, lines;
+
+	segs  = seg_ct( p->npts < 0 ? 0 : p->npts );
+	lines = 0;
+
+	for( k = 0; k < segs; ++k )
+	{
+		lines += is_line( p->pts + ( k * 6 ), q );
+	}
+
+	return lines;
+}
+
+/* Buffered, forward-only output, either to a write callback or into a fixed
+ * buffer that is the final destination */
+struct writer
+{
+	unsigned char* b;
+	size_t i, cap;
+	/* bytes flushed out so far */
+	size_t pos;
+	int fixed;
+	pv_write_fn out;
+	void* ctx;
+};
+
+static int wr_flush( struct writer* w )
+{
+	if( w->fixed )
+	{
+		return 0;
+	}
+
+	if( w->i > 0 && w->out( w->ctx, w->b, w->i ) )
+	{
+		return -2;
+	}
+
+	w->pos += w->i;
+	w->i = 0;
+
+	return 0;
+}
+
+/* Make room for N more bytes in the staging buffer */
+static int wr_space( struct writer* w, size_t n )
+{
+	unsigned char* b;
+	int r;
+
+	if( w->cap - w->i >= n )
+	{
+		return 0;
+	}
+
+	/* A fixed buffer cannot be flushed to make room */
+	if( w->fixed )
+	{
+		return -4;
+	}
+
+	r = wr_flush( w );
+
+	if( r || w->cap >= n )
+	{
+		return r;
+	}
+
+	/* HEAP ALLOC */
+	b = realloc( w->b, n );
+
+	/* OoM check */
+	if( !b )
+	{
+		return -2;
+	}
+
+	w->b   = b;
+	w->cap = n;
+
+	return 0;
+}
+
+static size_t wr_tell( const struct writer* w ) { return w->pos + w->i; }
+
+static int wr_bytes( struct writer* w, const void* d, size_t n )
+{
+	int r;
+
+	r = wr_space( w, n );
+
+	if( r )
+	{
+		return r;
+	}
+
+	memcpy( w->b + w->i, d, n );
+	w->i += n;
+
+	return 0;
+}
+
+static int wr_u8( struct writer* w, unsigned char v )
+{
+	return wr_bytes( w, &v, 1 );
+}
+
+static int wr_u16( struct writer* w, unsigned short v )
+{
+	int r;
+
+	r = wr_space( w, 2 );
+
+	if( r )
+	{
+		return r;
+	}
+
+	st_u16( w->b + w->i, v );
+	w->i += 2;
+
+	return 0;
+}
+
+static int wr_u32( struct writer* w, unsigned v )
+{
+	int r;
+
+	r = wr_space( w, 4 );
+
+	if( r )
+	{
+		return r;
+	}
+
+	st_u32( w->b + w->i, v );
+	w->i += 4;
+
+	return 0;
+}
+
+/* Write N floats, each copied out by COPY */
+static int wr_floats( struct writer* w, const float* v, size_t n,
+	void ( *copy )( void*, const void*, size_t ) )
+{
+	size_t k;
+	int r;
+
+	/* Go a block at a time so big arrays never grow the buffer */
+	while( n > 0 )
+	{
+		k = n < WRITER_BLOCK_SZ / 4 ? n : WRITER_BLOCK_SZ / 4;
+		r = wr_space( w, k * 4 );
+
+		if( r )
+		{
+			return r;
+		}
+
+		copy( w->b + w->i, v, k );
+		w->i += k * 4;
+		v += k;
+		n -= k;
+	}
+
+	return 0;
+}
+
+static int wr_f32_n( struct writer* w, const float* v, size_t n )
+{
+	return wr_floats( w, v, n, pv_bswap32_n );
+}
+
+/* Largest float16, which coordinates stored as float16 may not go past */
+#define F16_MAX 65504.0f
+
+/* Convert up to 0x100 values to float16, rounding to the nearest with DIR
+ * zero, down with DIR negative and up with DIR positive. Values must be
+ * within F16_MAX */
+static void to_f16_n(
+	unsigned short* h, const float* v, size_t n, int dir )
+{
+	unsigned short a[0x100];
+	float lo[0x100], hi[0x100];
+	size_t i;
+	int out;
+
+	/* The conversion truncates towards zero, so the half wanted is either
+	 * the one it gives or the next one further out */
+	pv_f16_32to16_n( h, v, n );
+
+	for( i = 0; i < n; ++i )
+	{
+		a[i] = h[i] + 1;
+	}
+
+	pv_f16_16to32_n( lo, h, n );
+	pv_f16_16to32_n( hi, a, n );
+
+	for( i = 0; i < n; ++i )
+	{
+		if( dir == 0 )
+		{
+			out = ABS( hi[i] - v[i] ) < ABS( v[i] - lo[i] );
+		}
+		else
+		{
+			out = dir < 0 ? v[i] < 0.0f : v[i] > 0.0f;
+		}
+
+		if( lo[i] != v[i] && out )
+		{
+			h[i] = a[i];
+		}
+	}
+}
+
+/* Write N values as float16, rounded as to_f16_n does, little-endian if LE
+ * is nonzero */
+static int wr_f16_n(
+	struct writer* w, const float* v, size_t n, int dir, int le )
+{
+	unsigned short h[0x100];
+	size_t k;
+	int r;
+
+	while( n > 0 )
+	{
+		k = n < 0x100 ? n : 0x100;
+		r = wr_space( w, k * 2 );
+
+		if( r )
+		{
+			return r;
+		}
+
+		to_f16_n( h, v, k, dir );
+
+		if( le )
+		{
+			pv_le16_n( w->b + w->i, h, k );
+		}
+		else
+		{
+			pv_bswap16_n( w->b + w->i, h, k );
+		}
+
+		w->i += k * 2;
+		v += k;
+		n -= k;
+	}
+
+	return 0;
+}
+
+/* Write bounds as floats, rounded outwards if they lose precision */
+static int wr_bounds(
+	struct writer* w, const float* b, const struct tables* t )
+{
+	int r;
+
+	if( t->opts.coords == PV_COORDS_F16 )
+	{
+		r = wr_f16_n( w, b, 2, -1, t->little );
+
+		return r ? r : wr_f16_n( w, b + 2, 2, 1, t->little );
+	}
+
+	return t->little ? wr_floats( w, b, 4, pv_le32_n ) : wr_f32_n( w, b, 4 );
+}
+
+/* Write N coordinates of points as floats */
+static int wr_pts_n(
+	struct writer* w, const float* v, size_t n, const struct tables* t )
+{
+	if( t->opts.coords == PV_COORDS_F16 )
+	{
+		return wr_f16_n( w, v, n, 0, t->little );
+	}
+
+	return t->little ? wr_floats( w, v, n, pv_le32_n ) : wr_f32_n( w, v, n );
+}
+
+/* Pad out to where bounds or points start, if aligning them */
+static int wr_align( struct writer* w, const struct tables* t )
+{
+	size_t n;
+	int r;
+
+	if( !( t->opts.align ) )
+	{
+		return 0;
+	}
+
+	n = pad_sz( wr_tell( w ) - t->start );
+	r = wr_space( w, n );
+
+	if( r )
+	{
+		return r;
+	}
+
+	memset( w->b + w->i, 0, n );
+	w->i += n;
+
+	return 0;
+}
+
+/* The grid step coordinates are written on, or zero for float32 */
+static float grid_step( const struct tables* t )
+{
+	return t->opts.coords == PV_COORDS_GRID ? t->opts.quantum : 0.0f;
+}
+
+/* Grid coordinates stay within this many steps of the origin, so the step
+ * between any two of them fits in an int */
+#define GRID_MAX 0x3FFFFFFE
+
+/* Put X on a grid of step Q, rounding to the nearest step with DIR zero,
+ * down with DIR negative and up with DIR positive */
+static int to_grid( float x, float q, int dir, int* o )
+{
+	double v;
+	int i;
+
+	v = (double)( x ) / q;
+
+	/* The comparisons are false for NaN */
+	if( !( v > -GRID_MAX && v < GRID_MAX ) )
+	{
+		return -6;
+	}
+
+	if( dir == 0 )
+	{
+		v += v < 0.0 ? -0.5 : 0.5;
+	}
+
+	/* Casting truncates towards zero */
+	i = (int)( v );
+
+	if( dir < 0 && i > v )
+	{
+		i--;
+	}
+	else if( dir > 0 && i < v )
+	{
+		i++;
+	}
+
+	*o = i;
+
+	return 0;
+}
+
+/* Map signed numbers to unsigned ones, small either way round */
+static unsigned zigzag( int i )
+{
+	return i < 0 ? ( (unsigned)( -( i + 1 ) ) << 1 ) | 1 : (unsigned)( i ) << 1;
+}
+
+/* Put U as a varint at O + *N, or only count its bytes with O NULL */
+static void put_varint( unsigned char* o, size_t* n, unsigned u )
+{
+	for( ; u >= 0x80; u >>= 7 )
+	{
+		if( o )
+		{
+			o[*n] = ( u & 0x7F ) | 0x80;
+		}
+
+		( *n )++;
+	}
+
+	if( o )
+	{
+		o[*n] = u;
+	}
+
+	( *n )++;
+}
+
+/* Put bounds on a grid of step Q, rounded outwards, as with put_varint.
+ * Returns -6 if they do not fit */
+static int put_grid_bounds(
+	unsigned char* o, size_t* n, const float* b, float q )
+{
+	int g[4];
+	int r;
+
+	r = to_grid( b[0], q, -1, g );
+	r = r ? r : to_grid( b[1], q, -1, g + 1 );
+	r = r ? r : to_grid( b[2], q, 1, g + 2 );
+	r = r ? r : to_grid( b[3], q, 1, g + 3 );
+
+	if( r )
+	{
+		return r;
+	}
+
+	put_varint( o, n, zigzag( g[0] ) );
+	put_varint( o, n, zigzag( g[1] ) );
+	put_varint( o, n, (unsigned)( g[2] ) - (unsigned)( g[0] ) );
+	put_varint( o, n, (unsigned)( g[3] ) - (unsigned)( g[1] ) );
+
+	return 0;
+}
+
+/* Write a point as the step to it on a grid of step Q from PREV, or only
+ * count its bytes with W NULL, adding them to *N */
+static int wr_grid_pt(
+	struct writer* w, const float* pt, float q, int* prev, size_t* n )
+{
+	unsigned char b[10];
+	size_t k;
+	int x, y, r;
+
+	r = to_grid( pt[0], q, 0, &x );
+	r = r ? r : to_grid( pt[1], q, 0, &y );
+
+	if( r )
+	{
+		return r;
+	}
+
+	k = 0;
+	put_varint( w ? b : NULL, &k, zigzag( x - prev[0] ) );
+	put_varint( w ? b : NULL, &k, zigzag( y - prev[1] ) );
+
+	prev[0] = x;
+	prev[1] = y;
+	*n += k;
+
+	return w ? wr_bytes( w, b, k ) : 0;
+}
+
+/* Write the points of a path that are stored on a grid of step Q, or only
+ * count their bytes with W NULL, adding them to *N. Lines only store their
+ * end point, as with float32 */
+static int wr_grid_pts(
+	struct writer* w, const struct NSVGpath* p, float q, size_t* n )
+{
+	const float* s;
+	unsigned npts, segs, k;
+	int prev[2], r;
+
+	npts    = p->npts < 0 ? 0 : p->npts;
+	segs    = seg_ct( npts );
+	prev[0] = 0;
+	prev[1] = 0;
+
+	if( npts == 0 )
+	{
+		return 0;
+	}
+
+	r = wr_grid_pt( w, p->pts, q, prev, n );
+
+	for( k = 0; !r && k < segs; ++k )
+	{
+		s = p->pts + ( k * 6 );
+
+		if( !is_line( s, q ) )
+		{
+			r = wr_grid_pt( w, s + 2, q, prev, n );
+			r = r ? r : wr_grid_pt( w, s + 4, q, prev, n );
+		}
+
+		r = r ? r : wr_grid_pt( w, s + 6, q, prev, n );
+	}
+
+	/* Any points short of a whole segment */
+	for( k = ( segs * 3 ) + 1; !r && k < npts; ++k )
+	{
+		r = wr_grid_pt( w, p->pts + ( k * 2 ), q, prev, n );
+	}
+
+	return r;
+}
+
+/* Can X be stored as options O say, once rounded as with to_grid? */
+static int check_coord( float x, const struct pv_opts* o, int dir )
+{
+	int g;
+
+	if( o->coords == PV_COORDS_GRID )
+	{
+		return to_grid( x, o->quantum, dir, &g );
+	}
+
+	/* The comparisons are false for NaN */
+	return x >= -F16_MAX && x <= F16_MAX ? 0 : -6;
+}
+
+/* Make sure every coordinate of an image can be stored as options O say */
+static int check_coords( struct NSVGimage* svg, const struct pv_opts* o )
+{
+	struct NSVGshape* sh;
+	struct NSVGpath* p;
+	int i, r;
+
+	r = 0;
+
+	for( sh = svg->shapes; !r && sh != NULL; sh = sh->next )
+	{
+		for( i = 0; !r && i < 4; ++i )
+		{
+			r = check_coord( sh->bounds[i], o, i < 2 ? -1 : 1 );
+		}
+
+		for( p = sh->paths; !r && p != NULL; p = p->next )
+		{
+			for( i = 0; !r && i < 4; ++i )
+			{
+				r = check_coord( p->bounds[i], o, i < 2 ? -1 : 1 );
+			}
+
+			for( i = 0; !r && i < p->npts * 2; ++i )
+			{
+				r = check_coord( p->pts[i], o, 0 );
+			}
+		}
+	}
+
+	return r;
+}
+
+static int wr_paint( struct writer* w, struct NSVGshape* sh, int is_fill,
+	unsigned char opts, struct tables* t )
+{
+	const struct NSVGpaint* p;
+	unsigned char rgb[3];
+	unsigned short id;
+	unsigned col;
+	size_t i;
+	int n, r;
+
+	n = is_fill ? 0 : 1;
+
+	if( !( opts & ( 1 << n ) ) )
+	{
+		return 0;
+	}
+
+	p = is_fill ? &( sh->fill ) : &( sh->stroke );
+
+	if( opts & ( 1 << ( 4 + n ) ) )
+	{
+		/* Already in the catalog, so this only looks it up */
+		r = catalog_gradient( &( t->grads ), p, &id );
+
+		/* id is only set on success */
+		if( r )
+		{
+			return -10 + r;
+		}
+
+		return wr_u16( w, id );
+	}
+
+	col = paint_rgb( p );
+
+	if( t->pal.idx_w )
+	{
+		i = t->pal.slots.s[palette_slot( &( t->pal ), col )].i - 1;
+
+		return t->pal.idx_w == 1 ? wr_u8( w, i ) : wr_u16( w, i );
+	}
+
+	rgb[0] = col >> 16;
+	rgb[1] = ( col >> 8 ) & 0xFF;
+	rgb[2] = col & 0xFF;
+
+	return wr_bytes( w, rgb, 3 );
+}
+
+/* Write a style record, from the sentinel up to the miter limit */
+static int wr_style( struct writer* w, struct NSVGshape* sh, struct tables* t )
+{
+	unsigned char opts;
+	unsigned i;
+	int r;
+
+	opts = shape_opts( sh );
+	r    = wr_u8( w, opts );
+
+	/* fill comes first */
+	r = r ? r : wr_paint( w, sh, 1, opts, t );
+	r = r ? r : wr_paint( w, sh, 0, opts, t );
+
+	if( r )
+	{
+		return r;
+	}
+
+	if( opts & PV_SHAPE_TRANSLUCENT )
+	{
+		/* Record opacity as 8-bit fixed point */
+		r = wr_u8( w, sh->opacity * ( ( 1 << 8 ) - 1 ) );
+	}
+
+	if( !r && ( opts & PV_SHAPE_STROKE ) )
+	{
+		/* Record stroke properties */
+		r = wr_u16( w, pv_f16_32to16( sh->strokeWidth ) );
+
+		if( !r && ( opts & PV_SHAPE_DASHED ) )
+		{
+			/* Record dash characteristics */
+			r = wr_u16( w, pv_f16_32to16( sh->strokeDashOffset ) );
+			r = r ? r : wr_u8( w, sh->strokeDashCount );
+
+			for( i = 0; !r && i < (unsigned)( sh->strokeDashCount ); ++i )
+			{
+				r = wr_u16( w, pv_f16_32to16( sh->strokeDashArray[i] ) );
+			}
+		}
+
+		/* Record line join and cap styling */
+		r = r ? r : wr_u8( w, ( sh->strokeLineJoin & 0x3 ) |
+			( ( sh->strokeLineCap & 0x3 ) << 2 ) );
+	}
+
+	/* Record the miter limit */
+	return r ? r : wr_u16( w, pv_f16_32to16( sh->miterLimit ) );
+}
+
+/* Write the points of a path as steps (see PREDICTED POINTS in pv.h). The
+ * stored coordinates are gathered first, as byte planes need all of them */
+static int wr_pred_pts(
+	struct writer* w, const struct NSVGpath* p, const struct tables* t )
+{
+	unsigned short h[0x100];
+	float f[0x100];
+	unsigned* u;
+	unsigned npts, segs, k, run;
+	size_t n, i, j, m, cw, b;
+	int r;
+
+	npts = p->npts < 0 ? 0 : p->npts;
+	segs = seg_ct( npts );
+	cw   = coord_sz( t->opts.coords );
+
+	/* HEAP ALLOC */
+	u = malloc( sizeof( unsigned ) * 2 * ( npts > 0 ? npts : 1 ) );
+
+	/* OoM check */
+	if( !u )
+	{
+		return -2;
+	}
+
+	/* Take the float bits as they are stored, with lines as just their end
+	 * point */
+	n   = 0;
+	run = 0;
+
+	for( k = 0; k < segs; ++k )
+	{
+		if( is_line( p->pts + ( k * 6 ), 0.0f ) )
+		{
+			m = ( (size_t)( k - run ) * 6 ) + 2;
+			memcpy( u + n, p->pts + ( run * 6 ), sizeof( float ) * m );
+			n += m;
+			run = k + 1;
+		}
+	}
+
+	m = (size_t)( npts - ( run * 3 ) ) * 2;
+	memcpy( u + n, p->pts + ( run * 6 ), sizeof( float ) * m );
+	n += m;
+
+	for( i = 0; cw == 2 && i < n; i += m )
+	{
+		m = n - i < 0x100 ? n - i : 0x100;
+
+		memcpy( f, u + i, sizeof( float ) * m );
+		to_f16_n( h, f, m, 0 );
+
+		for( j = 0; j < m; ++j )
+		{
+			u[i + j] = h[j];
+		}
+	}
+
+	/* Every coordinate but the first pair is the step from the one two
+	 * before, so x and y each step along their own axis */
+	for( i = n; i > 2; --i )
+	{
+		u[i - 1] -= u[i - 3];
+	}
+
+	r = 0;
+
+	/* Byte planes go most significant first, a block at a time */
+	for( b = 0; !r && n >= PLANES_MIN && b < cw; ++b )
+	{
+		for( i = 0; !r && i < n; i += m )
+		{
+			m = n - i < WRITER_BLOCK_SZ ? n - i : WRITER_BLOCK_SZ;
+			r = wr_space( w, m );
+
+			for( j = 0; !r && j < m; ++j )
+			{
+				w->b[w->i + j] = ( u[i + j] >> ( ( cw - 1 - b ) * 8 ) ) & 0xFF;
+			}
+
+			w->i += r ? 0 : m;
+		}
+	}
+
+	for( i = 0; !r && n < PLANES_MIN && i < n; ++i )
+	{
+		r = cw == 4 ? wr_u32( w, u[i] ) : wr_u16( w, u[i] & 0xFFFF );
+	}
+
+	free( u );
+
+	return r;
+}
+
+static int wr_path(
+	struct writer* w, const struct NSVGpath* p, const struct tables* t )
+{
+	unsigned char tag, hdr[0x19];
+	unsigned elem_ct, npts, segs, k, run;
+	size_t n, pts_sz;
+	float q;
+	int r;
+
+	npts = p->npts < 0 ? 0 : p->npts;
+	segs = seg_ct( npts );
+	q    = grid_step( t );
+
+	if( q )
+	{
+		/* The closed bit goes at the bottom, to keep the varint short */
+		n = 0;
+		put_varint(
+			hdr, &n, ( ( npts & 0x7FFFFFFF ) << 1 ) | ( p->closed ? 1U : 0 ) );
+		r = put_grid_bounds( hdr, &n, p->bounds, q );
+		r = r ? r : wr_bytes( w, hdr, n );
+	}
+	else
+	{
+		elem_ct = npts & 0x7FFFFFFF;
+		elem_ct |= ( p->closed ? 1U : 0 ) << 31;
+
+		r = wr_u32( w, elem_ct );
+		r = r ? r : wr_align( w, t );
+		r = r ? r : wr_bounds( w, p->bounds, t );
+	}
+
+	/* Tag the lines, eight segments to a byte */
+	for( k = 0; !r && k < segs; k += 8 )
+	{
+		unsigned j;
+
+		tag = 0;
+
+		for( j = 0; j < 8 && k + j < segs; ++j )
+		{
+			tag |= is_line( p->pts + ( ( k + j ) * 6 ), q ) << j;
+		}
+
+		r = wr_u8( w, tag );
+	}
+
+	if( !r && q )
+	{
+		/* Size the points up front, so readers can skip them */
+		pts_sz = 0;
+		r      = wr_grid_pts( NULL, p, q, &pts_sz );
+
+		n = 0;
+		put_varint( hdr, &n, pts_sz );
+
+		r = r ? r : wr_bytes( w, hdr, n );
+
+		return r ? r : wr_grid_pts( w, p, q, &n );
+	}
+
+	r = r ? r : wr_align( w, t );
+
+	if( r || npts == 0 )
+	{
+		return r;
+	}
+
+	if( t->opts.predict )
+	{
+		return wr_pred_pts( w, p, t );
+	}
+
+	/* Write the beziér, with runs of cubics in one go and lines as just
+	 * their end point */
+	run = 0;
+
+	for( k = 0; !r && k < segs; ++k )
+	{
+		if( !is_line( p->pts + ( k * 6 ), 0.0f ) )
+		{
+			continue;
+		}
+
+		r = wr_pts_n( w, p->pts + ( run * 6 ), ( ( k - run ) * 6 ) + 2, t );
+		run = k + 1;
+	}
+
+	return r ? r : wr_pts_n( w, p->pts + ( run * 6 ),
+		(size_t)( npts - ( run * 3 ) ) * 2, t );
+}
+
+static int wr_shape( struct writer* w, struct NSVGshape* sh,
+	struct tables* t, unsigned style )
+{
+	struct NSVGpath* p;
+	unsigned char hdr[0x19];
+	unsigned path_ct;
+	size_t n;
+	float q;
+	int r;
+
+	switch( t->styles.idx_w )
+	{
+	case 0:
+		r = wr_style( w, sh, t );
+		break;
+	case 1:
+		r = wr_u8( w, style );
+		break;
+	case 2:
+		r = wr_u16( w, style );
+		break;
+	default:
+		r = wr_u32( w, style );
+		break;
+	}
+
+	if( r )
+	{
+		return r;
+	}
+
+	/* Count the paths first, so nothing needs patching afterwards */
+	path_ct = 0;
+
+	for( p = sh->paths; p != NULL; p = p->next )
+	{
+		path_ct++;
+	}
+
+	/* Record the shape bounds and path count */
+	q = grid_step( t );
+
+	if( q )
+	{
+		n = 0;
+		r = put_grid_bounds( hdr, &n, sh->bounds, q );
+		put_varint( hdr, &n, path_ct );
+
+		r = r ? r : wr_bytes( w, hdr, n );
+	}
+	else
+	{
+		r = wr_align( w, t );
+		r = r ? r : wr_bounds( w, sh->bounds, t );
+		r = r ? r : wr_u32( w, path_ct );
+	}
+
+	/* Record all paths */
+	for( p = sh->paths; !r && p != NULL; p = p->next )
+	{
+		r = wr_path( w, p, t );
+	}
+
+	return r;
+}
+
+/* Find the index of the style of a shape, adding it if it is new. Gradients
+ * and colours are catalogued along with each new style */
+static int catalog_style(
+	struct tables* t, struct NSVGshape* sh, unsigned* style )
+{
+	struct style_cat* cat;
+	struct writer kw;
+	unsigned char key[STYLE_MAX_SZ];
+	size_t i, mask;
+	unsigned h;
+	int r;
+
+	cat = &( t->styles );
+
+	/* The palette is not settled yet, so colours go in inline */
+	memset( key, 0, STYLE_MAX_SZ );
+
+	kw.b     = key;
+	kw.i     = 0;
+	kw.cap   = STYLE_MAX_SZ;
+	kw.pos   = 0;
+	kw.fixed = 1;
+
+	r = wr_style( &kw, sh, t );
+	r = r ? r : slots_reserve( &( cat->slots ), cat->ct );
+
+	if( r )
+	{
+		return r;
+	}
+
+	h    = hash_words( 0x811C9DC5U ^ kw.i, key, STYLE_MAX_SZ / 4 );
+	mask = cat->slots.ct - 1;
+
+	for( i = h & mask; cat->slots.s[i].i; i = ( i + 1 ) & mask )
+	{
+		const struct style* s;
+
+		s = cat->s + ( cat->slots.s[i].i - 1 );
+
+		if( cat->slots.s[i].hash == h && s->key_sz == kw.i &&
+			!memcmp( s->key, key, kw.i ) )
+		{
+			*style = cat->slots.s[i].i - 1;
+			cat->s[*style].uses++;
+
+			return 0;
+		}
+	}
+
+	r = cat_reserve(
+		(void**)( &( cat->s ) ), &( cat->cap ), cat->ct, sizeof( struct style ) );
+
+	if( r )
+	{
+		return r;
+	}
+
+	cat->s[cat->ct].sh     = sh;
+	cat->s[cat->ct].key_sz = kw.i;
+	cat->s[cat->ct].uses   = 1;
+	memcpy( cat->s[cat->ct].key, key, STYLE_MAX_SZ );
+
+	*style = cat->ct;
+
+	cat->ct++;
+	cat->slots.s[i].hash = h;
+	cat->slots.s[i].i    = cat->ct;
+
+	return 0;
+}
+
+/* Use the style table only where it comes out smaller than inline styles,
+ * going by their size with inline colours */
+static void choose_styles( struct style_cat* cat )
+{
+	size_t tbl_sz, inl_sz, i;
+
+	cat->idx_w = style_idx_w( cat->ct );
+	tbl_sz     = cat->shape_ct * cat->idx_w;
+	inl_sz     = 0;
+
+	for( i = 0; i < cat->ct; ++i )
+	{
+		tbl_sz += 4 + cat->s[i].key_sz;
+		inl_sz += cat->s[i].key_sz * cat->s[i].uses;
+	}
+
+	if( inl_sz <= tbl_sz )
+	{
+		cat->idx_w = 0;
+	}
+}
+
+static unsigned count_shapes( struct NSVGimage* svg )
+{
+	struct NSVGshape* sh;
+	unsigned shape_ct;
+
+	shape_ct = 0;
+
+	for( sh = svg->shapes; sh != NULL; sh = sh->next )
+	{
+		shape_ct++;
+	}
+
+	return shape_ct;
+}
+
+/* Catalog every style, gradient and colour of an image up front, so the
+ * header can say how many there are before any shape is written */
+static int build_tables(
+	struct NSVGimage* svg, const struct pv_opts* opts, struct tables* t )
+{
+	struct NSVGshape* sh;
+	size_t n;
+	int r;
+
+	memset( t, 0, sizeof( struct tables ) );
+
+	if( opts )
+	{
+		t->opts = *opts;
+	}
+
+	/* Grid points are steps already, and varints have no alignment or byte
+	 * order; steps are always big-endian */
+	if( ( t->opts.predict || t->opts.align || t->opts.native ) &&
+		t->opts.coords == PV_COORDS_GRID )
+	{
+		return -1;
+	}
+
+	if( t->opts.predict && t->opts.native )
+	{
+		return -1;
+	}
+
+	/* Big-endian hosts store them in host order already */
+	t->little = t->opts.native && host_le( );
+
+	switch( t->opts.coords )
+	{
+	case PV_COORDS_F32:
+		break;
+	case PV_COORDS_GRID:
+		/* Steps must be positive and finite, and NaN is neither */
+		if( !( t->opts.quantum > 0.0f &&
+				t->opts.quantum - t->opts.quantum == 0.0f ) )
+		{
+			return -1;
+		}
+
+		r = check_coords( svg, &( t->opts ) );
+
+		if( r )
+		{
+			return r;
+		}
+
+		break;
+	case PV_COORDS_F16:
+		r = check_coords( svg, &( t->opts ) );
+
+		if( r )
+		{
+			return r;
+		}
+
+		break;
+	default:
+		return -1;
+	}
+
+	t->styles.shape_ct = count_shapes( svg );
+
+	/* HEAP ALLOC */
+	t->styles.of_shape = malloc(
+		sizeof( unsigned ) * ( t->styles.shape_ct ? t->styles.shape_ct : 1 ) );
+
+	/* OoM check */
+	if( !( t->styles.of_shape ) )
+	{
+		return -2;
+	}
+
+	for( sh = svg->shapes, n = 0; sh != NULL; sh = sh->next, ++n )
+	{
+		r = catalog_style( t, sh, &( t->styles.of_shape[n] ) );
+
+		if( r )
+		{
+			free_tables( t );
+
+			return r;
+		}
+	}
+
+	choose_styles( &( t->styles ) );
+
+	/* Colours are written once per style record, or once per shape if the
+	 * styles are inline */
+	for( n = 0; n < t->styles.ct; ++n )
+	{
+		const struct style* s;
+		size_t uses;
+
+		s    = t->styles.s + n;
+		uses = t->styles.idx_w ? 1 : s->uses;
+		r    = catalog_colour( &( t->pal ), &( s->sh->fill ), uses );
+		r    = r ? r : catalog_colour( &( t->pal ), &( s->sh->stroke ), uses );
+
+		if( r )
+		{
+			free_tables( t );
+
+			return r;
+		}
+	}
+
+	choose_palette( &( t->pal ) );
+
+	return 0;
+}
+
+static int wr_gradients( struct writer* w, const struct grad_cat* cat )
+{
+	static const float k_no_focus[2] = {0.0f, 0.0f};
+	const struct NSVGgradient* og;
+	unsigned char stop[6];
+	size_t i, j;
+	int r;
+
+	r = 0;
+
+	for( i = 0; !r && i < cat->ct; ++i )
+	{
+		float prev_offs;
+
+		og = cat->g[i].src;
+		r  = wr_f32_n( w, og->xform, 6 );
+		r  = r ? r
+			  : wr_f32_n( w, cat->g[i].is_radial ? &( og->fx ) : k_no_focus, 1 );
+		r = r ? r
+			  : wr_f32_n( w, cat->g[i].is_radial ? &( og->fy ) : k_no_focus, 1 );
+		r = r ? r : wr_u16( w, og->nstops | ( cat->g[i].is_radial << 13 ) |
+			( og->spread << 14 ) );
+
+		prev_offs = 0.0f;
+
+		for( j = 0; !r && j < (size_t)( og->nstops ); ++j )
+		{
+			unsigned short offs;
+
+			/* Step from what the reader will have, so error does not pile up */
+			offs = pv_f16_32to16( og->stops[j].offset - prev_offs );
+
+			st_u16( stop, offs );
+			st_u32( stop + 2, og->stops[j].color );
+
+			r = wr_bytes( w, stop, 6 );
+
+			prev_offs += pv_f16_16to32( offs );
+		}
+	}
+
+	return r;
+}
+
+static size_t paint_size( int is_fill, unsigned char opts, int idx_w )
+{
+	int n;
+
+	n = is_fill ? 0 : 1;
+
+	if( !( opts & ( 1 << n ) ) )
+	{
+		return 0;
+	}
+
+	if( opts & ( 1 << ( 4 + n ) ) )
+	{
+		return 2;
+	}
+
+	return idx_w ? idx_w : 3;
+}
+
+/* Number of bytes wr_style will write for the style of a shape */
+static size_t style_size( struct NSVGshape* sh, int idx_w )
+{
+	unsigned char opts;
+	size_t sz;
+
+	opts = shape_opts( sh );
+
+	/* sentinel, paints and miter limit */
+	sz = 1 + paint_size( 1, opts, idx_w ) + paint_size( 0, opts, idx_w ) + 2;
+
+	if( opts & PV_SHAPE_TRANSLUCENT )
+	{
+		sz += 1;
+	}
+
+	if( opts & PV_SHAPE_STROKE )
+	{
+		/* width, join and cap */
+		sz += 3;
+
+		if( opts & PV_SHAPE_DASHED )
+		{
+			sz += 3 + ( (size_t)( sh->strokeDashCount ) * 2 );
+		}
+	}
+
+	return sz;
+}
+
+/* Bytes of padding wr_align will write at file offset I */
+static size_t align_size( size_t i, const struct tables* t )
+{
+	return t->opts.align ? pad_sz( i ) : 0;
+}
+
+/* Move file offset *OFFS past the bytes wr_shape will write for a shape
+ * starting there */
+static int shape_size(
+	struct NSVGshape* sh, const struct tables* t, size_t* offs )
+{
+	struct NSVGpath* p;
+	unsigned path_ct;
+	size_t sz, n, pts_sz, w;
+	float q;
+	int r;
+
+	/* style index or inline style, counted on from *OFFS to get the
+	 * padding right */
+	sz = *offs;
+	sz += t->styles.idx_w ? (size_t)( t->styles.idx_w ) :
+		style_size( sh, t->pal.idx_w );
+	q = grid_step( t );
+
+	w = coord_sz( t->opts.coords );
+
+	if( !q )
+	{
+		/* bounds and path count */
+		sz += align_size( sz, t );
+		sz += ( w * 4 ) + 4;
+	}
+
+	path_ct = 0;
+
+	for( p = sh->paths; p != NULL; p = p->next )
+	{
+		unsigned npts;
+
+		npts = p->npts < 0 ? 0 : p->npts;
+		path_ct++;
+
+		if( q )
+		{
+			/* count, bounds, size of the points and the points */
+			pts_sz = 0;
+			r      = wr_grid_pts( NULL, p, q, &pts_sz );
+
+			n = pts_sz;
+			put_varint( NULL, &n, ( ( npts & 0x7FFFFFFF ) << 1 ) |
+				( p->closed ? 1U : 0 ) );
+			r = r ? r : put_grid_bounds( NULL, &n, p->bounds, q );
+			put_varint( NULL, &n, pts_sz );
+
+			if( r )
+			{
+				return r;
+			}
+
+			sz += n + ( ( seg_ct( npts ) + 7 ) / 8 );
+
+			continue;
+		}
+
+		/* count, bounds and line tags, then the points less the control
+		 * points of lines */
+		sz += 4;
+		sz += align_size( sz, t ) + ( w * 4 ) + ( ( seg_ct( npts ) + 7 ) / 8 );
+		sz += align_size( sz, t ) +
+			( ( npts - ( (size_t)( count_lines( p, 0.0f ) ) * 2 ) ) * w * 2 );
+	}
+
+	if( q )
+	{
+		n = 0;
+		r = put_grid_bounds( NULL, &n, sh->bounds, q );
+		put_varint( NULL, &n, path_ct );
+		sz += n;
+
+		if( r )
+		{
+			return r;
+		}
+	}
+
+	*offs = sz;
+
+	return 0;
+}
+
+/* Size of the header, shape offset table and palette */
+static size_t prelude_size( const struct tables* t )
+{
+	return HEADER_V5_SZ + ( t->styles.shape_ct * 4 ) +
+		( t->pal.idx_w ? t->pal.ct * 3 : 0 );
+}
+
+/* Size of the style offset table and style records */
+static size_t styles_size( const struct tables* t )
+{
+	size_t sz, i;
+
+	if( !( t->styles.idx_w ) )
+	{
+		return 0;
+	}
+
+	sz = t->styles.ct * 4;
+
+	for( i = 0; i < t->styles.ct; ++i )
+	{
+		sz += style_size( t->styles.s[i].sh, t->pal.idx_w );
+	}
+
+	return sz;
+}
+
+static int encoded_size(
+	struct NSVGimage* svg, const struct pv_opts* opts, size_t* s )
+{
+	struct tables t;
+	struct NSVGshape* sh;
+	size_t sz;
+	int r;
+
+	r = build_tables( svg, opts, &t );
+
+	if( r )
+	{
+		return r;
+	}
+
+	sz = prelude_size( &t ) + styles_size( &t );
+
+	for( sh = svg->shapes; !r && sh != NULL; sh = sh->next )
+	{
+		r = shape_size( sh, &t, &sz );
+	}
+
+	sz += t.grads.sz;
+
+	free_tables( &t );
+
+	if( !r )
+	{
+		*s = sz;
+	}
+
+	return r;
+}
+
+/* Write a whole file front to back. Everything the header and offset tables
+ * need is worked out from the sizes of the records beforehand, so nothing is
+ * ever patched afterwards */
+static int encode(
+	struct NSVGimage* svg, const struct pv_opts* opts, struct writer* w )
+{
+	unsigned char hdr[HEADER_V5_SZ];
+	unsigned char rgb[3];
+	size_t grads_offs, offs, start, i;
+	size_t* shape_offs;
+	struct tables t;
+	struct NSVGshape* sh;
+	int r;
+
+	r = build_tables( svg, opts, &t );
+
+	if( r )
+	{
+		return r;
+	}
+
+	/* HEAP ALLOC */
+	shape_offs = malloc(
+		sizeof( size_t ) * ( t.styles.shape_ct ? t.styles.shape_ct : 1 ) );
+
+	/* OoM check */
+	if( !shape_offs )
+	{
+		free_tables( &t );
+
+		return -2;
+	}
+
+	/* Where each shape goes, kept for the offset table */
+	offs = prelude_size( &t ) + styles_size( &t );
+
+	for( sh = svg->shapes, i = 0; !r && sh != NULL; sh = sh->next, ++i )
+	{
+		shape_offs[i] = offs;
+		r             = shape_size( sh, &t, &offs );
+	}
+
+	if( r )
+	{
+		free( shape_offs );
+		free_tables( &t );
+
+		return r;
+	}
+
+	grads_offs = offs;
+	start      = wr_tell( w );
+	t.start    = start;
+
+	memcpy( hdr, k_header_magic, HEADER_MAGIC_SZ );
+	st_f32( hdr + 0x8, svg->width );
+	st_f32( hdr + 0xC, svg->height );
+	st_u32( hdr + 0x10, t.styles.shape_ct );
+	st_u16( hdr + 0x14, t.grads.ct );
+	st_u32( hdr + 0x16, grads_offs );
+	st_u16( hdr + 0x1A, t.pal.idx_w ? t.pal.ct : 0 );
+	st_u32( hdr + 0x1C, t.styles.idx_w ? t.styles.ct : 0 );
+	st_u32( hdr + 0x20,
+		t.opts.coords | ( t.opts.predict ? FLAGS_PREDICT : 0 ) |
+			( t.opts.align ? FLAGS_ALIGN : 0 ) |
+			( t.little ? FLAGS_LITTLE : 0 ) );
+	st_f32( hdr + 0x24, grid_step( &t ) );
+
+	r = wr_bytes( w, hdr, HEADER_V5_SZ );
+
+	for( i = 0; !r && i < t.styles.shape_ct; ++i )
+	{
+		r = wr_u32( w, shape_offs[i] );
+	}
+
+	for( i = 0; !r && t.pal.idx_w && i < t.pal.ct; ++i )
+	{
+		rgb[0] = t.pal.col[i] >> 16;
+		rgb[1] = ( t.pal.col[i] >> 8 ) & 0xFF;
+		rgb[2] = t.pal.col[i] & 0xFF;
+
+		r = wr_bytes( w, rgb, 3 );
+	}
+
+	offs = prelude_size( &t ) + ( t.styles.ct * 4 );
+
+	for( i = 0; !r && t.styles.idx_w && i < t.styles.ct; ++i )
+	{
+		r = wr_u32( w, offs );
+		offs += style_size( t.styles.s[i].sh, t.pal.idx_w );
+	}
+
+	for( i = 0; !r && t.styles.idx_w && i < t.styles.ct; ++i )
+	{
+		r = wr_style( w, t.styles.s[i].sh, &t );
+	}
+
+	for( sh = svg->shapes, i = 0; !r && sh != NULL; sh = sh->next, ++i )
+	{
+		r = wr_shape( w, sh, &t, t.styles.of_shape[i] );
+	}
+
+	/* The sizes worked out above had better have been right */
+	if( !r && wr_tell( w ) - start != grads_offs )
+	{
+		r = -5;
+	}
+
+	r = r ? r : wr_gradients( w, &( t.grads ) );
+
+	free( shape_offs );
+	free_tables( &t );
+
+	return r;
+}
+
+/* Gathers what is written to it into blocks, and packs them out */
+struct zsink
+{
+	struct writer* out;
+	unsigned char* raw;
+	unsigned char* packed;
+	size_t n;
+	/* what went wrong writing out, as the callback can only say that it did */
+	int err;
+};
+
+static int zs_flush( struct zsink* z )
+{
+	size_t sz;
+	int r;
+
+	if( z->n == 0 )
+	{
+		return 0;
+	}
+
+	/* Blocks that do not come out smaller are stored as they are */
+	sz = z->n - 1;
+	r  = pv_lz_pack( z->raw, z->n, z->packed, &sz );
+
+	if( r == -4 )
+	{
+		r = wr_u32( z->out, (unsigned)( z->n ) | ZBLOCK_STORED );
+		r = r ? r : wr_bytes( z->out, z->raw, z->n );
+	}
+	else if( !r )
+	{
+		r = wr_u32( z->out, (unsigned)( sz ) );
+		r = r ? r : wr_bytes( z->out, z->packed, sz );
+	}
+
+	z->n = 0;
+
+	return r;
+}
+
+/* Take encoded bytes in, as pv_write_fn */
+static int zs_write( void* ctx, const void* b, size_t n )
+{
+	const unsigned char* d;
+	struct zsink* z;
+	size_t k;
+
+	z = (struct zsink*)( ctx );
+	d = (const unsigned char*)( b );
+
+	while( n > 0 )
+	{
+		k = PV_LZ_BLOCK_SZ - z->n;
+		k = n < k ? n : k;
+
+		memcpy( z->raw + z->n, d, k );
+		z->n += k;
+		d += k;
+		n -= k;
+
+		if( z->n == PV_LZ_BLOCK_SZ )
+		{
+			z->err = zs_flush( z );
+
+			if( z->err )
+			{
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* Write a whole file as encode does, as a compressed file */
+static int encode_packed(
+	struct NSVGimage* svg, const struct pv_opts* opts, struct writer* out )
+{
+	unsigned char hdr[ZHEADER_SZ];
+	struct writer w;
+	struct zsink z;
+	size_t raw_sz;
+	int r;
+
+	/* The size of the file inside goes up front */
+	r = encoded_size( svg, opts, &raw_sz );
+
+	if( r )
+	{
+		return r;
+	}
+
+	memcpy( hdr, k_zheader_magic, HEADER_MAGIC_SZ );
+	st_u32( hdr + HEADER_MAGIC_SZ, raw_sz );
+
+	r = wr_bytes( out, hdr, ZHEADER_SZ );
+
+	if( r )
+	{
+		return r;
+	}
+
+	z.out = out;
+	z.n   = 0;
+	z.err = 0;
+
+	w.i     = 0;
+	w.cap   = WRITER_BLOCK_SZ;
+	w.pos   = 0;
+	w.fixed = 0;
+	w.out   = zs_write;
+	w.ctx   = &z;
+
+	/* HEAP ALLOC */
+	z.raw    = malloc( PV_LZ_BLOCK_SZ );
+	z.packed = malloc( PV_LZ_BLOCK_SZ );
+	w.b      = malloc( WRITER_BLOCK_SZ );
+
+	/* OoM check */
+	if( !( z.raw ) || !( z.packed ) || !( w.b ) )
+	{
+		r = -2;
+	}
+
+	r = r ? r : encode( svg, opts, &w );
+	r = r ? r : wr_flush( &w );
+	r = z.err ? z.err : r;
+	r = r ? r : zs_flush( &z );
+
+	free( z.raw );
+	free( z.packed );
+	free( w.b );
+
+	return r;
+}
+
+/* Count bytes written, as pv_write_fn */
+static int count_bytes( void* ctx, const void* b, size_t n )
+{
+	(void)( b );
+
+	*(size_t*)( ctx ) += n;
+
+	return 0;
+}
+
+int pv_nsvg2pv( struct NSVGimage* svg, void* b, size_t* s )
+{
+	return pv_nsvg2pv_opts( svg, NULL, b, s );
+}
+
+int pv_nsvg2pv_opts( struct NSVGimage* svg, const struct pv_opts* opts,
+	void* b, size_t* s )
+{
+	struct writer w;
+	size_t n;
+	int r;
+
+	if( !svg || !s )
+	{
+		return -1;
+	}
+
+	/* Just say how big it would be, which for a compressed file means
+	 * packing it */
+	if( !b && opts && opts->compress )
+	{
+		n = 0;
+		r = pv_nsvg2pv_cb_opts( svg, opts, count_bytes, &n );
+		*s = r ? *s : n;
+
+		return r;
+	}
+
+	if( !b )
+	{
+		return encoded_size( svg, opts, s );
+	}
+
+	w.b     = (unsigned char*)( b );
+	w.i     = 0;
+	w.cap   = *s;
+	w.pos   = 0;
+	w.fixed = 1;
+
+	r = opts && opts->compress ? encode_packed( svg, opts, &w ) :
+		encode( svg, opts, &w );
+
+	if( r )
+	{
+		return r;
+	}
+
+	*s = w.i;
+
+	return 0;
+}
+
+int pv_nsvg2pv_cb( struct NSVGimage* svg, pv_write_fn out, void* ctx )
+{
+	return pv_nsvg2pv_cb_opts( svg, NULL, out, ctx );
+}
+
+int pv_nsvg2pv_cb_opts( struct NSVGimage* svg, const struct pv_opts* opts,
+	pv_write_fn out, void* ctx )
+{
+	struct writer w;
+	int r;
+
+	if( !svg || !out )
+	{
+		return -1;
+	}
+
+	w.i     = 0;
+	w.cap   = WRITER_BLOCK_SZ;
+	w.pos   = 0;
+	w.fixed = 0;
+	w.out   = out;
+	w.ctx   = ctx;
+
+	/* HEAP ALLOC */
+	w.b = malloc( WRITER_BLOCK_SZ );
+
+	/* OoM check */
+	if( !( w.b ) )
+	{
+		return -2;
+	}
+
+	r = opts && opts->compress ? encode_packed( svg, opts, &w ) :
+		encode( svg, opts, &w );
+	r = r ? r : wr_flush( &w );
+
+	free( w.b );
+
+	return r;
+}
+
+#ifndef PV_NO_STDIO
+
+static int write_file( void* f, const void* b, size_t n )
+{
+	return fwrite( b, sizeof( char ), n, (FILE*)( f ) ) < n;
+}
+
+int pv_fnsvg2pv( struct NSVGimage* svg, FILE* f )
+{
+	if( !f )
+	{
+		return -1;
+	}
+
+	return pv_nsvg2pv_cb( svg, write_file, f );
+}
+
+int pv_fnsvg2pv_opts(
+	struct NSVGimage* svg, const struct pv_opts* opts, FILE* f )
+{
+	if( !f )
+	{
+		return -1;
+	}
+
+	return pv_nsvg2pv_cb_opts( svg, opts, write_file, f );
+}
+
+#endif /* PV_NO_STDIO */
@@ -37,7 +37,7 @@
  * -----+------+-------------
  * 0x00 | 0x01 | const 0x8A (high bit set a la PNG)
  * 0x01 | 0x02 | const ASCII("PV")
- * 0x03 | 0x01 | const 0x00 (version code)
+ * 0x03 | 0x01 | const 0x05 (version code)
  * 0x04 | 0x02 | const ASCII("\r\n")
  * 0x06 | 0x01 | const ASCII(EOF)
  * 0x07 | 0x01 | const ASCII("\n")
@@ -45,9 +45,41 @@
  * 0x0C | 0x04 | float32 (canvas height)
  * 0x10 | 0x04 | number of shapes (uint32)
  * 0x14 | 0x02 | number of gradients (uint16)
- * 0x16 | .... | (shapes)
+ * 0x16 | 0x04 | offset of the gradient table (uint32)
+ * 0x1A | 0x02 | number of palette colours (uint16)
+ * 0x1C | 0x04 | number of styles (uint32)
+ * 0x20 | 0x04 | flags (uint32, see below)
+ * 0x24 | 0x04 | float32 (grid step) [if coordinates are on a grid]
+ * 0x28 | .... | offset of each shape (uint32[number of shapes])
+ * .... | .... | palette (RRGGBB[number of palette colours])
+ * .... | .... | offset of each style (uint32[number of styles])
+ * .... | .... | (styles)
+ * .... | .... | (shapes)
  * .... | .... | (gradients)
  *
+ * offsets are counted from the start of the file (its first signature
+ * byte), so readers can seek straight to any shape or to the gradient table.
+ *
+ * when the palette is not empty, every colour in the shapes is instead an
+ * index into it: one byte wide with up to 256 colours, two bytes otherwise.
+ * writers leave it empty when inline colours come out smaller.
+ *
+ * bits 0-1 of the flags say how the coordinates of shapes and paths are
+ * stored: as float32 with 0, on a grid with 1 (see GRID COORDINATES below),
+ * or as float16 with 2 (see HALF COORDINATES below). bit 2 says the points
+ * of paths not on a grid are stored as steps (see PREDICTED POINTS below).
+ * bit 3 says bounds and points are aligned, and bit 4 that they are
+ * little-endian (see ALIGNED FILES below); neither goes with a grid. the
+ * grid step is zero unless on a grid, and all other bits are clear.
+ *
+ * readers still accept older versions. version 0x03 and 0x04 files have
+ * neither flags nor grid step, so their offset table starts at 0x20, and
+ * their coordinates are always float32. version 0x02 files have no style
+ * table, so each shape has its style record inline in place of the style
+ * index, and their offset table starts at 0x1C. version 0x01 files have no
+ * palette either, and their offset table starts at 0x1A. version 0x00 files
+ * have no offsets at all, and their shapes start right at 0x16.
+ *
  * -----
  *
  * SHAPE FORMAT. an image is composed of a collection of shapes, encoded as
@@ -56,10 +88,29 @@
  *
  * Offs | Size | Description
  * -----+------+-------------
+ * 0x00 | .... | style index (uint8, uint16 or uint32)
+ * .... | 0x10 | float32[4], tight bounding box of shape
+ * .... | 0x04 | path count (uint32)
+ * .... | .... | (paths)
+ *
+ * the style index is one byte wide with up to 256 styles, two with up to
+ * 65536, and four otherwise. shapes with identical styles share one record.
+ * when there are no styles, each shape has its style record inline in place
+ * of the index; writers do that when the table would come out larger.
+ *
+ * the bounding box field is a tuple containing (min_x, min_y, max_x, max_y),
+ * which specifies the boundaries of the shape to be rendered.
+ *
+ * -----
+ *
+ * STYLE FORMAT. each style record follows this format:
+ *
+ * Offs | Size | Description
+ * -----+------+-------------
  * 0x00 | 0x01 | field sentinel (see below)
- * .... | 0x03 | fill colour (RRGGBB) [if bit0 set & bit4 clear]
+ * .... | .... | fill colour (RRGGBB or palette ID) [if bit0 set & bit4 clear]
  * .... | 0x02 | fill gradient ID [if bit0 set & bit4 set]
- * .... | 0x03 | stroke colour (RRGGBB) [if bit1 set & bit5 clear]
+ * .... | .... | stroke colour (ditto) [if bit1 set & bit5 clear]
  * .... | 0x02 | stroke gradient ID [if bit1 set & bit5 set]
  * .... | 0x01 | opacity (0-255) [if bit3 set] [100% if clear]
  * .... | 0x02 | float16: stroke width [if bit1 set]
@@ -68,16 +119,10 @@
  * .... | .... | stroke dash array (float16[length]) [if bit1 & bit2 set]
  * .... | 0x01 | stroke join type (bits 0-1), cap type (bits 2-3) [if bit1 set]
  * .... | 0x02 | float16: miter limit
- * .... | 0x10 | float32[4], tight bounding box of shape
- * .... | 0x04 | path count (uint32)
- * .... | .... | (paths)
- *
- * the bounding box field is a tuple containing (min_x, min_y, max_x, max_y),
- * which specifies the boundaries of the shape to be rendered.
  *
  * -----
  *
- * FIELD SENTINEL. each shape field has a 1-byte (8-bit) bitfield at offset 0
+ * FIELD SENTINEL. each style record has a 1-byte (8-bit) bitfield at offset 0
  * of its structure, the bits of which dictate which fields are present:
  *
  * Bit | Description
@@ -89,7 +134,7 @@
  *  4  | fill content is gradient
  *  5  | stroke content is gradient
  *  6  | (from `enum NSVGfillRule`) fill rule, 1 == even-odd, 0 == non-zero
- *  7  | unused, must be zero
+ *  7  | (from `enum NSVGflags`) shape is visible
  *
  * if a bit is one, the field is present, and it is encoded in the structural
  * order set above. if the bit is zero, the field is absent, and it is skipped
@@ -105,7 +150,8 @@
  * -----+------+-------------
  * 0x00 | 0x04 | Number of elements / 2 (bits 0-30), is closed (bit 31)
  * 0x04 | 0x10 | float32[4], tight bounding box of path
- * 0x14 | .... | Array of cubic bezier elements, either xy coord or a curve;
+ * 0x14 | .... | segment tags (bit per segment, LSB first), 1 == line
+ * .... | .... | Array of cubic bezier elements, either xy coord or a curve;
  *      |      | first element is a coord (all float32)
  *      |      | coord is 2 numbers, curve is 4
  *
@@ -116,6 +162,82 @@
  * one bit in the array size is taken to note whether the path is closed or
  * not, encoding the size as half of its real value.
  *
+ * every three points after the first make a segment, and the tags take one
+ * byte for every eight of them, rounded up. segments tagged as lines leave
+ * out their curve quad: readers put the control points back a third and two
+ * thirds of the way along, as nanoSVG does for lines, so the number of
+ * elements is always counted with them in. files from before version 0x04
+ * have no tags, and store every segment as a curve.
+ *
+ * -----
+ *
+ * GRID COORDINATES. when the flags say so, every coordinate of the shapes and
+ * paths is a whole number of grid steps, stored as a varint: seven bits to a
+ * byte, least significant first, with the high bit set on every byte but the
+ * last, and no more than five bytes. signed numbers are zig-zag mapped first
+ * (0, -1, 1, -2, ... become 0, 1, 2, 3, ...). shapes then follow this format:
+ *
+ * Offs | Size | Description
+ * -----+------+-------------
+ * 0x00 | .... | style index, or style record, as above
+ * .... | .... | grid bounds (see below)
+ * .... | .... | path count (varint)
+ * .... | .... | (paths)
+ *
+ * and paths this one:
+ *
+ * Offs | Size | Description
+ * -----+------+-------------
+ * 0x00 | .... | number of elements / 2 (bits 1-31), is closed (bit 0) (varint)
+ * .... | .... | grid bounds
+ * .... | .... | segment tags, as above
+ * .... | .... | size of the points in bytes (varint)
+ * .... | .... | points, as for float32 but zig-zag varints: the first pair
+ *      |      | is the first point, and every other is the step from the
+ *      |      | point before
+ *
+ * grid bounds are min_x and min_y (zig-zag varints), then the width and
+ * height (varints), all in grid steps. writers round the bounds outwards, and
+ * the points to the nearest step, so coordinates come back within half a step
+ * of where they were. the size of the points lets readers skip over them.
+ *
+ * -----
+ *
+ * HALF COORDINATES. when the flags say so, shapes and paths are laid out as
+ * above, but every float32 of their bounds and points is a float16 instead.
+ * writers round the bounds outwards and the points to the nearest float16,
+ * and fail on coordinates beyond the float16 range (+/-65504). this is meant
+ * for small drawings such as icons: up to 1024 units from the origin,
+ * coordinates come back within a quarter of a unit.
+ *
+ * -----
+ *
+ * PREDICTED POINTS. when the flags say so, the points of each path take up
+ * the same bytes as above, but every coordinate after the first pair is
+ * stored as the step from the one two before it, which is the last on the
+ * same axis. steps are taken between the bit patterns of the floats, as
+ * uint32 (or uint16) wrapping around, so they come back exactly. paths with
+ * 256 stored coordinates or more then have them split into byte planes: the
+ * most significant byte of every coordinate in turn, then the next, and so
+ * on. the bounds are stored as usual. neighbouring points of real drawings
+ * are close together, so the steps share their high bits, which makes the
+ * file compress much better (see COMPRESSED FILES below).
+ *
+ * -----
+ *
+ * ALIGNED FILES. when the flags say so, shapes and paths have zero bytes of
+ * padding before their bounds and before their points, as many as it takes
+ * for those to start at a multiple of 16 bytes from the start of the file.
+ * readers work the padding out from where they are, so nothing records it.
+ * a file mapped into memory can then have its points loaded straight into
+ * vector registers.
+ *
+ * when the flags also say the bounds and points are little-endian, each of
+ * their floats is stored least significant byte first instead, as most
+ * hosts hold them, and points not stored as steps can be used where they
+ * lie with no copy at all (see pv_view_path_floats()). points stored as
+ * steps are always big-endian. every other field stays big-endian.
+ *
  * -----
  *
  * GRADIENT FORMAT. pv files have an array of gradients used in shapes, the
@@ -126,7 +248,8 @@
  * -----+------+-------------
  * 0x00 | 0x18 | float32[6]: xform
  * 0x18 | 0x08 | float32[2]: fx, fy
- * 0x20 | 0x02 | uint16: number of stops (bits 0-13), spread type (bits 14-15)
+ * 0x20 | 0x02 | uint16: number of stops (bits 0-12), is radial (bit 13),
+ *      |      | spread type (bits 14-15)
  * 0x22 | .... | (stops): { float16 offset, uint32 colour } (sizeof == 6)
  *      |      | offset is relative to previous stop
  *
@@ -143,6 +266,30 @@
  * for a linear gradient, the first point is at (0, 0) and the last is at
  * (0, 1). for a radial gradient, the centre is at (0, 0) and the radius is at
  * 1.
+ *
+ * -----
+ *
+ * COMPRESSED FILES. a whole pv file may instead be stored packed, in blocks
+ * that readers can unpack one at a time as they decode:
+ *
+ * Offs | Size | Description
+ * -----+------+-------------
+ * 0x00 | 0x01 | const 0x8A (high bit set a la PNG)
+ * 0x01 | 0x02 | const ASCII("PZ")
+ * 0x03 | 0x01 | const 0x00 (version code)
+ * 0x04 | 0x02 | const ASCII("\r\n")
+ * 0x06 | 0x01 | const ASCII(EOF)
+ * 0x07 | 0x01 | const ASCII("\n")
+ * 0x08 | 0x04 | size of the pv file (uint32)
+ * 0x0C | .... | (blocks)
+ *
+ * the pv file is cut into blocks of 64 KiB, the last of which may be
+ * shorter. each block is a uint32 giving the size of its packed bytes (bits
+ * 0-30) and whether they are stored as they are instead (bit 31), followed by
+ * those bytes. packed bytes are LZ77 matches within the block with Huffman
+ * codes, the details of which are in lz.h. the pv file inside must be version
+ * 0x01 or later, as readers follow its shape offset table to know when a
+ * whole shape has been unpacked.
  */
 
 #ifndef INC__PVLIB_PV_H
@@ -166,6 +313,180 @@
 
 #include "nanosvg.h"
 
+/**
+ * @brief Output callback for streaming encodes
+ * @param ctx The context pointer given alongside the callback
+ * @param b A reference to the bytes to write
+ * @param n The number of bytes to write
+ * @return Zero on success, nonzero to abort the encode
+ */
+typedef int ( *pv_write_fn )( void*, const void*, size_t );
+
+/**
+ * @brief Input callback for streaming decodes
+ * @param ctx The context pointer given alongside the callback
+ * @param b A reference to where the bytes read go
+ * @param n The number of bytes to read
+ * @return Zero once exactly @a n bytes are read, nonzero if they cannot be
+ */
+typedef int ( *pv_read_fn )( void*, void*, size_t );
+
+/* Field sentinel bits, as laid out in the SHAPE FORMAT above */
+#define PV_SHAPE_FILL 0x01
+#define PV_SHAPE_STROKE 0x02
+#define PV_SHAPE_DASHED 0x04
+#define PV_SHAPE_TRANSLUCENT 0x08
+#define PV_SHAPE_FILL_GRADIENT 0x10
+#define PV_SHAPE_STROKE_GRADIENT 0x20
+#define PV_SHAPE_EVENODD 0x40
+#define PV_SHAPE_VISIBLE 0x80
+
+/* Segment types, as given by pv_view_path_segs() */
+#define PV_SEG_CUBIC 0
+#define PV_SEG_LINE 1
+
+/* Style index of shapes from files without a style table */
+#define PV_NO_STYLE 0xFFFFFFFFU
+
+/* Coordinate encodings, as in bits 0-1 of the header flags */
+#define PV_COORDS_F32 0
+#define PV_COORDS_GRID 1
+#define PV_COORDS_F16 2
+
+/**
+ * @brief Options for the encoders that take them
+ *
+ * Zeroed options write the same file as the encoders without options.
+ */
+struct pv_opts
+{
+	/* how shape and path coordinates are stored, one of PV_COORDS_* */
+	int coords;
+	/* the grid step with PV_COORDS_GRID */
+	float quantum;
+	/* nonzero to write a compressed file (see COMPRESSED FILES above) */
+	int compress;
+	/* nonzero to store points as steps, other than on a grid (see PREDICTED
+	 * POINTS above) */
+	int predict;
+	/* nonzero to align bounds and points, other than on a grid (see ALIGNED
+	 * FILES above) */
+	int align;
+	/* nonzero to store bounds and points in host byte order, other than on
+	 * a grid or as steps */
+	int native;
+};
+
+/**
+ * @brief Read-only view over an encoded PV buffer
+ *
+ * A view decodes records in place as they are asked for, and never allocates.
+ * The buffer it is opened over may be a memory mapping of a PV file, and must
+ * outlive the view. Treat the fields as read-only.
+ */
+struct pv_view
+{
+	const unsigned char* b;
+	size_t sz;
+	unsigned char ver;
+	float width, height;
+	unsigned shape_ct;
+	unsigned short grads_ct;
+	unsigned short pal_ct;
+	unsigned style_ct;
+	/* the header flags, and the grid step if coordinates are on a grid */
+	unsigned flags;
+	float quantum;
+	/* where the shape offset table, palette, style offset table and first
+	 * shape are; all but the last are zero in versions without them */
+	size_t table_offs;
+	size_t pal_offs;
+	size_t styles_offs;
+	size_t shapes_offs;
+	/* where the shape last looked up starts, to make walking them cheap */
+	unsigned last_i;
+	size_t last_offs;
+	/* where the gradient table starts, or zero until it has been found */
+	size_t grads_offs;
+};
+
+/**
+ * @brief A shape record as seen through a pv_view
+ *
+ * @a fill and @a stroke hold a colour (0xAABBGGRR, like NSVGpaint, already
+ * looked up in the palette) or, if the matching PV_SHAPE_*_GRADIENT bit is set
+ * in @a opts, a gradient ID.
+ *
+ * Shapes with the same @a style share every field from @a opts up to
+ * @a miter, so renderers can batch by it; it is PV_NO_STYLE in files
+ * without a style table.
+ */
+struct pv_vshape
+{
+	unsigned style;
+	unsigned char opts;
+	unsigned fill, stroke;
+	float opacity;
+	float stroke_w;
+	float dash_offs;
+	float dashes[8];
+	unsigned char dash_ct;
+	unsigned char join, cap;
+	float miter;
+	float bounds[4];
+	unsigned path_ct;
+	/* private: where the paths start, and the path last looked up */
+	size_t paths_offs;
+	unsigned last_j;
+	size_t last_offs;
+};
+
+/**
+ * @brief A path record as seen through a pv_view
+ *
+ * @a pts points into the viewed buffer at 2 * @a pts_ct float32 values, or
+ * at as many float16 values or grid varints as the header flags say, which
+ * is fewer than the @a npts points nanoSVG would have when some segments are
+ * stored as lines. Use pv_view_path_pts() to get all of them as host floats,
+ * pv_view_path_segs() to get only the stored ones along with the segment
+ * types, or pv_view_path_floats() to use the stored ones in place when they
+ * already are host floats.
+ */
+struct pv_vpath
+{
+	unsigned npts;
+	unsigned pts_ct;
+	int closed;
+	float bounds[4];
+	const void* pts;
+	/* private: the segment tags, or NULL before version 0x04 */
+	const void* tags;
+	/* private: the coordinate encoding, the size of the points, and the
+	 * grid step if on a grid */
+	int coords;
+	size_t pts_sz;
+	float quantum;
+	/* private: are the points stored as steps? are they little-endian? */
+	int predict;
+	int little;
+};
+
+/**
+ * @brief A gradient record as seen through a pv_view
+ *
+ * @a stops points into the viewed buffer at @a stops_ct encoded stops; use
+ * pv_view_gradient_stops() to get them as NSVGgradientStop values.
+ */
+struct pv_vgradient
+{
+	float xform[6];
+	float fx, fy;
+	char type;
+	char spread;
+	unsigned stops_ct;
+	const void* stops;
+};
+
 #ifndef PV_NO_STDIO
 
 /**
@@ -180,6 +501,11 @@ PVLIB_API int pv_fchksig( FILE* );
  * @param f A reference to a standard library FILE object, opened in read mode
  * @param i A reference to a valid NSVGimage struct to output the data into
  * @return Zero on success, nonzero otherwise
+ *
+ * Compressed files are read front to back a block at a time, and decoded as
+ * they are unpacked, so they can come down a pipe and never need more memory
+ * than their header tables, one block and the biggest shape. Other files are
+ * read into memory whole first.
  */
 PVLIB_API int pv_fpv2nsvg( FILE*, struct NSVGimage* );
 
@@ -189,9 +515,23 @@ PVLIB_API int pv_fpv2nsvg( FILE*, struct NSVGimage* );
  * @param f A reference to a standard library FILE object, opened in write
  *          mode
  * @return Zero on success, nonzero otherwise
+ *
+ * The file is written front to back from wherever @a f is, without seeking,
+ * so pipes and sockets work.
  */
 PVLIB_API int pv_fnsvg2pv( struct NSVGimage*, FILE* );
 
+/**
+ * @brief Convert NSVGimage to PV file, with options
+ * @param i A reference to a valid NSVGimage struct to read the data from
+ * @param o A reference to the options to encode with, or NULL for defaults
+ * @param f A reference to a standard library FILE object, opened in write
+ *          mode
+ * @return Zero on success, nonzero otherwise
+ */
+PVLIB_API int pv_fnsvg2pv_opts(
+	struct NSVGimage*, const struct pv_opts*, FILE* );
+
 #endif /* PV_NO_STDIO */
 
 /**
@@ -208,17 +548,235 @@ PVLIB_API int pv_chksig( void* );
  * @param s The size of the input memory buffer, in bytes
  * @param i A reference to a valid NSVGimage struct to output the data into
  * @return Zero on success, nonzero otherwise
+ *
+ * The whole buffer is decoded in one pass, and nothing past @a s is read.
+ * Shapes, paths and gradients are allocated the same way nanoSVG allocates
+ * them, so the result can be released with nsvgDelete(). Compressed buffers
+ * are unpacked a block at a time as they are decoded.
  */
 PVLIB_API int pv_pv2nsvg( void*, size_t, struct NSVGimage* );
 
+/**
+ * @brief Convert compressed PV data, streamed through a callback, to
+ *        NSVGimage
+ * @param i The callback to read the compressed file through, front to back
+ * @param ctx A context pointer passed along to @a i
+ * @param o A reference to a valid NSVGimage struct to output the data into
+ * @return Zero on success, nonzero otherwise
+ *
+ * Blocks are read and unpacked as they are needed, and each shape is decoded
+ * as soon as the whole of it has been, so only the header tables, one block
+ * and the biggest shape are ever held at once. Files that are not compressed
+ * do not say where their shapes end up front, and are refused.
+ */
+PVLIB_API int pv_pv2nsvg_cb( pv_read_fn, void*, struct NSVGimage* );
+
+/**
+ * @brief Convert the part of a PV buffer in a given area to NSVGimage
+ * @param b A reference to a buffer in memory, the size of which is not less
+ *          than the value provided in @a s
+ * @param s The size of the input memory buffer, in bytes
+ * @param i A reference to a valid NSVGimage struct to output the data into
+ * @param r A reference to the area of interest, as a tuple of (min_x, min_y,
+ *          max_x, max_y)
+ * @param p Nonzero to leave out paths outside of the area as well as shapes
+ * @return Zero on success, nonzero otherwise
+ *
+ * Shapes are tested with their stored bounds, grown when stroked by as far as
+ * the stroke can reach: half its width, times the miter limit with mitred
+ * joins, or the square root of 2 with square caps. The point arrays of shapes
+ * left out are never read. Kept shapes keep their stored bounds even if some
+ * of their paths are left out.
+ */
+PVLIB_API int pv_pv2nsvg_cull(
+	void*, size_t, struct NSVGimage*, const float*, int );
+
+/**
+ * @brief Convert PV buffer to NSVGimage, using several threads
+ * @param b A reference to a buffer in memory, the size of which is not less
+ *          than the value provided in @a s
+ * @param s The size of the input memory buffer, in bytes
+ * @param i A reference to a valid NSVGimage struct to output the data into
+ * @param n The number of threads to decode with; 0 or 1 is the same as
+ *          calling pv_pv2nsvg()
+ * @return Zero on success, nonzero otherwise
+ *
+ * Shapes are split into runs of about the same size in bytes, one per
+ * thread, and the result is identical to that of pv_pv2nsvg(). Built with
+ * PV_NO_THREADS, or given a compressed buffer, which can only be unpacked in
+ * order, this always decodes on the calling thread.
+ */
+PVLIB_API int pv_pv2nsvg_mt( void*, size_t, struct NSVGimage*, unsigned );
+
+/**
+ * @brief Convert PV buffer to NSVGimage, all in one allocation
+ * @param b A reference to a buffer in memory, the size of which is not less
+ *          than the value provided in @a s
+ * @param s The size of the input memory buffer, in bytes
+ * @param i A reference to a valid NSVGimage struct to output the data into
+ * @return Zero on success, nonzero otherwise
+ *
+ * The result is the same as that of pv_pv2nsvg(), but every shape, path,
+ * point array and gradient is placed in one block, sized beforehand from
+ * the shape and path headers. It must be released with pv_nsvg_delete(),
+ * never with nsvgDelete(). Compressed buffers are unpacked whole first.
+ */
+PVLIB_API int pv_pv2nsvg_arena( void*, size_t, struct NSVGimage* );
+
+/**
+ * @brief Release an NSVGimage from pv_pv2nsvg_arena()
+ * @param i A reference to the NSVGimage to release, as nsvgDelete() would
+ *
+ * This frees the one block everything was placed in, and then the image
+ * itself, however many shapes and paths it has.
+ */
+PVLIB_API void pv_nsvg_delete( struct NSVGimage* );
+
 /**
  * @brief Convert NSVGimage to PV buffer
  * @param i A reference to a valid NSVGimage struct to read the data from
  * @param b A reference to a buffer in memory, the size of which is not less
- *          than the value provided in @a s
- * @param s The size of the output memory buffer, in bytes
+ *          than the value provided in @a s, or NULL to only size the output
+ * @param s The size of the output memory buffer, in bytes; on success, set
+ *          to the number of bytes written, or needed if @a b is NULL
  * @return Zero on success, nonzero otherwise
+ *
+ * Sizing only walks the shape and path lists, so it is cheap enough to call
+ * before every encode to get a buffer of exactly the right size.
  */
 PVLIB_API int pv_nsvg2pv( struct NSVGimage*, void*, size_t* );
 
+/**
+ * @brief Open a view over a PV buffer
+ * @param b A reference to a buffer in memory, the size of which is not less
+ *          than the value provided in @a s
+ * @param s The size of the input memory buffer, in bytes
+ * @param v A reference to the view to set up
+ * @return Zero on success, nonzero otherwise
+ *
+ * Only the header is looked at; records are checked as they are visited.
+ * Compressed buffers cannot be viewed, and fail the signature check.
+ */
+PVLIB_API int pv_view_init( const void*, size_t, struct pv_view* );
+
+/**
+ * @brief Look up a shape through a view
+ * @param v A reference to an open view
+ * @param i The index of the shape, less than the view's shape count
+ * @param sh A reference to the shape record to fill in
+ * @return Zero on success, nonzero otherwise
+ *
+ * This is O(1) with the shape offset table of version 0x01 files and up.
+ * Version 0x00 files have none, so finding a shape there means skipping the
+ * ones before it, although walking them in order still costs O(1) per shape.
+ */
+PVLIB_API int pv_view_shape( struct pv_view*, unsigned, struct pv_vshape* );
+
+/**
+ * @brief Look up a path of a shape through a view
+ * @param v A reference to an open view
+ * @param sh A reference to a shape record from pv_view_shape()
+ * @param j The index of the path, less than the shape's path count
+ * @param p A reference to the path record to fill in
+ * @return Zero on success, nonzero otherwise
+ */
+PVLIB_API int pv_view_path(
+	struct pv_view*, struct pv_vshape*, unsigned, struct pv_vpath* );
+
+/**
+ * @brief Copy the points of a path out as host floats
+ * @param p A reference to a path record from pv_view_path()
+ * @param o A reference to room for 2 * @a p->npts floats
+ *
+ * The points come out as nanoSVG would have them, with lines made into
+ * cubics.
+ */
+PVLIB_API void pv_view_path_pts( const struct pv_vpath*, float* );
+
+/**
+ * @brief Copy the segments of a path out as stored
+ * @param p A reference to a path record from pv_view_path()
+ * @param t A reference to room for (@a p->npts - 1) / 3 segment types, each
+ *          one of PV_SEG_LINE or PV_SEG_CUBIC
+ * @param o A reference to room for 2 * @a p->pts_ct floats
+ *
+ * The first point is the start of the path. Each line then adds its end
+ * point, and each cubic its two control points and end point.
+ */
+PVLIB_API void pv_view_path_segs(
+	const struct pv_vpath*, unsigned char*, float* );
+
+/**
+ * @brief Get the stored points of a path in place, as host floats
+ * @param p A reference to a path record from pv_view_path()
+ * @return A reference into the viewed buffer at the 2 * @a p->pts_ct floats
+ *         pv_view_path_segs() would copy out, or NULL if they are not stored
+ *         as host floats there
+ *
+ * Points are float32 in host byte order and suitably aligned when written
+ * with the align and native options on a host with the same byte order, and
+ * not stored as steps. They are then 16-byte aligned too if the buffer is,
+ * as memory mappings are.
+ */
+PVLIB_API const float* pv_view_path_floats( const struct pv_vpath* );
+
+/**
+ * @brief Look up a gradient through a view
+ * @param v A reference to an open view
+ * @param id The gradient ID, less than the view's gradient count
+ * @param g A reference to the gradient record to fill in
+ * @return Zero on success, nonzero otherwise
+ */
+PVLIB_API int pv_view_gradient(
+	struct pv_view*, unsigned, struct pv_vgradient* );
+
+/**
+ * @brief Copy the stops of a gradient out
+ * @param g A reference to a gradient record from pv_view_gradient()
+ * @param o A reference to room for @a g->stops_ct stops
+ */
+PVLIB_API void pv_view_gradient_stops(
+	const struct pv_vgradient*, struct NSVGgradientStop* );
+
+/**
+ * @brief Convert NSVGimage to PV data, streamed through a callback
+ * @param i A reference to a valid NSVGimage struct to read the data from
+ * @param o The callback to hand the encoded bytes to, in order
+ * @param ctx A context pointer passed along to @a o
+ * @return Zero on success, nonzero otherwise
+ *
+ * Output is strictly forward-only and comes in blocks of up to 64 KiB, so it
+ * can go straight into a compressor or network buffer.
+ */
+PVLIB_API int pv_nsvg2pv_cb( struct NSVGimage*, pv_write_fn, void* );
+
+/**
+ * @brief Convert NSVGimage to PV buffer, with options
+ * @param i A reference to a valid NSVGimage struct to read the data from
+ * @param o A reference to the options to encode with, or NULL for defaults
+ * @param b A reference to a buffer in memory, the size of which is not less
+ *          than the value provided in @a s, or NULL to only size the output
+ * @param s The size of the output memory buffer, in bytes; on success, set
+ *          to the number of bytes written, or needed if @a b is NULL
+ * @return Zero on success, nonzero otherwise
+ *
+ * With PV_COORDS_GRID, this fails with -6 if any coordinate is more than
+ * 2^30 grid steps away from the origin, and with PV_COORDS_F16, if any is
+ * beyond the float16 range.
+ */
+PVLIB_API int pv_nsvg2pv_opts(
+	struct NSVGimage*, const struct pv_opts*, void*, size_t* );
+
+/**
+ * @brief Convert NSVGimage to PV data, streamed through a callback, with
+ *        options
+ * @param i A reference to a valid NSVGimage struct to read the data from
+ * @param opt A reference to the options to encode with, or NULL for defaults
+ * @param o The callback to hand the encoded bytes to, in order
+ * @param ctx A context pointer passed along to @a o
+ * @return Zero on success, nonzero otherwise
+ */
+PVLIB_API int pv_nsvg2pv_cb_opts(
+	struct NSVGimage*, const struct pv_opts*, pv_write_fn, void* );
+
 #endif /* INC__PVLIB_PV_H */
@@ -0,0 +1,104 @@
+#include "bswap.h"
+#include "util.h"
+
+static const char* names[] = { "scalar", "ssse3", "avx2" };
+
+/* Most values copied, and most bytes they may start off an aligned one */
+#define MAX_N 200
+#define MAX_OFFS 31
+
+/* Swapping 32-bit and 16-bit values gives what swapping their bytes one at a
+ * time does, for every count up to MAX_N starting at every offset, copied
+ * and in place, and nothing past them is touched */
+static void same_as_bytes( int isa )
+{
+	static unsigned char in[MAX_N * 4 + MAX_OFFS + 8];
+	static unsigned char out[MAX_N * 4 + MAX_OFFS + 8];
+	static unsigned char want[MAX_N * 4 + MAX_OFFS + 8];
+	unsigned w, offs, n, i, k;
+
+	for( i = 0; i < sizeof( in ); ++i )
+	{
+		in[i] = (unsigned char)( i * 37 + 11 );
+	}
+
+	for( w = 2; w <= 4; w += 2 )
+	{
+		for( offs = 0; offs <= MAX_OFFS; ++offs )
+		{
+			for( n = 0; n <= MAX_N; ++n )
+			{
+				memset( out, 0xA5, sizeof( out ) );
+				memset( want, 0xA5, sizeof( want ) );
+
+				for( i = 0; i < n; ++i )
+				{
+					for( k = 0; k < w; ++k )
+					{
+						want[offs + ( i * w ) + k] =
+							in[offs + ( i * w ) + ( w - 1 - k )];
+					}
+				}
+
+				if( w == 4 )
+				{
+					pv_bswap32_n( out + offs, in + offs, n );
+				}
+				else
+				{
+					pv_bswap16_n( out + offs, in + offs, n );
+				}
+
+				if( memcmp( out, want, sizeof( out ) ) )
+				{
+					fprintf( stderr,
+						"bswap %s: %u %u-bit values at offset %u differ\n",
+						names[isa], n, w * 8, offs );
+					fails++;
+
+					return;
+				}
+
+				memcpy( out + offs, in + offs, n * w );
+
+				if( w == 4 )
+				{
+					pv_bswap32_n( out + offs, out + offs, n );
+				}
+				else
+				{
+					pv_bswap16_n( out + offs, out + offs, n );
+				}
+
+				if( memcmp( out, want, sizeof( out ) ) )
+				{
+					fprintf( stderr,
+						"bswap %s: %u %u-bit values at offset %u differ in "
+						"place\n",
+						names[isa], n, w * 8, offs );
+					fails++;
+
+					return;
+				}
+			}
+		}
+	}
+}
+
+int main( void )
+{
+	int isa;
+
+	for( isa = PV_BSWAP_ISA_SCALAR; isa <= PV_BSWAP_ISA_AVX2; ++isa )
+	{
+		/* Instruction sets the CPU lacks fall back to the scalar code */
+		if( pv_bswap_isa( isa ) == isa )
+		{
+			same_as_bytes( isa );
+		}
+	}
+
+	pv_bswap_isa( PV_BSWAP_ISA_BEST );
+
+	return fails != 0;
+}
@@ -0,0 +1,114 @@
+/* cosf and the like are C99, not C89 */
+#define _ISOC99_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+/* nanoSVG built here with every colour keyword, which pv.a leaves out; the
+ * basic ones are a subset of these, in the same order */
+#define NANOSVG_ALL_COLOR_KEYWORDS
+#define NANOSVG_IMPLEMENTATION
+
+#include "nanosvg.h"
+
+#define COLORS_CT ( sizeof( nsvg__colors ) / sizeof( nsvg__colors[0] ) )
+
+/* What nsvg__parseColorName gives for names it does not know */
+#define GRAY NSVG_RGB( 128, 128, 128 )
+
+static int fails = 0;
+
+/* The colour of NAME found by looking at every keyword in turn */
+static unsigned int by_scan( const char* name )
+{
+	unsigned i;
+
+	for( i = 0; i < COLORS_CT; ++i )
+	{
+		if( strcmp( nsvg__colors[i].name, name ) == 0 )
+		{
+			return nsvg__colors[i].color;
+		}
+	}
+
+	return GRAY;
+}
+
+/* NAME, as a fill, paints what a scan of the keywords finds for it */
+static void same_as_scan( const char* name )
+{
+	char svg[256];
+	struct NSVGimage* img;
+	unsigned int want, got;
+
+	want = by_scan( name );
+	got  = nsvg__parseColorName( name );
+
+	if( got != want )
+	{
+		fprintf( stderr, "colors: \"%s\" is %06x, not %06x\n", name, got,
+			want );
+		fails++;
+
+		return;
+	}
+
+	sprintf( svg, "<svg><rect width=\"1\" height=\"1\" fill=\"%s\"/></svg>",
+		name );
+	img = nsvgParse( svg, "px", 96.0f );
+
+	/* nanoSVG keeps opacity in the top byte of the colours it parses */
+	if( !img || !img->shapes ||
+		( img->shapes->fill.color & 0xFFFFFF ) != want )
+	{
+		fprintf( stderr, "colors: fill=\"%s\" did not paint %06x\n", name,
+			want );
+		fails++;
+	}
+
+	if( img )
+	{
+		nsvgDelete( img );
+	}
+}
+
+int main( void )
+{
+	static const char* misses[] = { "", "currentColor", "inherit",
+		"transparent", "a", "zzz", "Red", "BLACK", "blu", "bluex",
+		"aliceblue ", "yellowgreenx", "darkgrey0", "lightgoldenrodyello" };
+	char name[64];
+	unsigned i, k;
+
+	for( i = 0; i < COLORS_CT; ++i )
+	{
+		/* The binary search needs them in order */
+		if( i > 0 && strcmp( nsvg__colors[i - 1].name, nsvg__colors[i].name ) >=
+				0 )
+		{
+			fprintf( stderr, "colors: \"%s\" is out of order\n",
+				nsvg__colors[i].name );
+			fails++;
+		}
+
+		same_as_scan( nsvg__colors[i].name );
+
+		/* One letter more or less, at either end */
+		strcpy( name, nsvg__colors[i].name );
+		name[strlen( name ) - 1] = '\0';
+		same_as_scan( name );
+		same_as_scan( nsvg__colors[i].name + 1 );
+		sprintf( name, "%sa", nsvg__colors[i].name );
+		same_as_scan( name );
+		sprintf( name, "a%s", nsvg__colors[i].name );
+		same_as_scan( name );
+	}
+
+	for( k = 0; k < sizeof( misses ) / sizeof( misses[0] ); ++k )
+	{
+		same_as_scan( misses[k] );
+	}
+
+	return fails != 0;
+}
@@ -0,0 +1,201 @@
+#include "util.h"
+
+/* A sharp V pointing right with its tip at x = 100. Mitred, its stroke
+ * reaches 20 past the tip; rounded, only 1 */
+static const char* svg_v =
+	"<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"200\" height=\"20\">"
+	"<path d=\"M0,0 L100,5 L0,10\" fill=\"none\" stroke=\"#000\" "
+	"stroke-width=\"2\" stroke-miterlimit=\"30\" stroke-linejoin=\"%s\"/>"
+	"</svg>";
+
+/* Just right of the tip, past half the stroke width */
+static const float clip[4] = { 105.0f, -50.0f, 200.0f, 50.0f };
+
+/* Far around the whole of any test image */
+static const float everything[4] = { -1e6f, -1e6f, 1e6f, 1e6f };
+
+/* Encode the V with JOIN, decode the part in the clip rect with PATHS, and
+ * count the shapes and paths kept */
+static int cull_v( const char* join, int paths, int* shapes, int* kept )
+{
+	struct NSVGimage* img;
+	struct NSVGimage* out;
+	struct NSVGshape* sh;
+	struct NSVGpath* p;
+	unsigned char* b;
+	char src[512];
+	size_t sz;
+	int r;
+
+	sprintf( src, svg_v, join );
+	img = nsvgParse( src, "px", 96.0f );
+
+	if( !img )
+	{
+		return -2;
+	}
+
+	r = encode_file( img, &b, &sz );
+	nsvgDelete( img );
+
+	out = r ? NULL : calloc( 1, sizeof( struct NSVGimage ) );
+	r   = r ? r : !out ? -2 : pv_pv2nsvg_cull( b, sz, out, clip, paths );
+	free( b );
+
+	*shapes = 0;
+	*kept   = 0;
+
+	for( sh = out && !r ? out->shapes : NULL; sh; sh = sh->next )
+	{
+		*shapes += 1;
+
+		for( p = sh->paths; p; p = p->next )
+		{
+			*kept += 1;
+		}
+	}
+
+	if( out )
+	{
+		nsvgDelete( out );
+	}
+
+	return r;
+}
+
+static void expect( const char* join, int paths, int want )
+{
+	int r, shapes, kept;
+
+	r = cull_v( join, paths, &shapes, &kept );
+
+	if( r || shapes != want || kept != want )
+	{
+		fprintf( stderr,
+			"cull: %s V with paths %d: got %d, %d shapes, %d paths; want %d\n",
+			join, paths, r, shapes, kept, want );
+		fails++;
+	}
+}
+
+/* With nothing to leave out, culling gives what pv_pv2nsvg does, and every
+ * prefix of the file is refused as truncated */
+static void keep_all( const unsigned char* b, size_t sz, int sweep )
+{
+	struct NSVGimage *ref, *out;
+	unsigned char* cut;
+	size_t k;
+	int r;
+
+	ref = calloc( 1, sizeof( struct NSVGimage ) );
+	out = calloc( 1, sizeof( struct NSVGimage ) );
+
+	if( !ref || !out )
+	{
+		fail( "cull", "out of memory", 0 );
+	}
+	else if( ( r = pv_pv2nsvg( (void*)( b ), sz, ref ) ) != 0 )
+	{
+		fail( "cull", "pv_pv2nsvg failed with", r );
+	}
+	else if( ( r = pv_pv2nsvg_cull( (void*)( b ), sz, out, everything, 1 ) ) !=
+		0 )
+	{
+		fail( "cull", "pv_pv2nsvg_cull failed with", r );
+	}
+	else
+	{
+		same_image( "cull", ref, out, 0.0f );
+	}
+
+	if( ref )
+	{
+		nsvgDelete( ref );
+	}
+
+	if( out )
+	{
+		nsvgDelete( out );
+	}
+
+	for( k = 0x16; sweep && k < sz; ++k )
+	{
+		cut = malloc( k );
+		out = calloc( 1, sizeof( struct NSVGimage ) );
+		r   = cut && out ? 0 : -2;
+
+		if( !r )
+		{
+			memcpy( cut, b, k );
+			r = pv_pv2nsvg_cull( cut, k, out, everything, 1 );
+		}
+
+		if( r != -3 )
+		{
+			fail( "cull truncated", "wrong result for length", (int)( k ) );
+		}
+
+		if( out )
+		{
+			nsvgDelete( out );
+		}
+
+		free( cut );
+	}
+}
+
+int main( void )
+{
+	struct NSVGimage* img;
+	unsigned char* b;
+	size_t sz;
+	int r;
+
+	/* The miter spike is inside the clip rect, so the V must be kept */
+	expect( "miter", 0, 1 );
+	expect( "miter", 1, 1 );
+
+	/* Rounded, nothing of it is */
+	expect( "round", 0, 0 );
+	expect( "round", 1, 0 );
+
+	img = test_image( 200 );
+	r   = img ? encode_file( img, &b, &sz ) : -2;
+
+	if( r )
+	{
+		fail( "cull", "encoding failed with", r );
+	}
+	else
+	{
+		keep_all( b, sz, 0 );
+		free( b );
+	}
+
+	if( img )
+	{
+		nsvgDelete( img );
+	}
+
+	img = test_image( 12 );
+	r   = img ? encode_file( img, &b, &sz ) : -2;
+
+	if( r )
+	{
+		fail( "cull", "encoding failed with", r );
+	}
+	else
+	{
+		keep_all( b, sz, 1 );
+		free( b );
+	}
+
+	if( img )
+	{
+		nsvgDelete( img );
+	}
+
+	keep_all( v0_pv, sizeof( v0_pv ), 1 );
+
+	return fails != 0;
+}
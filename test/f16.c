@@ -0,0 +1,124 @@
+#include "float16.h"
+#include "util.h"
+
+static const char* names[] = { "scalar", "sse2", "avx2", "f16c" };
+
+/* Bit patterns at the edges of what float16 holds: zeros, the smallest and
+ * largest subnormal and normal halves, just past the largest, infinities and
+ * NaNs, each either sign */
+static const unsigned edges[] = {
+	0x00000000, 0x33000000, 0x33800000, 0x387FC000, 0x38800000, 0x477FE000,
+	0x477FEFFF, 0x477FF000, 0x47800000, 0x7F7FFFFF, 0x7F800000, 0x7F800001,
+	0x7FC00000, 0x7FFFFFFF
+};
+
+#define EDGES_CT ( sizeof( edges ) / sizeof( edges[0] ) )
+
+#define BATCH 4093
+
+/* The step between the float bit patterns checked, about a million */
+#define STEP 0x1003
+
+/* The first N floats at F convert in one batch as they do one at a time */
+static void halves_of( int isa, const float* f, size_t n )
+{
+	static unsigned short h[BATCH];
+	unsigned short want;
+	unsigned bits;
+	size_t i;
+
+	pv_f16_32to16_n( h, f, n );
+
+	for( i = 0; i < n; ++i )
+	{
+		want = pv_f16_32to16( f[i] );
+
+		if( h[i] != want )
+		{
+			memcpy( &bits, f + i, 4 );
+			fprintf( stderr, "f16 %s: 32to16 of %08x gave %04x, not %04x\n",
+				names[isa], bits, h[i], want );
+			fails++;
+
+			return;
+		}
+	}
+}
+
+/* The batch conversions give what the scalar ones do, bit for bit, for
+ * every half, and for the edges and a spread of floats, in runs that leave
+ * a remainder */
+static void same_as_scalar( int isa )
+{
+	static float f[BATCH], g;
+	static unsigned short h[BATCH];
+	unsigned u, c, bits, gbits;
+	size_t i, n;
+
+	for( u = 0; u < 0x10000; u += n )
+	{
+		n = 0x10000 - u < BATCH ? 0x10000 - u : BATCH;
+
+		for( i = 0; i < n; ++i )
+		{
+			h[i] = (unsigned short)( u + i );
+		}
+
+		pv_f16_16to32_n( f, h, n );
+
+		for( i = 0; i < n; ++i )
+		{
+			g = pv_f16_16to32( h[i] );
+			memcpy( &bits, f + i, 4 );
+			memcpy( &gbits, &g, 4 );
+
+			if( bits != gbits )
+			{
+				fprintf( stderr, "f16 %s: 16to32 of %04x gave %08x, not %08x\n",
+					names[isa], h[i], bits, gbits );
+				fails++;
+
+				return;
+			}
+		}
+	}
+
+	for( u = 0, c = 0, n = 0;; ++c )
+	{
+		bits = c < EDGES_CT * 2 ? edges[c / 2] | ( c % 2 ? 0x80000000 : 0 ) : u;
+		memcpy( f + n, &bits, 4 );
+		n++;
+
+		if( c >= EDGES_CT * 2 && u > 0xFFFFFFFF - STEP )
+		{
+			halves_of( isa, f, n );
+			break;
+		}
+
+		if( n == BATCH )
+		{
+			halves_of( isa, f, n );
+			n = 0;
+		}
+
+		u += c < EDGES_CT * 2 ? 0 : STEP;
+	}
+}
+
+int main( void )
+{
+	int isa;
+
+	for( isa = PV_F16_ISA_SCALAR; isa <= PV_F16_ISA_F16C; ++isa )
+	{
+		/* Instruction sets the CPU lacks fall back to the scalar code */
+		if( pv_f16_isa( isa ) == isa )
+		{
+			same_as_scalar( isa );
+		}
+	}
+
+	pv_f16_isa( PV_F16_ISA_BEST );
+
+	return fails != 0;
+}
@@ -0,0 +1,229 @@
+#include "util.h"
+
+/* Gradients as the document defines them, newest last, for the paint of
+ * each shape to be worked out by walking them as nanoSVG used to */
+struct grad
+{
+	int id, href;
+	char type;
+	int nstops;
+	unsigned first;
+};
+
+/* Most gradients and shapes to a document */
+#define EVENTS 400
+
+/* What a shape is painted with: no paint, or a gradient of a type with
+ * NSTOPS stops, the first of them FIRST */
+struct paint
+{
+	char type;
+	int nstops;
+	unsigned first;
+};
+
+static unsigned long seed = 1;
+
+static unsigned rnd( unsigned n )
+{
+	seed = seed * 1103515245UL + 12345UL;
+
+	return (unsigned)( ( seed >> 16 ) % n );
+}
+
+/* The newest of the first N gradients with ID, or NULL */
+static const struct grad* find( const struct grad* g, int n, int id )
+{
+	while( n-- > 0 )
+	{
+		if( g[n].id == id )
+		{
+			return g + n;
+		}
+	}
+
+	return NULL;
+}
+
+/* The paint of a shape filled with gradient ID while the first N of G are
+ * defined, following xlink:href to the first with stops. Such a chain that
+ * goes on longer than there are ids loops, and paints nothing. */
+static struct paint resolve( const struct grad* g, int n, int id )
+{
+	struct paint paint = { NSVG_PAINT_NONE, 0, 0 };
+	const struct grad *data, *ref;
+	int ids = 0, i, k;
+
+	for( i = 0; i < n; ++i )
+	{
+		ids += find( g, i, g[i].id ) == NULL;
+	}
+
+	data = find( g, n, id );
+	ref  = data;
+
+	for( k = 0; ref && !ref->nstops && k < ids; ++k )
+	{
+		ref = ref->href < 0 ? NULL : find( g, n, ref->href );
+	}
+
+	if( ref && ref->nstops )
+	{
+		paint.type   = data->type;
+		paint.nstops = ref->nstops;
+		paint.first  = ref->first;
+	}
+
+	return paint;
+}
+
+/* A shape painted with PAINT, as nanoSVG gave it */
+static struct paint painted( const struct NSVGpaint* paint )
+{
+	struct paint p = { NSVG_PAINT_NONE, 0, 0 };
+
+	p.type = paint->type;
+
+	if( paint->type == NSVG_PAINT_LINEAR_GRADIENT ||
+		paint->type == NSVG_PAINT_RADIAL_GRADIENT )
+	{
+		p.nstops = paint->gradient->nstops;
+		p.first  = paint->gradient->stops[0].color;
+
+		/* nanoSVG keeps red in the low byte, and opacity in the top one */
+		p.first = ( p.first & 0xFF ) << 16 | ( p.first & 0xFF00 ) |
+			( p.first >> 16 & 0xFF );
+	}
+
+	return p;
+}
+
+static int differ( const struct paint* a, const struct paint* b )
+{
+	return a->type != b->type || a->nstops != b->nstops ||
+		a->first != b->first;
+}
+
+/* A document of gradients with ids out of IDS, referring to each other or
+ * to ids not defined yet, given stops before and after shapes are painted
+ * with them, paints each shape as walking the gradients did */
+static void same_as_walk( int ids )
+{
+	static struct grad g[EVENTS];
+	static struct paint want[EVENTS][2];
+	struct text t = { NULL, 0, 0 };
+	struct NSVGimage* img;
+	struct NSVGshape* s;
+	struct paint got[2];
+	char buf[160];
+	int n = 0, shapes = 0, open = 0, i, k, fill, stroke;
+	unsigned stop = 0;
+
+	put( &t, "<svg width=\"100\" height=\"100\">" );
+
+	for( i = 0; i < EVENTS; ++i )
+	{
+		switch( rnd( 10 ) )
+		{
+		case 0:
+		case 1:
+		case 2:
+			g[n].id     = (int)( rnd( ids ) );
+			g[n].href   = rnd( 4 ) ? (int)( rnd( ids ) ) : -1;
+			g[n].type   = rnd( 2 ) ? NSVG_PAINT_LINEAR_GRADIENT
+								   : NSVG_PAINT_RADIAL_GRADIENT;
+			g[n].nstops = 0;
+			g[n].first  = 0;
+			sprintf( buf, "%s<%sGradient id=\"g%d\"",
+				open ? "</linearGradient>" : "",
+				g[n].type == NSVG_PAINT_LINEAR_GRADIENT ? "linear" : "radial",
+				g[n].id );
+			put( &t, buf );
+
+			if( g[n].href >= 0 )
+			{
+				sprintf( buf, " xlink:href=\"#g%d\"", g[n].href );
+				put( &t, buf );
+			}
+
+			put( &t, ">" );
+			open = 1;
+			n++;
+			break;
+		case 3:
+		case 4:
+		case 5:
+			/* A stop goes to the newest gradient, open or not */
+			sprintf( buf, "<stop offset=\"0.5\" stop-color=\"#%06x\"/>",
+				++stop );
+			put( &t, buf );
+
+			if( n && !g[n - 1].nstops++ )
+			{
+				g[n - 1].first = stop;
+			}
+
+			break;
+		default:
+			fill   = (int)( rnd( ids + 1 ) );
+			stroke = (int)( rnd( ids + 1 ) );
+			sprintf( buf,
+				"<rect width=\"1\" height=\"1\" fill=\"url(#g%d)\" "
+				"stroke=\"url(#g%d)\"/>",
+				fill, stroke );
+			put( &t, buf );
+			want[shapes][0] = resolve( g, n, fill );
+			want[shapes][1] = resolve( g, n, stroke );
+			shapes++;
+			break;
+		}
+	}
+
+	put( &t, open ? "</linearGradient></svg>" : "</svg>" );
+	img = nsvgParse( t.b, "px", 96.0f );
+
+	for( k = 0, s = img ? img->shapes : NULL; s && k < shapes;
+		 ++k, s = s->next )
+	{
+		got[0] = painted( &s->fill );
+		got[1] = painted( &s->stroke );
+
+		if( differ( got, want[k] ) || differ( got + 1, want[k] + 1 ) )
+		{
+			fprintf( stderr,
+				"grads: shape %d of %d ids painted %d/%d/%06x and "
+				"%d/%d/%06x, not %d/%d/%06x and %d/%d/%06x\n",
+				k, ids, got[0].type, got[0].nstops, got[0].first,
+				got[1].type, got[1].nstops, got[1].first, want[k][0].type,
+				want[k][0].nstops, want[k][0].first, want[k][1].type,
+				want[k][1].nstops, want[k][1].first );
+			fails++;
+			break;
+		}
+	}
+
+	if( k != shapes && !fails )
+	{
+		fail( "grads", "shapes missing of", shapes );
+	}
+
+	if( img )
+	{
+		nsvgDelete( img );
+	}
+
+	free( t.b );
+}
+
+int main( void )
+{
+	unsigned i;
+
+	/* Few ids for duplicates and loops, many for the index to grow */
+	for( i = 0; i < 2000 && !fails; ++i )
+	{
+		same_as_walk( 1 + (int)( rnd( i % 2 ? 8 : 150 ) ) );
+	}
+
+	return fails != 0;
+}
@@ -0,0 +1,166 @@
+#include "util.h"
+
+static const unsigned threads[] = { 2, 3, 8 };
+
+#define THREADS_CT ( sizeof( threads ) / sizeof( threads[0] ) )
+
+/* Decoding B on several threads gives exactly what pv_pv2nsvg does */
+static void same_as_serial( const char* what, const unsigned char* b, size_t sz )
+{
+	struct NSVGimage *ref, *out;
+	unsigned i;
+	int r;
+
+	ref = calloc( 1, sizeof( struct NSVGimage ) );
+	r   = ref ? pv_pv2nsvg( (void*)( b ), sz, ref ) : -2;
+
+	if( r )
+	{
+		fail( what, "pv_pv2nsvg failed with", r );
+
+		if( ref )
+		{
+			nsvgDelete( ref );
+		}
+
+		return;
+	}
+
+	for( i = 0; i < THREADS_CT; ++i )
+	{
+		out = calloc( 1, sizeof( struct NSVGimage ) );
+		r   = out ? pv_pv2nsvg_mt( (void*)( b ), sz, out, threads[i] ) : -2;
+
+		if( r )
+		{
+			fail( what, "pv_pv2nsvg_mt failed with", r );
+		}
+		else if( !same_image( what, ref, out, 0.0f ) )
+		{
+			fprintf( stderr, "%s: differs on %u threads\n", what, threads[i] );
+		}
+
+		if( out )
+		{
+			nsvgDelete( out );
+		}
+	}
+
+	nsvgDelete( ref );
+}
+
+/* Every prefix of B is refused on several threads too */
+static void truncated( const char* what, const unsigned char* b, size_t sz )
+{
+	struct NSVGimage* out;
+	unsigned char* cut;
+	size_t k;
+	unsigned i;
+	int r;
+
+	for( k = 0x16; k < sz; ++k )
+	{
+		cut = malloc( k );
+
+		if( !cut )
+		{
+			fail( what, "out of memory at", (int)( k ) );
+			break;
+		}
+
+		memcpy( cut, b, k );
+
+		for( i = 0; i < THREADS_CT; ++i )
+		{
+			out = calloc( 1, sizeof( struct NSVGimage ) );
+			r   = out ? pv_pv2nsvg_mt( cut, k, out, threads[i] ) : -2;
+
+			if( r != -3 )
+			{
+				fail( what, "wrong result for length", (int)( k ) );
+			}
+
+			if( out )
+			{
+				nsvgDelete( out );
+			}
+		}
+
+		free( cut );
+	}
+}
+
+int main( void )
+{
+	static const unsigned counts[] = { 1, 5, 2000 };
+	struct NSVGimage* img;
+	struct pv_opts opts;
+	unsigned char* b;
+	size_t sz;
+	unsigned i;
+	int r;
+
+	/* Fewer shapes than threads, and plenty */
+	for( i = 0; i < sizeof( counts ) / sizeof( counts[0] ); ++i )
+	{
+		img = test_image( counts[i] );
+		r   = img ? encode_file( img, &b, &sz ) : -2;
+
+		if( r )
+		{
+			fail( "mt", "encoding failed for shape count", (int)( counts[i] ) );
+		}
+		else
+		{
+			same_as_serial( "mt", b, sz );
+
+			if( counts[i] < 100 )
+			{
+				truncated( "mt truncated", b, sz );
+			}
+
+			free( b );
+		}
+
+		if( img )
+		{
+			nsvgDelete( img );
+		}
+	}
+
+	/* Grid and float16 coordinates, points stored as steps, and aligned
+	 * host-order floats read the same on every thread */
+	for( i = 0; i < 4; ++i )
+	{
+		memset( &opts, 0, sizeof( opts ) );
+		opts.coords  = i == 0 ? PV_COORDS_GRID :
+					   i == 3 ? PV_COORDS_F32 : PV_COORDS_F16;
+		opts.quantum = i == 0 ? 1.0f / 16.0f : 0.0f;
+		opts.predict = i == 2;
+		opts.align   = i == 3;
+		opts.native  = i == 3;
+		img          = i >= 2 ? long_paths( 500 ) : test_image( 2000 );
+		r            = img ? encode_opts( img, &opts, &b, &sz ) : -2;
+
+		if( r )
+		{
+			fail( "mt coords", "encoding failed with", r );
+		}
+		else
+		{
+			same_as_serial( "mt coords", b, sz );
+			free( b );
+		}
+
+		if( img )
+		{
+			nsvgDelete( img );
+		}
+	}
+
+	/* Version 0x00 files have no offset table to split shapes with */
+	same_as_serial( "mt version 0x00", v0_pv, sizeof( v0_pv ) );
+	truncated( "mt version 0x00", v0_pv, sizeof( v0_pv ) );
+
+	return fails != 0;
+}
@@ -0,0 +1,296 @@
+#include "util.h"
+
+/* An SVG with every @ in it standing for a name nanoSVG knows, which makes
+ * a difference to the image there */
+struct use
+{
+	const char* name;
+	const char* svg;
+};
+
+#define RECT "<rect x=\"1\" y=\"2\" width=\"30\" height=\"40\" "
+#define STOPS                                       \
+	"<stop offset=\"0.2\" stop-color=\"#ff0000\"/>" \
+	"<stop offset=\"1\" stop-color=\"#0000ff\"/>"
+#define LINEAR "<defs><linearGradient id=\"g\" "
+#define RADIAL "<defs><radialGradient id=\"g\" "
+#define PAINTED "</defs>" RECT "fill=\"url(#g)\"/>"
+#define STROKED "stroke=\"#000000\"/>"
+#define SVG( s ) "<svg width=\"100\" height=\"100\">" s "</svg>"
+
+static const struct use uses[] = {
+	/* Elements, where unknown ones and their contents are ignored */
+	{ "svg", "<@ width=\"100\" height=\"50\">" RECT "/></@>" },
+	{ "g", SVG( "<@ fill=\"#ff0000\">" RECT "/></@>" RECT "/>" ) },
+	{ "defs", SVG( "<@>" RECT "/></@>" RECT "/>" ) },
+	{ "path", SVG( "<@ d=\"M1 2 L3 4 L5 1z\"/>" ) },
+	{ "rect", SVG( "<@ x=\"1\" y=\"2\" width=\"3\" height=\"4\"/>" ) },
+	{ "circle", SVG( "<@ cx=\"1\" cy=\"2\" r=\"3\"/>" ) },
+	{ "ellipse", SVG( "<@ cx=\"1\" cy=\"2\" rx=\"3\" ry=\"4\"/>" ) },
+	{ "line", SVG( "<@ x1=\"1\" y1=\"2\" x2=\"3\" y2=\"4\" " STROKED ) },
+	{ "polyline", SVG( "<@ points=\"1 2 3 4 5 1\" " STROKED ) },
+	{ "polygon", SVG( "<@ points=\"1 2 3 4 5 1\"/>" ) },
+	{ "linearGradient", SVG( "<defs><@ id=\"g\">" STOPS "</@>" PAINTED ) },
+	{ "radialGradient", SVG( "<defs><@ id=\"g\">" STOPS "</@>" PAINTED ) },
+	{ "stop", SVG( LINEAR "><@ offset=\"0.5\" stop-color=\"#00ff00\"/>" STOPS
+					   "</linearGradient>" PAINTED ) },
+
+	/* Presentation attributes, and some as style properties */
+	{ "style", SVG( RECT "@=\"fill:#ff0000\"/>" ) },
+	{ "display", SVG( RECT "@=\"none\"/>" RECT "/>" ) },
+	{ "fill", SVG( RECT "@=\"#00ff00\"/>" ) },
+	{ "opacity", SVG( RECT "@=\"0.5\"/>" ) },
+	{ "fill-opacity", SVG( RECT "@=\"0.5\"/>" ) },
+	{ "stroke", SVG( RECT "@=\"#0000ff\"/>" ) },
+	{ "stroke-width", SVG( RECT "@=\"3\" " STROKED ) },
+	{ "stroke-dasharray", SVG( RECT "@=\"2 1\" " STROKED ) },
+	{ "stroke-dashoffset",
+		SVG( RECT "stroke-dasharray=\"2 1\" @=\"1\" " STROKED ) },
+	{ "stroke-opacity", SVG( RECT "@=\"0.5\" " STROKED ) },
+	{ "stroke-linecap", SVG( RECT "@=\"round\" " STROKED ) },
+	{ "stroke-linejoin", SVG( RECT "@=\"round\" " STROKED ) },
+	{ "stroke-miterlimit", SVG( RECT "@=\"2\" " STROKED ) },
+	{ "fill-rule", SVG( RECT "@=\"evenodd\"/>" ) },
+	{ "font-size",
+		SVG( "<g @=\"20\"><rect width=\"2em\" height=\"1\"/></g>" ) },
+	{ "transform", SVG( RECT "@=\"translate(5 6)\"/>" ) },
+	{ "stroke-width", SVG( RECT "style=\"@:3\" " STROKED ) },
+	{ "fill-rule", SVG( RECT "style=\" @ : evenodd ;fill:#ff0000\"/>" ) },
+
+	/* Geometry */
+	{ "x", SVG( "<rect @=\"1\" y=\"2\" width=\"3\" height=\"4\"/>" ) },
+	{ "y", SVG( "<rect x=\"1\" @=\"2\" width=\"3\" height=\"4\"/>" ) },
+	{ "width", SVG( "<rect x=\"1\" y=\"2\" @=\"3\" height=\"4\"/>" ) },
+	{ "height", SVG( "<rect x=\"1\" y=\"2\" width=\"3\" @=\"4\"/>" ) },
+	{ "rx", SVG( RECT "@=\"3\"/>" ) },
+	{ "ry", SVG( RECT "@=\"3\"/>" ) },
+	{ "cx", SVG( "<circle @=\"1\" cy=\"2\" r=\"3\"/>" ) },
+	{ "cy", SVG( "<circle cx=\"1\" @=\"2\" r=\"3\"/>" ) },
+	{ "r", SVG( "<circle cx=\"1\" cy=\"2\" @=\"3\"/>" ) },
+	{ "rx", SVG( "<ellipse cx=\"1\" cy=\"2\" @=\"3\" ry=\"4\"/>" ) },
+	{ "ry", SVG( "<ellipse cx=\"1\" cy=\"2\" rx=\"3\" @=\"4\"/>" ) },
+	{ "x1", SVG( "<line @=\"1\" y1=\"2\" x2=\"3\" y2=\"4\" " STROKED ) },
+	{ "y1", SVG( "<line x1=\"1\" @=\"2\" x2=\"3\" y2=\"4\" " STROKED ) },
+	{ "x2", SVG( "<line x1=\"1\" y1=\"2\" @=\"3\" y2=\"4\" " STROKED ) },
+	{ "y2", SVG( "<line x1=\"1\" y1=\"2\" x2=\"3\" @=\"4\" " STROKED ) },
+	{ "points", SVG( "<polygon @=\"1 2 3 4 5 1\"/>" ) },
+	{ "d", SVG( "<path @=\"M1 2 L3 4 L5 1z\"/>" ) },
+
+	/* The canvas */
+	{ "width", "<svg @=\"100\" height=\"50\">" RECT "/></svg>" },
+	{ "height", "<svg width=\"100\" @=\"50\">" RECT "/></svg>" },
+	{ "viewBox",
+		"<svg width=\"100\" height=\"100\" @=\"0 0 50 50\">" RECT "/></svg>" },
+	{ "preserveAspectRatio",
+		"<svg width=\"100\" height=\"100\" viewBox=\"0 0 50 100\" "
+		"@=\"xMaxYMax\">" RECT "/></svg>" },
+
+	/* Gradients and their stops */
+	{ "id", SVG( "<defs><linearGradient @=\"g\">" STOPS
+				 "</linearGradient>" PAINTED ) },
+	{ "x1", SVG( LINEAR "@=\"0.5\">" STOPS "</linearGradient>" PAINTED ) },
+	{ "y1", SVG( LINEAR "@=\"0.5\">" STOPS "</linearGradient>" PAINTED ) },
+	{ "x2", SVG( LINEAR "@=\"0.5\">" STOPS "</linearGradient>" PAINTED ) },
+	{ "y2", SVG( LINEAR "@=\"0.5\">" STOPS "</linearGradient>" PAINTED ) },
+	{ "gradientUnits", SVG( LINEAR "@=\"userSpaceOnUse\">" STOPS
+							"</linearGradient>" PAINTED ) },
+	{ "gradientTransform",
+		SVG( LINEAR "@=\"scale(2)\">" STOPS "</linearGradient>" PAINTED ) },
+	{ "spreadMethod",
+		SVG( LINEAR "@=\"reflect\">" STOPS "</linearGradient>" PAINTED ) },
+	{ "xlink:href",
+		SVG( "<defs><linearGradient id=\"a\">" STOPS "</linearGradient>"
+			 "<linearGradient id=\"g\" @=\"#a\" x2=\"0.5\"/>" PAINTED ) },
+	{ "cx", SVG( RADIAL "@=\"0.3\">" STOPS "</radialGradient>" PAINTED ) },
+	{ "cy", SVG( RADIAL "@=\"0.3\">" STOPS "</radialGradient>" PAINTED ) },
+	{ "r", SVG( RADIAL "@=\"0.3\">" STOPS "</radialGradient>" PAINTED ) },
+	{ "fx", SVG( RADIAL "@=\"0.3\">" STOPS "</radialGradient>" PAINTED ) },
+	{ "fy", SVG( RADIAL "@=\"0.3\">" STOPS "</radialGradient>" PAINTED ) },
+	{ "offset", SVG( LINEAR "><stop @=\"0.5\" stop-color=\"#00ff00\"/>" STOPS
+						 "</linearGradient>" PAINTED ) },
+	{ "stop-color", SVG( LINEAR "><stop offset=\"0.5\" @=\"#00ff00\"/>" STOPS
+							 "</linearGradient>" PAINTED ) },
+	{ "stop-opacity", SVG( LINEAR "><stop offset=\"0.5\" @=\"0.5\"/>" STOPS
+							   "</linearGradient>" PAINTED ) },
+	{ "stop-color", SVG( LINEAR "><stop offset=\"0.5\" style=\"@:#00ff00\"/>"
+							 STOPS "</linearGradient>" PAINTED ) }
+};
+
+#define USES_CT ( sizeof( uses ) / sizeof( uses[0] ) )
+
+/* Is NAME one of those used above? */
+static int is_known( const char* name )
+{
+	unsigned i;
+
+	for( i = 0; i < USES_CT; ++i )
+	{
+		if( !strcmp( uses[i].name, name ) )
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* Names one edit away from NAME */
+static unsigned near_misses( const char* name, char out[][64] )
+{
+	size_t n;
+	unsigned ct = 0;
+
+	n = strlen( name );
+
+	/* Another case for the first letter */
+	strcpy( out[ct], name );
+	out[ct][0] = (char)( out[ct][0] ^ 0x20 );
+	ct++;
+
+	/* One letter more, at the end and at the start */
+	sprintf( out[ct++], "%sx", name );
+	sprintf( out[ct++], "s%s", name );
+
+	/* One less, at the end and at the start, or the hyphen */
+	if( n > 1 )
+	{
+		strcpy( out[ct], name );
+		out[ct++][n - 1] = '\0';
+		strcpy( out[ct++], name + 1 );
+	}
+
+	if( strchr( name, '-' ) )
+	{
+		strcpy( out[ct], name );
+		memmove( strchr( out[ct], '-' ), strchr( name, '-' ) + 1,
+			strlen( strchr( name, '-' ) ) );
+		ct++;
+	}
+
+	return ct;
+}
+
+/* The PV encoding of what nanoSVG parses from SVG, with every @ in it made
+ * NAME, into *B, followed by the colours of its shapes, whose opacity the
+ * format leaves out; a quiet way to tell images apart */
+static int parse_as( const char* svg, const char* name, unsigned char** b,
+	size_t* sz )
+{
+	struct NSVGimage* img;
+	struct NSVGshape* sh;
+	struct text t = { NULL, 0, 0 };
+	char c[2] = { 0, 0 };
+	unsigned char* more;
+	int r;
+
+	for( ; *svg; ++svg )
+	{
+		c[0] = *svg;
+		put( &t, *svg == '@' ? name : c );
+	}
+
+	img = nsvgParse( t.b, "px", 96.0f );
+	r   = img ? encode_opts( img, NULL, b, sz ) : -2;
+
+	for( sh = r ? NULL : img->shapes; sh; sh = sh->next )
+	{
+		more = realloc( *b, *sz + 8 );
+
+		if( !more )
+		{
+			r = -2;
+			break;
+		}
+
+		*b = more;
+		memset( *b + *sz, 0, 8 );
+
+		if( sh->fill.type == NSVG_PAINT_COLOR )
+		{
+			memcpy( *b + *sz, &( sh->fill.color ), 4 );
+		}
+
+		if( sh->stroke.type == NSVG_PAINT_COLOR )
+		{
+			memcpy( *b + *sz + 4, &( sh->stroke.color ), 4 );
+		}
+
+		*sz += 8;
+	}
+
+	if( img )
+	{
+		nsvgDelete( img );
+	}
+
+	free( t.b );
+
+	return r;
+}
+
+/* Each name makes its difference where it is used, and no near miss of it
+ * makes any */
+static void known( const struct use* u )
+{
+	char miss[8][64];
+	unsigned char *want, *none, *got;
+	size_t want_sz, none_sz, got_sz;
+	unsigned ct, i;
+	int r;
+
+	want = NULL;
+	none = NULL;
+	r    = parse_as( u->svg, u->name, &want, &want_sz );
+	r    = r ? r : parse_as( u->svg, "zz", &none, &none_sz );
+
+	if( r )
+	{
+		fail( u->name, "encoding failed with", r );
+	}
+	else if( want_sz == none_sz && !memcmp( want, none, want_sz ) )
+	{
+		fprintf( stderr, "names: %s made no difference in %s\n", u->name,
+			u->svg );
+		fails++;
+	}
+
+	for( i = 0, ct = near_misses( u->name, miss ); !r && i < ct; ++i )
+	{
+		/* "rx" less its first letter is "x", which is no miss */
+		if( is_known( miss[i] ) )
+		{
+			continue;
+		}
+
+		got = NULL;
+		r   = parse_as( u->svg, miss[i], &got, &got_sz );
+
+		if( r )
+		{
+			fail( miss[i], "encoding failed with", r );
+		}
+		else if( got_sz != none_sz || memcmp( got, none, none_sz ) )
+		{
+			fprintf( stderr, "names: %s was taken for %s in %s\n", miss[i],
+				u->name, u->svg );
+			fails++;
+		}
+
+		free( got );
+	}
+
+	free( want );
+	free( none );
+}
+
+int main( void )
+{
+	unsigned i;
+
+	for( i = 0; i < USES_CT; ++i )
+	{
+		known( uses + i );
+	}
+
+	return fails != 0;
+}
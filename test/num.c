@@ -0,0 +1,170 @@
+/* strtof is C99, not C89 */
+#define _ISOC99_SOURCE
+
+#include "util.h"
+
+#include <float.h>
+#include <math.h>
+
+static unsigned long seed = 1;
+
+static unsigned rnd( unsigned n )
+{
+	seed = seed * 1103515245UL + 12345UL;
+
+	return (unsigned)( ( seed >> 16 ) % n );
+}
+
+/* Numbers to a path */
+#define PATH_NUMS 2000
+
+/* A decimal at S, as SVG writes it: with or without a sign, integer part,
+ * fraction or exponent, up to 45 digits long, and in float's range */
+static void decimal( char* s )
+{
+	char* p;
+	unsigned i, n;
+	double d;
+
+	do
+	{
+		p = s;
+		n = rnd( 3 );
+		p += sprintf( p, "%s", n == 0 ? "" : n == 1 ? "-" : "+" );
+
+		for( i = 0, n = rnd( 4 ) ? rnd( 8 ) : rnd( 25 ); i < n; ++i )
+		{
+			*p++ = (char)( '0' + rnd( 10 ) );
+		}
+
+		if( rnd( 4 ) || !n )
+		{
+			*p++ = '.';
+
+			for( i = 0, n = n && rnd( 2 ) ? rnd( 8 ) : 1 + rnd( 20 ); i < n;
+				 ++i )
+			{
+				*p++ = (char)( '0' + rnd( 10 ) );
+			}
+		}
+
+		if( !rnd( 3 ) )
+		{
+			p += sprintf( p, "%s%s%u", rnd( 2 ) ? "e" : "E",
+				rnd( 2 ) ? "-" : rnd( 2 ) ? "+" : "", rnd( 50 ) );
+		}
+
+		*p = '\0';
+		d  = fabs( atof( s ) );
+	} while( d > FLT_MAX || ( d > 0.0 && d < 1e-44 ) );
+}
+
+/* A float, halfway between it and the next, or just either side of that,
+ * written out exactly with up to 80 digits */
+static void midpoint( char* s )
+{
+	unsigned bits;
+	float f, g;
+	double m;
+	char* e;
+
+	bits = ( ( rnd( 0x10000 ) << 16 ) | rnd( 0x10000 ) ) & 0x7FFFFFFF;
+	bits = 0x33000000 + bits % ( 0x4B000000 - 0x33000000 );
+	memcpy( &f, &bits, 4 );
+	bits++;
+	memcpy( &g, &bits, 4 );
+	m = ( (double)( f ) + (double)( g ) ) / 2.0;
+	sprintf( s, "%.70e", m );
+
+	/* One more digit puts it above the midpoint, one less below */
+	e = strchr( s, 'e' );
+
+	switch( rnd( 3 ) )
+	{
+	case 0:
+		memmove( e + 1, e, strlen( e ) + 1 );
+		*e = '1';
+		break;
+	case 1:
+		while( e[-1] == '0' )
+		{
+			--e;
+		}
+
+		if( e[-1] != '.' )
+		{
+			e[-1] = (char)( e[-1] - 1 );
+			memmove( e + 2, e, strlen( e ) + 1 );
+			e[0] = '9';
+			e[1] = '9';
+		}
+
+		break;
+	}
+}
+
+/* A path of PATH_NUMS of the numbers from GEN reads as strtof reads each
+ * of them, in an image whose view leaves coordinates as they are */
+static void same_as_strtof( const char* what, void ( *gen )( char* ) )
+{
+	static char nums[PATH_NUMS][128];
+	struct text t = { NULL, 0, 0 };
+	struct NSVGimage* img;
+	struct NSVGpath* p;
+	float want, got;
+	unsigned i;
+
+	put( &t, "<svg width=\"100\" height=\"100\" viewBox=\"0 0 100 100\">"
+		"<path d=\"" );
+
+	for( i = 0; i < PATH_NUMS; ++i )
+	{
+		gen( nums[i] );
+		put( &t, i == 0 ? "M" : i % 2 ? " " : " L" );
+		put( &t, nums[i] );
+	}
+
+	put( &t, "\"/></svg>" );
+	img = nsvgParse( t.b, "px", 96.0f );
+	p   = img && img->shapes ? img->shapes->paths : NULL;
+
+	if( !p || p->npts != ( PATH_NUMS / 2 - 1 ) * 3 + 1 )
+	{
+		fail( what, "points missing from a path of", PATH_NUMS );
+	}
+
+	for( i = 0; p && i < PATH_NUMS; ++i )
+	{
+		want = strtof( nums[i], NULL );
+		got  = p->pts[( i / 2 ) * 6 + i % 2];
+
+		/* The view transform adds zero, which takes the sign off -0 */
+		if( memcmp( &got, &want, 4 ) && !( got == 0.0f && want == 0.0f ) )
+		{
+			fprintf( stderr, "%s: %s read as %.9g, not %.9g\n", what, nums[i],
+				got, want );
+			fails++;
+			break;
+		}
+	}
+
+	if( img )
+	{
+		nsvgDelete( img );
+	}
+
+	free( t.b );
+}
+
+int main( void )
+{
+	unsigned i;
+
+	for( i = 0; i < 200 && !fails; ++i )
+	{
+		same_as_strtof( "num decimals", decimal );
+		same_as_strtof( "num midpoints", midpoint );
+	}
+
+	return fails != 0;
+}
@@ -0,0 +1,1301 @@
+#include "util.h"
+
+/* Decode B through a file with pv_fpv2nsvg */
+static int decode_file(
+	const unsigned char* b, size_t sz, struct NSVGimage* img )
+{
+	FILE* f;
+	int r;
+
+	f = tmpfile( );
+
+	if( !f )
+	{
+		return -1;
+	}
+
+	r = fwrite( b, 1, sz, f ) == sz ? pv_fpv2nsvg( f, img ) : -1;
+	fclose( f );
+
+	return r;
+}
+
+/* Look up gradient ID through view V as a paint of its own */
+static int view_paint( struct pv_view* v, unsigned id, struct NSVGpaint* p )
+{
+	struct pv_vgradient g;
+	int r;
+
+	r = pv_view_gradient( v, id, &g );
+
+	if( r )
+	{
+		return r;
+	}
+
+	p->type     = g.type;
+	p->gradient = malloc( sizeof( struct NSVGgradient ) +
+		sizeof( struct NSVGgradientStop ) * g.stops_ct );
+
+	if( !p->gradient )
+	{
+		p->type = NSVG_PAINT_NONE;
+
+		return -2;
+	}
+
+	memcpy( p->gradient->xform, g.xform, sizeof( float ) * 6 );
+	p->gradient->fx     = g.fx;
+	p->gradient->fy     = g.fy;
+	p->gradient->spread = g.spread;
+	p->gradient->nstops = g.stops_ct;
+	pv_view_gradient_stops( &g, p->gradient->stops );
+
+	return 0;
+}
+
+/* Build an image through the view API, visiting shapes and paths last to
+ * first so every lookup has to go back to an earlier record */
+static int view_image(
+	const unsigned char* b, size_t sz, struct NSVGimage* img )
+{
+	struct pv_view v;
+	struct pv_vshape vs;
+	struct pv_vpath vp;
+	struct NSVGshape* sh;
+	struct NSVGpath* p;
+	unsigned i, j;
+	int r;
+
+	r = pv_view_init( b, sz, &v );
+
+	if( r )
+	{
+		return r;
+	}
+
+	img->width  = v.width;
+	img->height = v.height;
+
+	for( i = v.shape_ct; i-- > 0; )
+	{
+		r = pv_view_shape( &v, i, &vs );
+
+		if( r )
+		{
+			return r;
+		}
+
+		sh = calloc( 1, sizeof( struct NSVGshape ) );
+
+		if( !sh )
+		{
+			return -2;
+		}
+
+		sh->next    = img->shapes;
+		img->shapes = sh;
+
+		sh->fill.type    = NSVG_PAINT_NONE;
+		sh->fill.color   = vs.fill;
+		sh->stroke.type  = NSVG_PAINT_NONE;
+		sh->stroke.color = vs.stroke;
+
+		if( vs.opts & PV_SHAPE_FILL )
+		{
+			sh->fill.type = NSVG_PAINT_COLOR;
+		}
+
+		if( vs.opts & PV_SHAPE_STROKE )
+		{
+			sh->stroke.type = NSVG_PAINT_COLOR;
+		}
+
+		if( ( vs.opts & PV_SHAPE_FILL ) && ( vs.opts & PV_SHAPE_FILL_GRADIENT ) )
+		{
+			r = view_paint( &v, vs.fill, &( sh->fill ) );
+		}
+
+		if( !r && ( vs.opts & PV_SHAPE_STROKE ) &&
+			( vs.opts & PV_SHAPE_STROKE_GRADIENT ) )
+		{
+			r = view_paint( &v, vs.stroke, &( sh->stroke ) );
+		}
+
+		if( r )
+		{
+			return r;
+		}
+
+		sh->opacity          = vs.opacity;
+		sh->strokeWidth      = vs.stroke_w;
+		sh->strokeDashOffset = vs.dash_offs;
+		sh->strokeDashCount  = vs.dash_ct;
+		sh->strokeLineJoin   = vs.join;
+		sh->strokeLineCap    = vs.cap;
+		sh->miterLimit       = vs.miter;
+		sh->fillRule         = ( vs.opts & PV_SHAPE_EVENODD ) ? 1 : 0;
+		sh->flags = ( vs.opts & PV_SHAPE_VISIBLE ) ? NSVG_FLAGS_VISIBLE : 0;
+		memcpy( sh->strokeDashArray, vs.dashes, sizeof( float ) * vs.dash_ct );
+		memcpy( sh->bounds, vs.bounds, sizeof( float ) * 4 );
+
+		for( j = vs.path_ct; j-- > 0; )
+		{
+			r = pv_view_path( &v, &vs, j, &vp );
+
+			if( r )
+			{
+				return r;
+			}
+
+			p = calloc( 1, sizeof( struct NSVGpath ) );
+
+			if( !p )
+			{
+				return -2;
+			}
+
+			p->next   = sh->paths;
+			sh->paths = p;
+			p->pts    = malloc( sizeof( float ) * 2 * ( vp.npts + 1 ) );
+
+			if( !p->pts )
+			{
+				return -2;
+			}
+
+			p->npts   = vp.npts;
+			p->closed = vp.closed;
+			memcpy( p->bounds, vp.bounds, sizeof( float ) * 4 );
+			pv_view_path_pts( &vp, p->pts );
+		}
+	}
+
+	return 0;
+}
+
+/* The segments stored for every path of B are the ones its points expand
+ * from, with the same end points; returns how many are lines */
+static int segments( const char* what, const unsigned char* b, size_t sz )
+{
+	struct pv_view v;
+	struct pv_vshape vs;
+	struct pv_vpath vp;
+	unsigned char* t;
+	float *pts, *o;
+	unsigned i, j, k, m, segs;
+	int lines, r;
+
+	lines = 0;
+	r     = pv_view_init( b, sz, &v );
+
+	for( i = 0; !r && i < v.shape_ct; ++i )
+	{
+		r = pv_view_shape( &v, i, &vs );
+
+		for( j = 0; !r && j < vs.path_ct; ++j )
+		{
+			r = pv_view_path( &v, &vs, j, &vp );
+
+			if( r )
+			{
+				break;
+			}
+
+			segs = vp.npts > 0 ? ( vp.npts - 1 ) / 3 : 0;
+			pts  = malloc( sizeof( float ) * 2 * ( vp.npts + 1 ) );
+			o    = malloc( sizeof( float ) * 2 * ( vp.pts_ct + 1 ) );
+			t    = malloc( segs + 1 );
+
+			if( !pts || !o || !t )
+			{
+				r = -2;
+			}
+			else
+			{
+				pv_view_path_pts( &vp, pts );
+				pv_view_path_segs( &vp, t, o );
+			}
+
+			/* M counts the stored points gone by */
+			for( k = 0, m = 1; !r && k < segs; ++k )
+			{
+				if( t[k] == PV_SEG_LINE )
+				{
+					lines++;
+					r = m >= vp.pts_ct ||
+						memcmp( o + m * 2, pts + ( k * 3 + 3 ) * 2,
+							sizeof( float ) * 2 ) != 0;
+					m += 1;
+				}
+				else
+				{
+					r = m + 3 > vp.pts_ct ||
+						memcmp( o + m * 2, pts + ( k * 3 + 1 ) * 2,
+							sizeof( float ) * 6 ) != 0;
+					m += 3;
+				}
+			}
+
+			if( !r &&
+				( m != vp.pts_ct || memcmp( o, pts, sizeof( float ) * 2 ) ) )
+			{
+				r = 1;
+			}
+
+			free( pts );
+			free( o );
+			free( t );
+		}
+	}
+
+	if( r )
+	{
+		fail( what, "segments do not match the points, shape", (int)( i ) );
+	}
+
+	return lines;
+}
+
+/* Decode B every way there is, and compare with REF, which B was encoded
+ * from, and with each other */
+static void decode_all( const char* what, const unsigned char* b, size_t sz,
+	const struct NSVGimage* ref, float tol )
+{
+	struct NSVGimage *out, *out2, *out3, *out4;
+	int r;
+
+	out  = calloc( 1, sizeof( struct NSVGimage ) );
+	out2 = calloc( 1, sizeof( struct NSVGimage ) );
+	out3 = calloc( 1, sizeof( struct NSVGimage ) );
+	out4 = calloc( 1, sizeof( struct NSVGimage ) );
+
+	if( !out || !out2 || !out3 || !out4 )
+	{
+		fail( what, "out of memory", 0 );
+	}
+	else if( ( r = pv_pv2nsvg( (void*)( b ), sz, out ) ) != 0 )
+	{
+		fail( what, "pv_pv2nsvg failed with", r );
+	}
+	else if( ( r = decode_file( b, sz, out2 ) ) != 0 )
+	{
+		fail( what, "pv_fpv2nsvg failed with", r );
+	}
+	else if( ( r = view_image( b, sz, out3 ) ) != 0 )
+	{
+		fail( what, "the view API failed with", r );
+	}
+	else if( ( r = pv_pv2nsvg_arena( (void*)( b ), sz, out4 ) ) != 0 )
+	{
+		fail( what, "pv_pv2nsvg_arena failed with", r );
+	}
+	else if( !same_image( what, ref, out, tol ) ||
+		!same_image( what, out, out2, 0.0f ) ||
+		!same_image( what, out, out3, 0.0f ) ||
+		!same_image( what, out, out4, 0.0f ) )
+	{
+		fprintf( stderr, "%s: decoded images differ\n", what );
+	}
+
+	if( out )
+	{
+		nsvgDelete( out );
+	}
+
+	if( out2 )
+	{
+		nsvgDelete( out2 );
+	}
+
+	if( out3 )
+	{
+		nsvgDelete( out3 );
+	}
+
+	if( out4 )
+	{
+		pv_nsvg_delete( out4 );
+	}
+}
+
+/* Every prefix of B is refused: as too short for a header, or as truncated */
+static void truncated( const char* what, const unsigned char* b, size_t sz )
+{
+	struct NSVGimage* out;
+	unsigned char* cut;
+	size_t k;
+	int r, want;
+
+	for( k = 0; k < sz; ++k )
+	{
+		/* Exactly K bytes, so reading past them is caught under ASan */
+		cut = malloc( k ? k : 1 );
+		out = calloc( 1, sizeof( struct NSVGimage ) );
+
+		if( !cut || !out )
+		{
+			fail( what, "out of memory at", (int)( k ) );
+			free( cut );
+			free( out );
+			break;
+		}
+
+		memcpy( cut, b, k );
+		want = k < 0x16 ? -1 : -3;
+		r    = pv_pv2nsvg( cut, k, out );
+
+		if( r != want )
+		{
+			fail( what, "wrong result for length", (int)( k ) );
+		}
+
+		nsvgDelete( out );
+		out = calloc( 1, sizeof( struct NSVGimage ) );
+		r   = out ? view_image( cut, k, out ) : -2;
+
+		if( r != want )
+		{
+			fail( what, "wrong view result for length", (int)( k ) );
+		}
+
+		if( out )
+		{
+			nsvgDelete( out );
+		}
+
+		out = calloc( 1, sizeof( struct NSVGimage ) );
+		r   = out ? pv_pv2nsvg_arena( cut, k, out ) : -2;
+
+		if( r != want )
+		{
+			fail( what, "wrong arena result for length", (int)( k ) );
+		}
+
+		pv_nsvg_delete( out );
+		free( cut );
+	}
+}
+
+/* Shapes painted with the same gradient share one gradient record */
+static void shared_gradients( void )
+{
+	static const char* rect =
+		"<rect x=\"%u\" y=\"5\" width=\"9\" height=\"9\" fill=\"url(#u)\" "
+		"stroke=\"url(#u)\"/>";
+	struct NSVGimage* img;
+	struct pv_view v;
+	struct text t = { NULL, 0, 0 };
+	unsigned char* b;
+	char s[256];
+	size_t sz;
+	unsigned i;
+	int r;
+
+	put( &t, "<svg width=\"200\" height=\"20\"><defs>"
+		"<linearGradient id=\"u\" gradientUnits=\"userSpaceOnUse\" "
+		"x2=\"200\"><stop offset=\"0\" stop-color=\"#ff0000\"/>"
+		"<stop offset=\"1\" stop-color=\"#0000ff\"/></linearGradient></defs>" );
+
+	for( i = 0; i < 10; ++i )
+	{
+		sprintf( s, rect, i * 20 );
+		put( &t, s );
+	}
+
+	put( &t, "</svg>" );
+	img = nsvgParse( t.b, "px", 96.0f );
+	free( t.b );
+	r = img ? encode_opts( img, NULL, &b, &sz ) : -2;
+
+	if( r )
+	{
+		fail( "shared gradients", "encoding failed with", r );
+	}
+	else
+	{
+		r = pv_view_init( b, sz, &v );
+
+		if( r || v.grads_ct != 1 )
+		{
+			fail( "shared gradients", "wrong gradient count",
+				r ? -1 : (int)( v.grads_ct ) );
+		}
+
+		decode_all( "shared gradients", b, sz, img, 1e-6f );
+		free( b );
+	}
+
+	if( img )
+	{
+		nsvgDelete( img );
+	}
+}
+
+/* N rects in C colours, which the palette holds WANT of; their miter limits
+ * all differ, so a style table would not pay */
+static void palette( unsigned c, unsigned n, unsigned want )
+{
+	struct NSVGimage* img;
+	struct pv_view v;
+	struct text t = { NULL, 0, 0 };
+	unsigned char* b;
+	char s[128];
+	size_t sz;
+	unsigned i;
+	int r;
+
+	put( &t, "<svg width=\"1000\" height=\"1000\">" );
+
+	for( i = 0; i < n; ++i )
+	{
+		sprintf( s,
+			"<rect x=\"%u\" y=\"%u\" width=\"9\" height=\"9\" "
+			"fill=\"#%06x\" stroke-miterlimit=\"%u\"/>",
+			i % 990, i / 990 % 990, i % c * 0x9E3779u & 0xFFFFFFu,
+			i % 2000 + 1 );
+		put( &t, s );
+	}
+
+	put( &t, "</svg>" );
+	img = nsvgParse( t.b, "px", 96.0f );
+	free( t.b );
+	r = img ? encode_opts( img, NULL, &b, &sz ) : -2;
+
+	if( r )
+	{
+		fail( "palette", "encoding failed with", r );
+	}
+	else
+	{
+		r = pv_view_init( b, sz, &v );
+
+		if( r || v.pal_ct != want )
+		{
+			fail( "palette", "wrong colour count", r ? -1 : (int)( v.pal_ct ) );
+		}
+
+		decode_all( "palette", b, sz, img, 1e-6f );
+		free( b );
+	}
+
+	if( img )
+	{
+		nsvgDelete( img );
+	}
+}
+
+static int same_style( const struct pv_vshape* a, const struct pv_vshape* b )
+{
+	int i;
+
+	if( a->opts != b->opts || a->fill != b->fill || a->stroke != b->stroke ||
+		a->opacity != b->opacity || a->stroke_w != b->stroke_w ||
+		a->dash_offs != b->dash_offs || a->dash_ct != b->dash_ct ||
+		a->join != b->join || a->cap != b->cap || a->miter != b->miter )
+	{
+		return 0;
+	}
+
+	for( i = 0; i < a->dash_ct; ++i )
+	{
+		if( a->dashes[i] != b->dashes[i] )
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* N shapes in 20 styles share a style table, and shapes with the same style
+ * index read back the same style fields */
+static void styles( unsigned n )
+{
+	static const char* colours[] = { "#ff0000", "#00ff00", "#0000ff",
+		"#808080", "#000000" };
+	struct NSVGimage* img;
+	struct pv_view v;
+	struct pv_vshape vs, first[20];
+	struct text t = { NULL, 0, 0 };
+	unsigned char* b;
+	char s[256];
+	size_t sz;
+	unsigned i;
+	int r;
+
+	put( &t, "<svg width=\"1000\" height=\"1000\">" );
+
+	for( i = 0; i < n; ++i )
+	{
+		sprintf( s,
+			"<path fill=\"%s\" stroke=\"#202020\" stroke-width=\"%u\" "
+			"d=\"M%u,%u l9,0 0,9 -9,0z\"/>",
+			colours[i % 5], i / 5 % 4 + 1, i % 990, i / 990 % 990 );
+		put( &t, s );
+	}
+
+	put( &t, "</svg>" );
+	img = nsvgParse( t.b, "px", 96.0f );
+	free( t.b );
+	r = img ? encode_opts( img, NULL, &b, &sz ) : -2;
+
+	if( r )
+	{
+		fail( "styles", "encoding failed with", r );
+	}
+	else
+	{
+		r = pv_view_init( b, sz, &v );
+
+		if( r || v.style_ct != 20 )
+		{
+			fail( "styles", "wrong style count", r ? -1 : (int)( v.style_ct ) );
+		}
+
+		memset( first, 0, sizeof( first ) );
+
+		for( i = 0; !r && i < v.shape_ct; ++i )
+		{
+			r = pv_view_shape( &v, i, &vs );
+
+			if( r || vs.style >= 20 )
+			{
+				fail( "styles", "bad style index in shape", (int)( i ) );
+				break;
+			}
+
+			if( !first[vs.style].path_ct )
+			{
+				first[vs.style] = vs;
+			}
+			else if( !same_style( &( first[vs.style] ), &vs ) )
+			{
+				fail( "styles", "style fields differ in shape", (int)( i ) );
+			}
+		}
+
+		decode_all( "styles", b, sz, img, 1e-6f );
+
+		if( n < 100 )
+		{
+			truncated( "styles", b, sz );
+		}
+
+		free( b );
+	}
+
+	if( img )
+	{
+		nsvgDelete( img );
+	}
+}
+
+/* Encode the test images with OPTS, with coordinates coming back within SLACK
+ * of where they were, and decode and truncate them */
+static void with_opts( const char* what, const struct pv_opts* opts,
+	float slack )
+{
+	struct NSVGimage* img;
+	unsigned char* b;
+	size_t sz;
+	int r;
+
+	img = test_image( 200 );
+	r   = img ? encode_opts( img, opts, &b, &sz ) : -2;
+
+	if( r )
+	{
+		fail( what, "encoding failed with", r );
+	}
+	else
+	{
+		grid_tol = slack;
+		decode_all( what, b, sz, img, 1e-6f );
+		grid_tol = 0.0f;
+		free( b );
+	}
+
+	if( img )
+	{
+		nsvgDelete( img );
+	}
+
+	img = test_image( 12 );
+	r   = img ? encode_opts( img, opts, &b, &sz ) : -2;
+
+	if( r )
+	{
+		fail( what, "encoding failed with", r );
+	}
+	else
+	{
+		truncated( what, b, sz );
+		free( b );
+	}
+
+	if( img )
+	{
+		nsvgDelete( img );
+	}
+}
+
+/* Options that cannot be met are refused before anything is written */
+static void bad_opts( void )
+{
+	static char svg[] = "<svg width=\"10\" height=\"10\">"
+						"<path d=\"M0,0 L2e9,0 L0,5z\"/></svg>";
+	struct NSVGimage* img;
+	struct pv_opts opts;
+	size_t sz;
+	int r;
+
+	img = nsvgParse( svg, "px", 96.0f );
+
+	if( !img )
+	{
+		fail( "bad options", "cannot parse the test image", 0 );
+
+		return;
+	}
+
+	memset( &opts, 0, sizeof( opts ) );
+	opts.coords = 99;
+
+	if( ( r = pv_nsvg2pv_opts( img, &opts, NULL, &sz ) ) != -1 )
+	{
+		fail( "bad options", "unknown coordinates gave", r );
+	}
+
+	opts.coords  = PV_COORDS_GRID;
+	opts.quantum = 0.0f;
+
+	if( ( r = pv_nsvg2pv_opts( img, &opts, NULL, &sz ) ) != -1 )
+	{
+		fail( "bad options", "a zero grid step gave", r );
+	}
+
+	/* 2e9 is past 2^30 steps of 1 */
+	opts.quantum = 1.0f;
+
+	if( ( r = pv_nsvg2pv_opts( img, &opts, NULL, &sz ) ) != -6 )
+	{
+		fail( "bad options", "a coordinate off the grid gave", r );
+	}
+
+	/* and past the largest float16 */
+	opts.coords = PV_COORDS_F16;
+
+	if( ( r = pv_nsvg2pv_opts( img, &opts, NULL, &sz ) ) != -6 )
+	{
+		fail( "bad options", "a coordinate too big for float16 gave", r );
+	}
+
+	/* Grid points are steps already */
+	opts.coords  = PV_COORDS_GRID;
+	opts.quantum = 1.0f;
+	opts.predict = 1;
+
+	if( ( r = pv_nsvg2pv_opts( img, &opts, NULL, &sz ) ) != -1 )
+	{
+		fail( "bad options", "steps on a grid gave", r );
+	}
+
+	/* Nor do aligned or host-order floats, and steps stay big-endian */
+	opts.predict = 0;
+	opts.align   = 1;
+
+	if( ( r = pv_nsvg2pv_opts( img, &opts, NULL, &sz ) ) != -1 )
+	{
+		fail( "bad options", "aligning a grid gave", r );
+	}
+
+	opts.align  = 0;
+	opts.native = 1;
+
+	if( ( r = pv_nsvg2pv_opts( img, &opts, NULL, &sz ) ) != -1 )
+	{
+		fail( "bad options", "a grid in host order gave", r );
+	}
+
+	opts.coords  = PV_COORDS_F32;
+	opts.quantum = 0.0f;
+	opts.predict = 1;
+
+	if( ( r = pv_nsvg2pv_opts( img, &opts, NULL, &sz ) ) != -1 )
+	{
+		fail( "bad options", "steps in host order gave", r );
+	}
+
+	nsvgDelete( img );
+}
+
+/* Bytes in memory, read front to back through a pv_read_fn */
+struct src
+{
+	const unsigned char* b;
+	size_t n, i;
+};
+
+static int from_src( void* ctx, void* b, size_t n )
+{
+	struct src* s = ctx;
+
+	if( s->n - s->i < n )
+	{
+		return 1;
+	}
+
+	memcpy( b, s->b + s->i, n );
+	s->i += n;
+
+	return 0;
+}
+
+/* Decode compressed B through every decoder that takes it, each of which
+ * has to give REF exactly */
+static void unpack_all( const char* what, const unsigned char* b, size_t sz,
+	const struct NSVGimage* ref )
+{
+	static const float everything[4] = { -1e6f, -1e6f, 1e6f, 1e6f };
+	static const char* how[] = {
+		"pv_pv2nsvg", "pv_fpv2nsvg", "pv_pv2nsvg_cb", "pv_pv2nsvg_cull",
+		"pv_pv2nsvg_mt", "pv_pv2nsvg_arena"
+	};
+	struct NSVGimage* out;
+	struct pv_view v;
+	struct src in;
+	int i, r;
+
+	for( i = 0; i < 6; ++i )
+	{
+		in.b = b;
+		in.n = sz;
+		in.i = 0;
+		out  = calloc( 1, sizeof( struct NSVGimage ) );
+		r    = !out                 ? -2 :
+			   i == 0               ? pv_pv2nsvg( (void*)( b ), sz, out ) :
+			   i == 1               ? decode_file( b, sz, out ) :
+			   i == 2               ? pv_pv2nsvg_cb( from_src, &in, out ) :
+			   i == 3 ? pv_pv2nsvg_cull( (void*)( b ), sz, out, everything, 1 ) :
+			   i == 4 ? pv_pv2nsvg_mt( (void*)( b ), sz, out, 3 ) :
+						pv_pv2nsvg_arena( (void*)( b ), sz, out );
+
+		if( r )
+		{
+			fprintf( stderr, "%s: %s failed with %d\n", what, how[i], r );
+			fails++;
+		}
+		else if( !same_image( what, ref, out, 0.0f ) )
+		{
+			fprintf( stderr, "%s: %s decodes differently\n", what, how[i] );
+		}
+
+		if( out && i == 5 )
+		{
+			pv_nsvg_delete( out );
+		}
+		else if( out )
+		{
+			nsvgDelete( out );
+		}
+	}
+
+	if( pv_view_init( b, sz, &v ) == 0 )
+	{
+		fail( what, "the view API took a compressed buffer", 0 );
+	}
+}
+
+/* A compressed file of N shapes unpacks to the file it was packed from, and
+ * with SWEEP, every prefix of it is refused */
+static void packed( const char* what, const struct pv_opts* opts, unsigned n,
+	int sweep )
+{
+	struct NSVGimage *img, *ref, *out;
+	struct pv_opts o;
+	unsigned char *b, *plain, *cut;
+	size_t sz, plain_sz, k;
+	struct src in;
+	int r;
+
+	o          = *opts;
+	o.compress = 0;
+	b          = NULL;
+	plain      = NULL;
+	img        = test_image( n );
+	ref        = calloc( 1, sizeof( struct NSVGimage ) );
+	r          = img && ref ? encode_opts( img, &o, &plain, &plain_sz ) : -2;
+	r          = r ? r : pv_pv2nsvg( plain, plain_sz, ref );
+	r          = r ? r : encode_opts( img, opts, &b, &sz );
+
+	if( r )
+	{
+		fail( what, "encoding failed with", r );
+	}
+	else if( sz < 0xC || b[0] != 0x8A || b[1] != 'P' || b[2] != 'Z' )
+	{
+		fail( what, "not a compressed file, size", (int)( sz ) );
+	}
+	else
+	{
+		unpack_all( what, b, sz, ref );
+	}
+
+	for( k = 0; !r && sweep && k < sz; ++k )
+	{
+		cut  = malloc( k ? k : 1 );
+		out  = calloc( 1, sizeof( struct NSVGimage ) );
+		in.b = cut;
+		in.n = k;
+		in.i = 0;
+
+		if( !cut || !out )
+		{
+			fail( what, "out of memory at", (int)( k ) );
+			free( cut );
+			free( out );
+			break;
+		}
+
+		memcpy( cut, b, k );
+
+		if( pv_pv2nsvg( cut, k, out ) != ( k < 8 ? -1 : -3 ) )
+		{
+			fail( what, "wrong result for length", (int)( k ) );
+		}
+
+		nsvgDelete( out );
+		out = calloc( 1, sizeof( struct NSVGimage ) );
+
+		if( out && pv_pv2nsvg_cb( from_src, &in, out ) != -3 )
+		{
+			fail( what, "wrong result through a callback for length",
+				(int)( k ) );
+		}
+
+		if( out )
+		{
+			nsvgDelete( out );
+		}
+
+		out = calloc( 1, sizeof( struct NSVGimage ) );
+
+		if( out && pv_pv2nsvg_arena( cut, k, out ) != ( k < 8 ? -1 : -3 ) )
+		{
+			fail( what, "wrong arena result for length", (int)( k ) );
+		}
+
+		pv_nsvg_delete( out );
+
+		free( cut );
+	}
+
+	if( img )
+	{
+		nsvgDelete( img );
+	}
+
+	if( ref )
+	{
+		nsvgDelete( ref );
+	}
+
+	free( b );
+	free( plain );
+}
+
+/* IMG with points stored as steps decodes exactly as it does without, and
+ * takes the same size; so does it compressed. With SWEEP, every prefix of
+ * it is refused */
+static void predicted( const char* what, const struct pv_opts* opts,
+	struct NSVGimage* img, int sweep )
+{
+	struct NSVGimage* ref;
+	struct pv_opts o;
+	unsigned char *b, *plain;
+	size_t sz, plain_sz;
+	int r;
+
+	o         = *opts;
+	o.predict = 0;
+	b         = NULL;
+	plain     = NULL;
+	ref       = calloc( 1, sizeof( struct NSVGimage ) );
+	r         = img && ref ? encode_opts( img, &o, &plain, &plain_sz ) : -2;
+	r         = r ? r : pv_pv2nsvg( plain, plain_sz, ref );
+	o.predict = 1;
+	r         = r ? r : encode_opts( img, &o, &b, &sz );
+
+	if( r )
+	{
+		fail( what, "encoding failed with", r );
+	}
+	else if( sz != plain_sz )
+	{
+		fail( what, "steps changed the size by", (int)( sz - plain_sz ) );
+	}
+	else if( !memcmp( b, plain, sz ) )
+	{
+		fail( what, "no points were stored as steps", 0 );
+	}
+	else
+	{
+		decode_all( what, b, sz, ref, 0.0f );
+
+		if( sweep )
+		{
+			truncated( what, b, sz );
+		}
+	}
+
+	free( b );
+	b          = NULL;
+	o.compress = 1;
+	r          = r ? r : encode_opts( img, &o, &b, &sz );
+
+	if( r )
+	{
+		fail( what, "compressing failed with", r );
+	}
+	else
+	{
+		unpack_all( what, b, sz, ref );
+	}
+
+	if( ref )
+	{
+		nsvgDelete( ref );
+	}
+
+	free( b );
+	free( plain );
+}
+
+/* With IN_PLACE, every path of B hands out its stored points in place,
+ * 16 bytes apart from the start of B, and they are the ones
+ * pv_view_path_segs copies out; without, none do */
+static void floats( const char* what, const unsigned char* b, size_t sz,
+	int in_place )
+{
+	struct pv_view v;
+	struct pv_vshape vs;
+	struct pv_vpath vp;
+	const float* f;
+	unsigned char* t;
+	float* o;
+	unsigned i, j;
+	int r;
+
+	r = pv_view_init( b, sz, &v );
+
+	for( i = 0; !r && i < v.shape_ct; ++i )
+	{
+		r = pv_view_shape( &v, i, &vs );
+
+		for( j = 0; !r && j < vs.path_ct; ++j )
+		{
+			r = pv_view_path( &v, &vs, j, &vp );
+			f = r ? NULL : pv_view_path_floats( &vp );
+
+			if( r || !in_place != !f )
+			{
+				fail( what, "points in place wrong in shape", (int)( i ) );
+
+				return;
+			}
+
+			if( !f )
+			{
+				continue;
+			}
+
+			o = malloc( sizeof( float ) * 2 * ( vp.pts_ct + 1 ) );
+			t = malloc( vp.npts / 3 + 1 );
+
+			if( !o || !t )
+			{
+				r = -2;
+			}
+			else if( ( (const unsigned char*)( f ) - b ) % 16 != 0 )
+			{
+				fail( what, "points in place not aligned in shape", (int)( i ) );
+			}
+			else
+			{
+				pv_view_path_segs( &vp, t, o );
+
+				if( memcmp( f, o, sizeof( float ) * 2 * vp.pts_ct ) )
+				{
+					fail( what, "points in place differ in shape", (int)( i ) );
+				}
+			}
+
+			free( o );
+			free( t );
+		}
+	}
+
+	if( r )
+	{
+		fail( what, "the view API failed with", r );
+	}
+}
+
+/* IMG with aligned or host-order bounds and points decodes exactly as it
+ * does without, through every decoder, compressed too. With SWEEP, every
+ * prefix of it is refused */
+static void aligned( const char* what, const struct pv_opts* opts,
+	struct NSVGimage* img, int sweep )
+{
+	static const unsigned one = 1;
+	struct NSVGimage* ref;
+	struct pv_opts o;
+	unsigned char *b, *plain;
+	size_t sz, plain_sz;
+	int r, host_order;
+
+	o        = *opts;
+	o.align  = 0;
+	o.native = 0;
+	b        = NULL;
+	plain    = NULL;
+	ref      = calloc( 1, sizeof( struct NSVGimage ) );
+	r        = img && ref ? encode_opts( img, &o, &plain, &plain_sz ) : -2;
+	r        = r ? r : pv_pv2nsvg( plain, plain_sz, ref );
+	r        = r ? r : encode_opts( img, opts, &b, &sz );
+
+	/* Big-endian hosts hold floats as they are stored anyway */
+	host_order = opts->native || !*(const unsigned char*)( &one );
+
+	if( r )
+	{
+		fail( what, "encoding failed with", r );
+	}
+	else
+	{
+		decode_all( what, b, sz, ref, 0.0f );
+
+		if( opts->align )
+		{
+			floats( what, b, sz,
+				host_order && opts->coords == PV_COORDS_F32 && !opts->predict );
+		}
+
+		if( sweep )
+		{
+			truncated( what, b, sz );
+		}
+	}
+
+	free( b );
+	b          = NULL;
+	o          = *opts;
+	o.compress = 1;
+	r          = r ? r : encode_opts( img, &o, &b, &sz );
+
+	if( r )
+	{
+		fail( what, "compressing failed with", r );
+	}
+	else
+	{
+		unpack_all( what, b, sz, ref );
+	}
+
+	if( ref )
+	{
+		nsvgDelete( ref );
+	}
+
+	free( b );
+	free( plain );
+}
+
+int main( void )
+{
+	struct NSVGimage *img, *small;
+	unsigned char *b = NULL, *b2 = NULL;
+	size_t sz, sz2;
+	struct sink sink;
+	struct pv_opts opts;
+	unsigned i;
+	char* svg;
+	int r;
+
+	img   = test_image( 200 );
+	small = test_image( 12 );
+	svg   = malloc( sizeof( v0_svg ) );
+
+	if( !img || !small || !svg )
+	{
+		fputs( "roundtrip: cannot parse the test images\n", stderr );
+
+		return 1;
+	}
+
+	r = encode_file( img, &b, &sz );
+
+	if( r )
+	{
+		fail( "roundtrip", "encoding failed with", r );
+	}
+	else
+	{
+		decode_all( "roundtrip", b, sz, img, 1e-6f );
+
+		if( segments( "roundtrip", b, sz ) < 200 )
+		{
+			fail( "roundtrip", "too few lines", 200 );
+		}
+	}
+
+	/* Both encoders write the same bytes */
+	r = r ? r : encode_opts( img, NULL, &b2, &sz2 );
+
+	if( r )
+	{
+		fail( "roundtrip", "encoding to memory failed with", r );
+	}
+	else if( sz2 != sz || memcmp( b, b2, sz ) )
+	{
+		fail( "roundtrip", "pv_nsvg2pv and pv_fnsvg2pv differ, sizes",
+			(int)( sz2 ) - (int)( sz ) );
+	}
+
+	/* And so does the callback, which can abort at any block */
+	sink.t.b     = NULL;
+	sink.t.n     = 0;
+	sink.t.cap   = 0;
+	sink.blocks  = 0;
+	sink.fail_at = 0;
+	r            = r ? r : pv_nsvg2pv_cb( img, to_sink, &sink );
+
+	if( r )
+	{
+		fail( "roundtrip", "encoding to a callback failed with", r );
+	}
+	else if( sink.t.n != sz || memcmp( b, sink.t.b, sz ) )
+	{
+		fail( "roundtrip", "pv_nsvg2pv_cb and pv_fnsvg2pv differ, sizes",
+			(int)( sink.t.n ) - (int)( sz ) );
+	}
+
+	sink.t.n     = 0;
+	sink.fail_at = 1;
+
+	if( !r && pv_nsvg2pv_cb( img, to_sink, &sink ) != -2 )
+	{
+		fail( "roundtrip", "a failing callback was not caught", 0 );
+	}
+
+	free( sink.t.b );
+	free( b );
+	free( b2 );
+
+	r = encode_file( small, &b, &sz );
+
+	if( r )
+	{
+		fail( "truncated", "encoding failed with", r );
+	}
+	else
+	{
+		truncated( "truncated", b, sz );
+		free( b );
+	}
+
+	nsvgDelete( img );
+	nsvgDelete( small );
+
+	shared_gradients( );
+
+	styles( 40 );
+	styles( 300 );
+
+	/* One-byte indices, two-byte indices, and too many colours for either */
+	palette( 8, 100, 8 );
+	palette( 300, 3000, 300 );
+	palette( 70000, 70000, 0 );
+
+	/* Grid points come back within half a step, or one for lines and
+	 * bounds rounded outwards */
+	memset( &opts, 0, sizeof( opts ) );
+	opts.coords  = PV_COORDS_GRID;
+	opts.quantum = 1.0f / 16.0f;
+	with_opts( "grid 1/16", &opts, opts.quantum );
+	opts.quantum = 0.5f;
+	with_opts( "grid 1/2", &opts, opts.quantum );
+
+	/* The test image stays below 1024, where float16 steps are 0.5 */
+	opts.coords  = PV_COORDS_F16;
+	opts.quantum = 0.0f;
+	with_opts( "float16", &opts, 0.5f );
+	bad_opts( );
+
+	/* Compressed, in every coordinate mode, over several blocks */
+	memset( &opts, 0, sizeof( opts ) );
+	opts.compress = 1;
+	packed( "compressed", &opts, 3000, 0 );
+	packed( "compressed", &opts, 12, 1 );
+	opts.coords  = PV_COORDS_GRID;
+	opts.quantum = 1.0f / 16.0f;
+	packed( "compressed grid", &opts, 3000, 0 );
+	opts.coords  = PV_COORDS_F16;
+	opts.quantum = 0.0f;
+	packed( "compressed float16", &opts, 3000, 0 );
+
+	/* Points as steps, in byte planes for the long paths */
+	memset( &opts, 0, sizeof( opts ) );
+	img   = long_paths( 40 );
+	small = test_image( 12 );
+	predicted( "steps", &opts, img, 0 );
+	predicted( "steps", &opts, small, 1 );
+	opts.coords = PV_COORDS_F16;
+	predicted( "float16 steps", &opts, img, 0 );
+	predicted( "float16 steps", &opts, small, 1 );
+
+	/* Aligned and host-order floats, in every combination that goes */
+	for( i = 0; img && small && i < 16; ++i )
+	{
+		memset( &opts, 0, sizeof( opts ) );
+		opts.coords  = i & 1 ? PV_COORDS_F16 : PV_COORDS_F32;
+		opts.predict = ( i >> 1 ) & 1;
+		opts.align   = ( i >> 2 ) & 1;
+		opts.native  = ( i >> 3 ) & 1;
+
+		if( ( opts.align || opts.native ) && !( opts.predict && opts.native ) )
+		{
+			aligned( "aligned", &opts, img, 0 );
+			aligned( "aligned", &opts, small, i < 8 );
+		}
+	}
+
+	if( img )
+	{
+		nsvgDelete( img );
+	}
+
+	if( small )
+	{
+		nsvgDelete( small );
+	}
+
+	/* Version 0x00 files still read the same */
+	memcpy( svg, v0_svg, sizeof( v0_svg ) );
+	img = nsvgParse( svg, "px", 96.0f );
+	free( svg );
+
+	if( !img )
+	{
+		fputs( "roundtrip: cannot parse the version 0x00 image\n", stderr );
+
+		return 1;
+	}
+
+	decode_all( "version 0x00", v0_pv, sizeof( v0_pv ), img, 1e-6f );
+	truncated( "version 0x00", v0_pv, sizeof( v0_pv ) );
+	nsvgDelete( img );
+
+	return fails != 0;
+}
@@ -0,0 +1,536 @@
+#ifndef INC__PVLIB_TEST_UTIL_H
+#define INC__PVLIB_TEST_UTIL_H
+
+#include "pv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Shared by the tests: a generated image that uses every field the format
+ * stores, and comparisons of decoded images with it and with each other.
+ */
+
+static int fails = 0;
+
+static void fail( const char* what, const char* detail, int n )
+{
+	fprintf( stderr, "%s: %s %d\n", what, detail, n );
+	fails++;
+}
+
+/* A growable string for generated SVG */
+struct text
+{
+	char* b;
+	size_t n, cap;
+};
+
+static void put( struct text* t, const char* s )
+{
+	size_t n;
+
+	n = strlen( s );
+
+	if( t->n + n + 1 > t->cap )
+	{
+		t->cap = ( t->n + n + 1 ) * 2;
+		t->b   = realloc( t->b, t->cap );
+
+		if( !t->b )
+		{
+			fputs( "out of memory\n", stderr );
+			exit( 2 );
+		}
+	}
+
+	memcpy( t->b + t->n, s, n + 1 );
+	t->n += n;
+}
+
+/* N shapes in a few colours and styles, filled and stroked with colours
+ * and gradients, with dashes, joins, caps, opacity, even-odd fills, hidden
+ * shapes, lines, curves and several paths to a shape */
+static struct NSVGimage* test_image( unsigned n )
+{
+	static const char* joins[] = { "miter", "round", "bevel" };
+	static const char* caps[]  = { "butt", "round", "square" };
+	struct NSVGimage* img;
+	struct text t = { NULL, 0, 0 };
+	char s[512];
+	unsigned i, x, y;
+
+	put( &t, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"640\" "
+		"height=\"480\"><defs>"
+		"<linearGradient id=\"l\" x1=\"0\" y1=\"0\" x2=\"1\" y2=\"1\">"
+		"<stop offset=\"0\" stop-color=\"#102030\"/>"
+		"<stop offset=\"0.4\" stop-color=\"#ff8000\" stop-opacity=\"0.5\"/>"
+		"<stop offset=\"1\" stop-color=\"#00ff80\"/></linearGradient>"
+		"<radialGradient id=\"r\" cx=\"0.4\" cy=\"0.6\" r=\"0.7\" fx=\"0.3\" "
+		"fy=\"0.5\" spreadMethod=\"reflect\">"
+		"<stop offset=\"0.1\" stop-color=\"#ffffff\"/>"
+		"<stop offset=\"0.9\" stop-color=\"#000080\"/></radialGradient>"
+		"</defs>" );
+
+	for( i = 0; i < n; ++i )
+	{
+		x = ( i * 37 ) % 600;
+		y = ( i * 53 ) % 440;
+
+		sprintf( s,
+			"<path fill=\"%s\" stroke=\"%s\" stroke-width=\"%u.5\" "
+			"stroke-linejoin=\"%s\" stroke-linecap=\"%s\" "
+			"stroke-miterlimit=\"%u\"%s%s%s "
+			"d=\"M%u,%u l%u.25,0 c5,-9 12,9 17.75,0.5 L%u,%u z "
+			"M%u.5,%u.5 C%u,%u %u,%u %u,%u\"/>",
+			i % 7 == 0 ? "url(#l)" :
+				i % 11 == 0 ? "none" :
+								  i % 3 ? "#c83264" : "#3264c8",
+			i % 5 == 0 ? "url(#r)" : i % 4 ? "#000000" : "none", i % 4,
+			joins[i % 3], caps[i / 3 % 3], 4 + i % 3,
+			i % 6 == 0 ? " stroke-dasharray=\"4 2.5 1\" "
+						 "stroke-dashoffset=\"1.5\"" :
+							 "",
+			i % 9 == 0 ? " opacity=\"0.5\"" : "",
+			i % 13 == 0 ? " fill-rule=\"evenodd\"" :
+				i % 17 == 0 ? " display=\"none\"" :
+								  "",
+			x, y, 10 + i % 20, x + 5, y + 30, x + 2, y + 2, x + 40, y, x, y + 40,
+			x + 30, y + 30 );
+		put( &t, s );
+	}
+
+	put( &t, "</svg>" );
+
+	img = nsvgParse( t.b, "px", 96.0f );
+	free( t.b );
+
+	return img;
+}
+
+/* N shapes with one long, winding path each, of lines and curves, so
+ * that its points are stored in byte planes with steps */
+static struct NSVGimage* long_paths( unsigned n )
+{
+	struct NSVGimage* img;
+	struct text t = { NULL, 0, 0 };
+	char s[128];
+	unsigned i, k, x, y;
+
+	put( &t, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"640\" "
+		"height=\"480\">" );
+
+	for( i = 0; i < n; ++i )
+	{
+		x = ( i * 37 ) % 300;
+		y = ( i * 53 ) % 200;
+		sprintf( s, "<path fill=\"none\" stroke=\"#%06x\" d=\"M%u,%u",
+			( i * 0x3579 ) & 0xFFFFFF, x, y );
+		put( &t, s );
+
+		for( k = 0; k < 200; ++k )
+		{
+			x += k % 7;
+			y += ( k * 3 ) % 5;
+
+			if( k % 3 )
+			{
+				sprintf( s, " L%u.%u,%u.%u", x, k % 10, y, i % 10 );
+			}
+			else
+			{
+				sprintf( s, " C%u,%u.5 %u.25,%u %u.75,%u", x, y + 2, x + 1,
+					y + 1, x + 2, y );
+				x += 2;
+			}
+
+			put( &t, s );
+		}
+
+		put( &t, "\"/>" );
+	}
+
+	put( &t, "</svg>" );
+
+	img = nsvgParse( t.b, "px", 96.0f );
+	free( t.b );
+
+	return img;
+}
+
+/* A version 0x00 file, from before the shape offset table, and the SVG it
+ * was encoded from */
+static const char v0_svg[] =
+	"<svg width=\"64\" height=\"48\"><defs>"
+	"<linearGradient id=\"g\" x2=\"1\">"
+	"<stop offset=\"0\" stop-color=\"#ff0000\"/>"
+	"<stop offset=\"1\" stop-color=\"#0000ff\"/></linearGradient></defs>"
+	"<path fill=\"url(#g)\" d=\"M1,2 L30,2 L30,20 z M4,5 L8,5 L6,9 z\"/>"
+	"<path fill=\"none\" stroke=\"#204060\" stroke-width=\"3\" "
+	"stroke-dasharray=\"5 2\" stroke-linecap=\"round\" opacity=\"0.5\" "
+	"d=\"M10,30 C20,40 30,20 40,30\"/></svg>";
+
+static const unsigned char v0_pv[] =
+{
+	0x8A, 0x50, 0x56, 0x00, 0x0D, 0x0A, 0x1A, 0x0A, 0x42, 0x80, 0x00, 0x00,
+	0x42, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x01, 0x91, 0x00,
+	0x00, 0x44, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x41,
+	0xF0, 0x00, 0x00, 0x41, 0xA0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x80,
+	0x00, 0x00, 0x0A, 0x40, 0x80, 0x00, 0x00, 0x40, 0xA0, 0x00, 0x00, 0x41,
+	0x00, 0x00, 0x00, 0x41, 0x10, 0x00, 0x00, 0x40, 0x80, 0x00, 0x00, 0x40,
+	0xA0, 0x00, 0x00, 0x40, 0xAA, 0xAA, 0xAB, 0x40, 0xA0, 0x00, 0x00, 0x40,
+	0xD5, 0x55, 0x55, 0x40, 0xA0, 0x00, 0x00, 0x41, 0x00, 0x00, 0x00, 0x40,
+	0xA0, 0x00, 0x00, 0x40, 0xEA, 0xAA, 0xAB, 0x40, 0xCA, 0xAA, 0xAB, 0x40,
+	0xD5, 0x55, 0x55, 0x40, 0xF5, 0x55, 0x55, 0x40, 0xC0, 0x00, 0x00, 0x41,
+	0x10, 0x00, 0x00, 0x40, 0xAA, 0xAA, 0xAB, 0x40, 0xF5, 0x55, 0x55, 0x40,
+	0x95, 0x55, 0x55, 0x40, 0xCA, 0xAA, 0xAB, 0x40, 0x80, 0x00, 0x00, 0x40,
+	0xA0, 0x00, 0x00, 0x80, 0x00, 0x00, 0x0A, 0x3F, 0x80, 0x00, 0x00, 0x40,
+	0x00, 0x00, 0x00, 0x41, 0xF0, 0x00, 0x00, 0x41, 0xA0, 0x00, 0x00, 0x3F,
+	0x80, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x41, 0x2A, 0xAA, 0xAB, 0x40,
+	0x00, 0x00, 0x00, 0x41, 0xA2, 0xAA, 0xAA, 0x40, 0x00, 0x00, 0x00, 0x41,
+	0xF0, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x41, 0xF0, 0x00, 0x00, 0x41,
+	0x00, 0x00, 0x00, 0x41, 0xF0, 0x00, 0x00, 0x41, 0x60, 0x00, 0x00, 0x41,
+	0xF0, 0x00, 0x00, 0x41, 0xA0, 0x00, 0x00, 0x41, 0xA2, 0xAA, 0xAA, 0x41,
+	0x60, 0x00, 0x00, 0x41, 0x2A, 0xAA, 0xAB, 0x41, 0x00, 0x00, 0x00, 0x3F,
+	0x80, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x8E, 0x20, 0x40, 0x60, 0x7F,
+	0x42, 0x00, 0x00, 0x00, 0x02, 0x3C, 0x00, 0x3C, 0x00, 0x04, 0x44, 0x00,
+	0x41, 0x20, 0x00, 0x00, 0x41, 0xD8, 0xE7, 0xEF, 0x42, 0x20, 0x00, 0x00,
+	0x42, 0x03, 0x8C, 0x09, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x04,
+	0x41, 0x20, 0x00, 0x00, 0x41, 0xD8, 0xE7, 0xEF, 0x42, 0x20, 0x00, 0x00,
+	0x42, 0x03, 0x8C, 0x09, 0x41, 0x20, 0x00, 0x00, 0x41, 0xF0, 0x00, 0x00,
+	0x41, 0xA0, 0x00, 0x00, 0x42, 0x20, 0x00, 0x00, 0x41, 0xF0, 0x00, 0x00,
+	0x41, 0xA0, 0x00, 0x00, 0x42, 0x20, 0x00, 0x00, 0x41, 0xF0, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00,
+	0xFF, 0x00, 0x00, 0xFF, 0x3C, 0x00, 0xFF, 0xFF, 0x00, 0x00
+};
+
+/* How far coordinates stored on a grid may come back from where they were,
+ * on top of the tolerance same_image is given */
+static float grid_tol = 0.0f;
+
+static int near( float a, float b, float tol )
+{
+	float d, m;
+
+	d = a > b ? a - b : b - a;
+	m = a < 0.0f ? -a : a;
+
+	return d <= tol * ( m > 1.0f ? m : 1.0f );
+}
+
+static int near_xy( float a, float b, float tol )
+{
+	return near( a, b, tol ) ||
+		( tol && ( a > b ? a - b : b - a ) <= grid_tol );
+}
+
+static int same_gradient( const struct NSVGgradient* a,
+	const struct NSVGgradient* b, int type, float tol )
+{
+	int i;
+
+	for( i = 0; i < 6; ++i )
+	{
+		if( !near( a->xform[i], b->xform[i], tol ) )
+		{
+			return 0;
+		}
+	}
+
+	if( a->spread != b->spread || a->nstops != b->nstops )
+	{
+		return 0;
+	}
+
+	if( type == NSVG_PAINT_RADIAL_GRADIENT &&
+		( !near( a->fx, b->fx, tol ) || !near( a->fy, b->fy, tol ) ) )
+	{
+		return 0;
+	}
+
+	for( i = 0; i < a->nstops; ++i )
+	{
+		if( a->stops[i].color != b->stops[i].color ||
+			!near( a->stops[i].offset, b->stops[i].offset, tol ? 2e-3f : 0.0f ) )
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static int same_paint(
+	const struct NSVGpaint* a, const struct NSVGpaint* b, float tol )
+{
+	if( a->type != b->type )
+	{
+		return 0;
+	}
+
+	/* The format keeps colours, not the opacity nanoSVG folds into them */
+	if( a->type == NSVG_PAINT_COLOR )
+	{
+		return tol ? ( ( a->color ^ b->color ) & 0xFFFFFF ) == 0 :
+						 a->color == b->color;
+	}
+
+	if( a->type == NSVG_PAINT_LINEAR_GRADIENT ||
+		a->type == NSVG_PAINT_RADIAL_GRADIENT )
+	{
+		return same_gradient( a->gradient, b->gradient, a->type, tol );
+	}
+
+	return 1;
+}
+
+/* Do images A and B match in every field the format stores? With TOL zero,
+ * they must be the same bit for bit; otherwise style numbers may differ by
+ * a float16 rounding and coordinates by TOL, relative to their size */
+static int same_image( const char* what, const struct NSVGimage* a,
+	const struct NSVGimage* b, float tol )
+{
+	const struct NSVGshape *s, *t;
+	const struct NSVGpath *p, *q;
+	float sty;
+	int n, i;
+
+	sty = tol ? 1e-3f : 0.0f;
+
+	if( a->width != b->width || a->height != b->height )
+	{
+		fail( what, "canvas size differs", 0 );
+
+		return 0;
+	}
+
+	for( s = a->shapes, t = b->shapes, n = 0; s && t;
+		  s = s->next, t = t->next, ++n )
+	{
+		if( !same_paint( &( s->fill ), &( t->fill ), tol ) ||
+			!same_paint( &( s->stroke ), &( t->stroke ), tol ) )
+		{
+			fail( what, "paint differs in shape", n );
+
+			return 0;
+		}
+
+		if( !near( s->opacity, t->opacity, tol ? 1.0f / 255.0f : 0.0f ) ||
+			s->fillRule != t->fillRule || s->flags != t->flags ||
+			!near( s->miterLimit, t->miterLimit, sty ) )
+		{
+			fail( what, "style differs in shape", n );
+
+			return 0;
+		}
+
+		if( s->stroke.type != NSVG_PAINT_NONE &&
+			( !near( s->strokeWidth, t->strokeWidth, sty ) ||
+				s->strokeLineJoin != t->strokeLineJoin ||
+				s->strokeLineCap != t->strokeLineCap ||
+				s->strokeDashCount != t->strokeDashCount ) )
+		{
+			fail( what, "stroke differs in shape", n );
+
+			return 0;
+		}
+
+		for( i = 0; s->stroke.type != NSVG_PAINT_NONE &&
+			  i < s->strokeDashCount;
+			  ++i )
+		{
+			if( !near( s->strokeDashArray[i], t->strokeDashArray[i], sty ) ||
+				!near( s->strokeDashOffset, t->strokeDashOffset, sty ) )
+			{
+				fail( what, "dashes differ in shape", n );
+
+				return 0;
+			}
+		}
+
+		for( i = 0; i < 4; ++i )
+		{
+			if( !near_xy( s->bounds[i], t->bounds[i], tol ) )
+			{
+				fail( what, "bounds differ in shape", n );
+
+				return 0;
+			}
+		}
+
+		for( p = s->paths, q = t->paths; p && q; p = p->next, q = q->next )
+		{
+			if( p->npts != q->npts || p->closed != q->closed )
+			{
+				fail( what, "path size differs in shape", n );
+
+				return 0;
+			}
+
+			for( i = 0; i < 4; ++i )
+			{
+				if( !near_xy( p->bounds[i], q->bounds[i], tol ) )
+				{
+					fail( what, "path bounds differ in shape", n );
+
+					return 0;
+				}
+			}
+
+			for( i = 0; i < p->npts * 2; ++i )
+			{
+				if( !near_xy( p->pts[i], q->pts[i], tol ) )
+				{
+					fail( what, "points differ in shape", n );
+
+					return 0;
+				}
+			}
+		}
+
+		if( p || q )
+		{
+			fail( what, "path count differs in shape", n );
+
+			return 0;
+		}
+	}
+
+	if( s || t )
+	{
+		fail( what, "shape count differs", n );
+
+		return 0;
+	}
+
+	return 1;
+}
+
+#ifndef PV_NO_STDIO
+
+/* Encode IMG with pv_fnsvg2pv and read the file back into *B */
+static int encode_file(
+	struct NSVGimage* img, unsigned char** b, size_t* sz )
+{
+	FILE* f;
+	long n;
+	int r;
+
+	f = tmpfile( );
+
+	if( !f )
+	{
+		return -1;
+	}
+
+	r = pv_fnsvg2pv( img, f );
+	n = ftell( f );
+
+	if( !r && ( n < 0 || fseek( f, 0, SEEK_SET ) ) )
+	{
+		r = -1;
+	}
+
+	*b  = r ? NULL : malloc( n > 0 ? (size_t)( n ) : 1 );
+	*sz = (size_t)( n );
+
+	if( !r && ( !*b || fread( *b, 1, *sz, f ) != *sz ) )
+	{
+		r = -1;
+	}
+
+	fclose( f );
+
+	return r;
+}
+
+#endif /* PV_NO_STDIO */
+
+/* Encode IMG with OPTS through pv_nsvg2pv_opts into *B, sized by asking it
+ * first; it has to fill that size exactly, and refuse a byte less */
+static int encode_opts( struct NSVGimage* img, const struct pv_opts* opts,
+	unsigned char** b, size_t* sz )
+{
+	size_t n;
+	int r;
+
+	*b = NULL;
+	r  = pv_nsvg2pv_opts( img, opts, NULL, sz );
+
+	if( r )
+	{
+		return r;
+	}
+
+	*b = malloc( *sz );
+
+	if( !*b )
+	{
+		return -2;
+	}
+
+	n = *sz - 1;
+
+	if( pv_nsvg2pv_opts( img, opts, *b, &n ) != -4 )
+	{
+		fail( "encode_opts", "a short buffer was not refused, size",
+			(int)( n ) );
+	}
+
+	n = *sz;
+	r = pv_nsvg2pv_opts( img, opts, *b, &n );
+
+	if( !r && n != *sz )
+	{
+		fail( "encode_opts", "sized wrong, by", (int)( n ) - (int)( *sz ) );
+	}
+
+	if( r )
+	{
+		free( *b );
+		*b = NULL;
+	}
+
+	return r;
+}
+
+/* Callback output collected in a growing buffer, failing after FAIL_AT
+ * blocks if that is not zero */
+struct sink
+{
+	struct text t;
+	int blocks, fail_at;
+};
+
+static int to_sink( void* ctx, const void* b, size_t n )
+{
+	struct sink* s;
+
+	s = (struct sink*)( ctx );
+
+	if( s->fail_at && ++s->blocks >= s->fail_at )
+	{
+		return 1;
+	}
+
+	if( s->t.n + n > s->t.cap )
+	{
+		s->t.cap = ( s->t.n + n ) * 2;
+		s->t.b   = realloc( s->t.b, s->t.cap );
+
+		if( !s->t.b )
+		{
+			return 1;
+		}
+	}
+
+	memcpy( s->t.b + s->t.n, b, n );
+	s->t.n += n;
+
+	return 0;
+}
+
+#endif /* INC__PVLIB_TEST_UTIL_H */
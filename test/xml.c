@@ -0,0 +1,265 @@
+#include "util.h"
+
+/* nanosvg's XML tokenizer, which nanosvg.h leaves out of its interface */
+int nsvg__parseXML( char* input,
+	void ( *startelCb )( void* ud, const char* el, const char** attr ),
+	void ( *endelCb )( void* ud, const char* el ),
+	void ( *contentCb )( void* ud, const char* s ), void* ud );
+
+/* The tokenizer as it was before it scanned a block at a time, stepping
+ * one byte at a time, for the new one to be checked against */
+
+static int ref_isspace( char c ) { return strchr( " \t\n\v\f\r", c ) != 0; }
+
+static void ref_content(
+	char* s, void ( *contentCb )( void* ud, const char* s ), void* ud )
+{
+	while( *s && ref_isspace( *s ) )
+		s++;
+	if( !*s )
+		return;
+
+	( *contentCb )( ud, s );
+}
+
+static void ref_element( char* s,
+	void ( *startelCb )( void* ud, const char* el, const char** attr ),
+	void ( *endelCb )( void* ud, const char* el ), void* ud )
+{
+	const char* attr[256];
+	int nattr = 0;
+	char* name;
+	int start = 0;
+	int end   = 0;
+	char quote;
+
+	while( *s && ref_isspace( *s ) )
+		s++;
+
+	if( *s == '/' )
+	{
+		s++;
+		end = 1;
+	}
+	else
+	{
+		start = 1;
+	}
+
+	if( !*s || *s == '?' || *s == '!' )
+		return;
+
+	name = s;
+	while( *s && !ref_isspace( *s ) )
+		s++;
+	if( *s )
+	{
+		*s++ = '\0';
+	}
+
+	while( !end && *s && nattr < 256 - 3 )
+	{
+		char* name  = NULL;
+		char* value = NULL;
+
+		while( *s && ref_isspace( *s ) )
+			s++;
+		if( !*s )
+			break;
+		if( *s == '/' )
+		{
+			end = 1;
+			break;
+		}
+		name = s;
+		while( *s && !ref_isspace( *s ) && *s != '=' )
+			s++;
+		if( *s )
+		{
+			*s++ = '\0';
+		}
+		while( *s && *s != '\"' && *s != '\'' )
+			s++;
+		if( !*s )
+			break;
+		quote = *s;
+		s++;
+		value = s;
+		while( *s && *s != quote )
+			s++;
+		if( *s )
+		{
+			*s++ = '\0';
+		}
+
+		if( name && value )
+		{
+			attr[nattr++] = name;
+			attr[nattr++] = value;
+		}
+	}
+
+	attr[nattr++] = 0;
+	attr[nattr++] = 0;
+
+	if( start )
+		( *startelCb )( ud, name, attr );
+	if( end )
+		( *endelCb )( ud, name );
+}
+
+static void ref_parse( char* input,
+	void ( *startelCb )( void* ud, const char* el, const char** attr ),
+	void ( *endelCb )( void* ud, const char* el ),
+	void ( *contentCb )( void* ud, const char* s ), void* ud )
+{
+	char* s    = input;
+	char* mark = s;
+	int tag    = 0;
+
+	while( *s )
+	{
+		if( *s == '<' && !tag )
+		{
+			*s++ = '\0';
+			ref_content( mark, contentCb, ud );
+			mark = s;
+			tag  = 1;
+		}
+		else if( *s == '>' && tag )
+		{
+			*s++ = '\0';
+			ref_element( mark, startelCb, endelCb, ud );
+			mark = s;
+			tag  = 0;
+		}
+		else
+		{
+			s++;
+		}
+	}
+}
+
+/* Each callback writes down what it was given */
+
+static void log_start( void* ud, const char* el, const char** attr )
+{
+	put( (struct text*)( ud ), "\n<" );
+	put( (struct text*)( ud ), el );
+
+	for( ; *attr; attr += 2 )
+	{
+		put( (struct text*)( ud ), " [" );
+		put( (struct text*)( ud ), attr[0] );
+		put( (struct text*)( ud ), "]=[" );
+		put( (struct text*)( ud ), attr[1] );
+		put( (struct text*)( ud ), "]" );
+	}
+}
+
+static void log_end( void* ud, const char* el )
+{
+	put( (struct text*)( ud ), "\n</" );
+	put( (struct text*)( ud ), el );
+}
+
+static void log_content( void* ud, const char* s )
+{
+	put( (struct text*)( ud ), "\n\"" );
+	put( (struct text*)( ud ), s );
+}
+
+static unsigned long seed = 1;
+
+static unsigned rnd( unsigned n )
+{
+	seed = seed * 1103515245UL + 12345UL;
+
+	return (unsigned)( ( seed >> 16 ) % n );
+}
+
+/* Most bytes of a soup */
+#define SOUP_SZ 600
+
+/* Bytes of tag soup, up to SOUP_SZ of them, in runs of one byte that the
+ * tokenizer looks for, and of bytes it has to step over */
+static size_t soup( char* s )
+{
+	static const char bytes[] = "<>\"'=/?! \t\n\v\f\rabcxyz019-#:.;\xC3\xA9\x80";
+	size_t n, len, i;
+	char c;
+
+	len = rnd( SOUP_SZ );
+
+	for( n = 0; n < len; n += i )
+	{
+		c = bytes[rnd( sizeof( bytes ) - 1 )];
+		i = rnd( 4 ) ? 1 : 1 + rnd( 70 );
+		i = i < len - n ? i : len - n;
+		memset( s + n, c, i );
+	}
+
+	s[len] = '\0';
+
+	return len;
+}
+
+/* Tokenizing SOUP at every offset into a block of 64 bytes, so its bytes
+ * and its end fall everywhere in a block, calls back exactly as the byte at
+ * a time tokenizer does */
+static void same_as_ref( const char* soup, size_t n )
+{
+	static char in[SOUP_SZ + 128];
+	struct text want = { NULL, 0, 0 }, got = { NULL, 0, 0 };
+	size_t offs;
+	char* s;
+
+	memcpy( in, soup, n + 1 );
+	put( &want, "" );
+	ref_parse( in, log_start, log_end, log_content, &want );
+
+	for( offs = 0; offs < 64; ++offs )
+	{
+		s = (char*)( ( (size_t)( in ) + 63 ) & ~(size_t)( 63 ) ) + offs;
+		memcpy( s, soup, n + 1 );
+		got.n = 0;
+		put( &got, "" );
+		nsvg__parseXML( s, log_start, log_end, log_content, &got );
+
+		if( strcmp( got.b, want.b ) )
+		{
+			fprintf( stderr, "xml: \"%s\" at offset %u gave%s\nnot%s\n", soup,
+				(unsigned)( offs ), got.b, want.b );
+			fails++;
+			break;
+		}
+	}
+
+	free( want.b );
+	free( got.b );
+}
+
+int main( void )
+{
+	static const char* cases[] = { "", "<", ">", "<>", "< >", "</>", "<a",
+		"<a b='c'", "<a b=\"c\"/>", "<a b='c\"d' e=\"f'g\" / >",
+		"  text  <a/>  more\t<b\n\tx = 'y'\n>z</b>",
+		"<?xml version=\"1.0\"?><!-- c --><svg><g/></svg>", "<a b c='d'>",
+		"<a b='>'>", "<a\x80\xC3 b='\xA9'>\xC3\xA9</a>" };
+	char s[SOUP_SZ + 1];
+	unsigned i;
+	size_t n;
+
+	for( i = 0; i < sizeof( cases ) / sizeof( cases[0] ); ++i )
+	{
+		same_as_ref( cases[i], strlen( cases[i] ) );
+	}
+
+	for( i = 0; i < 3000 && !fails; ++i )
+	{
+		n = soup( s );
+		same_as_ref( s, n );
+	}
+
+	return fails != 0;
+}